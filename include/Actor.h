@@ -10,6 +10,7 @@ struct Number;
 #include "Actor/ActorBase.h"
 #include "Actor/ActorDerived.h"
 #include "Actor/Actor.h"
+#include "Actor/PoolAllocated.h"
 #include "Actor/SpawnInfo.h"
 #include "Actor/Enemy.h"
 #include "Actor/CapEnemy.h"
@@ -0,0 +1,148 @@
+#pragma once
+
+/*
+	INFORMATION
+	Actors are normally allocated one by one on the game heap, which walks the free list on every
+	spawn and fragments the heap when many small actors come and go (coins, fireballs, numbers, ...).
+	Deriving from PoolAllocated<Base, Derived, capacity> instead of Base makes Derived allocate from
+	a pool of capacity equally sized slots, which is carved from the game heap as a single block:
+
+		struct Fireball : PoolAllocated<Actor, Fireball, 16> { ... };
+
+	The block is allocated by Reserve, or when the first instance is spawned, and is kept while
+	instances come and go, so that it doesn't land somewhere else on the heap every time the last
+	one is destroyed. Release gives it back if no instance is in the pool, e.g. when the level is
+	unloaded; reserving it again when the next level is loaded keeps it at the end of the heap:
+
+		Fireball::Pool().Reserve();  // when the level is loaded
+		Fireball::Pool().Release();  // when it's unloaded
+
+	Allocation and deallocation take constant time. If the pool is full (or the block couldn't be
+	allocated), the instance is allocated by Base::operator new like any other actor. The memory is
+	zeroed like memory from ActorBase::operator new.
+*/
+
+template<u32 slotSize, u32 capacity>
+class ActorPool
+{
+	union Slot
+	{
+		Slot* nextFree;
+		alignas(4) u8 data[slotSize];
+	};
+
+	Slot* slots = nullptr;
+	Slot* firstFree = nullptr;
+
+public:
+	struct Stats
+	{
+		u16 numInUse;       // instances in the pool
+		u16 maxInUse;       // high-water mark of numInUse
+		u32 numAllocations; // including fallbacks
+		u32 numFallbacks;   // allocations that went to the game heap because the pool was full
+		u32 numReserves;    // times the block was allocated
+	};
+
+	Stats stats = {};
+
+	[[nodiscard]] bool Owns(const void* ptr) const
+	{
+		return slots && ptr >= slots && ptr < slots + capacity;
+	}
+
+	[[nodiscard]] bool Reserved() const { return slots != nullptr; }
+
+	// Allocates the block if it isn't already, returns whether the pool has it
+	bool Reserve()
+	{
+		if (slots) return true;
+
+		slots = static_cast<Slot*>(Memory::Allocate(sizeof(Slot) * capacity, -4, Memory::gameHeapPtr));
+		if (!slots) return false;
+
+		for (u32 i = 0; i < capacity - 1; i++)
+			slots[i].nextFree = &slots[i + 1];
+
+		slots[capacity - 1].nextFree = nullptr;
+		firstFree = slots;
+		stats.numReserves++;
+
+		return true;
+	}
+
+	// Gives the block back to the game heap, unless an instance is still in it.
+	// Returns whether the pool doesn't have the block anymore.
+	bool Release()
+	{
+		if (stats.numInUse != 0) return false;
+
+		if (slots)
+		{
+			Memory::Deallocate(slots, Memory::gameHeapPtr);
+			slots = nullptr;
+			firstFree = nullptr;
+		}
+
+		return true;
+	}
+
+	// Returns a zeroed slot, or nullptr if the instance has to be allocated somewhere else
+	void* Allocate(size_t size)
+	{
+		stats.numAllocations++;
+
+		if (size > slotSize || !Reserve() || !firstFree)
+		{
+			stats.numFallbacks++;
+			return nullptr;
+		}
+
+		Slot* slot = firstFree;
+		firstFree = slot->nextFree;
+
+		if (++stats.numInUse > stats.maxInUse)
+			stats.maxInUse = stats.numInUse;
+
+		CpuFill32(0, slot, sizeof(Slot));
+		return slot;
+	}
+
+	// Returns false if ptr isn't in the pool
+	bool Deallocate(void* ptr)
+	{
+		if (!Owns(ptr)) return false;
+
+		Slot* slot = static_cast<Slot*>(ptr);
+		slot->nextFree = firstFree;
+		firstFree = slot;
+		stats.numInUse--;
+
+		return true;
+	}
+};
+
+template<class Base, class Derived, u32 capacity>
+struct PoolAllocated : Base
+{
+	using Base::Base;
+
+	// sizeof(Derived) is only known once Derived is complete, so the pool is created on first use
+	static auto& Pool()
+	{
+		static constinit ActorPool<(sizeof(Derived) + 3) & ~3u, capacity> pool;
+		return pool;
+	}
+
+	void* operator new(size_t count)
+	{
+		if (void* ptr = Pool().Allocate(count)) return ptr;
+
+		return Base::operator new(count);
+	}
+
+	void operator delete(void* ptr)
+	{
+		if (!Pool().Deallocate(ptr)) Base::operator delete(ptr);
+	}
+};
@@ -0,0 +1,212 @@
+#pragma once
+
+#include "../Math/MathCommon.h"
+
+struct Archive;
+
+/*
+	INFORMATION
+	Resolving a file ID to the archive that holds it means going through the ranges of ARCHIVE_INFOS,
+	and whether that archive is loaded is only known from its entry. ARCHIVE_INDEX is a dense table
+	from file ID to archive slot and FAT index, so that a loader can resolve a file and check if it
+	can be loaded without a card read in one lookup:
+
+		ARCHIVE_INDEX.Rebuild(ARCHIVE_INFOS); // once, e.g. after InitFileSystem
+
+		ArchiveIndex::Location location = ARCHIVE_INDEX.Resolve(fileID);
+		if (location.IsResident()) ... ARCHIVE_INDEX.GetFatEntry(fileID) ...
+
+	The table covers file IDs from the lowest firstFileID to the highest firstNotFileID, up to
+	CAPACITY of them. IDs outside of that are in no archive. IDs in that span past CAPACITY, or with a
+	FAT index that doesn't fit in an entry, are resolved by searching the ranges, which is counted in
+	stats.numFallbacks.
+
+	An archive is resident while ArchiveInfo::archive isn't nullptr, which points to its Archive.
+	The game loads and unloads level archives itself, so the table doesn't store that: every lookup
+	reads ArchiveInfo::archive of the slot, which means the infos passed to Rebuild must outlive the
+	index (ARCHIVE_INFOS does). GetFatEntry assumes that Archive::fat points to the FAT entries,
+	8 bytes each, like in the FSArchive of the NitroSDK.
+
+	Rebuild is a template so that tests/ArchiveIndexTest.cpp can run the index on a synthetic FAT
+	on the host.
+*/
+
+class ArchiveIndex
+{
+public:
+	static constexpr u32 CAPACITY = 0x800;
+	static constexpr u32 MAX_SLOTS = 15;
+
+	struct FatEntry
+	{
+		u32 start; // offsets in the file block of the archive
+		u32 end;
+	};
+
+	struct Location
+	{
+		static constexpr u16 NONE = 0xffff;
+
+		u16 slot;      // index in ARCHIVE_INFOS, NONE if the file isn't in an archive
+		u16 fatIndex;
+		bool resident;
+
+		[[nodiscard]] bool IsInArchive() const { return slot != NONE; }
+		[[nodiscard]] bool IsResident() const { return slot != NONE && resident; }
+	};
+
+	struct Stats
+	{
+		u32 numLookups;
+		u32 numResident;    // lookups of files in loaded archives
+		u32 numNotResident; // lookups of files in archives that aren't loaded
+		u32 numNotInArchive;
+		u32 numFallbacks;   // lookups that had to search the ranges
+	};
+
+private:
+	// an entry is NO_ARCHIVE, FALLBACK, or the slot << SLOT_SHIFT | fatIndex
+	static constexpr u16 FAT_INDEX_MASK = 0xfff;
+	static constexpr u32 SLOT_SHIFT = 12;
+	static constexpr u16 NO_ARCHIVE = 0xf000; // slot 15
+	static constexpr u16 FALLBACK = 0xf001;
+
+	struct Range
+	{
+		u16 firstFileID;
+		u16 firstNotFileID;
+		char* const* archive; // &ArchiveInfo::archive, nullptr while the archive isn't resident
+	};
+
+	using FatOfFunc = const FatEntry* (const char* archive);
+
+	u16 entries[CAPACITY] = {};
+	Range ranges[MAX_SLOTS] = {};
+	FatOfFunc* fatOf = nullptr;
+	u16 numSlots = 0;
+	u16 firstFileID = 0;    // of entries[0]
+	u16 firstNotFileID = 0; // the highest of all ranges
+	u16 numEntries = 0;
+
+	template<class ArchiveT>
+	static const FatEntry* FatOf(const char* archive)
+	{
+		return reinterpret_cast<const FatEntry*>(reinterpret_cast<const ArchiveT*>(archive)->fat);
+	}
+
+	[[nodiscard]] bool IsLoaded(u32 slot) const { return *ranges[slot].archive != nullptr; }
+
+	void Fill(u32 slot)
+	{
+		const Range& range = ranges[slot];
+
+		for (u32 fileID = range.firstFileID; fileID < range.firstNotFileID; fileID++)
+		{
+			const u32 fatIndex = fileID - range.firstFileID;
+			const u32 i = fileID - firstFileID;
+
+			if (i >= numEntries) break;
+
+			entries[i] = fatIndex > FAT_INDEX_MASK ? FALLBACK : slot << SLOT_SHIFT | fatIndex;
+		}
+	}
+
+	Location Search(u32 fileID) const
+	{
+		for (u32 slot = 0; slot < numSlots; slot++)
+		{
+			const Range& range = ranges[slot];
+
+			if (fileID >= range.firstFileID && fileID < range.firstNotFileID)
+				return {static_cast<u16>(slot), static_cast<u16>(fileID - range.firstFileID), IsLoaded(slot)};
+		}
+
+		return {Location::NONE, 0, false};
+	}
+
+public:
+	Stats stats = {};
+
+	template<class ArchiveT = Archive, class Info, std::size_t N>
+	void Rebuild(const Info (&infos)[N])
+	{
+		static_assert(N <= MAX_SLOTS);
+
+		numSlots = N;
+		fatOf = &FatOf<ArchiveT>;
+		u32 lowest = 0xffff, highest = 0;
+
+		for (u32 slot = 0; slot < N; slot++)
+		{
+			ranges[slot] = {infos[slot].firstFileID, infos[slot].firstNotFileID, &infos[slot].archive};
+
+			if (ranges[slot].firstFileID >= ranges[slot].firstNotFileID) continue;
+
+			if (ranges[slot].firstFileID < lowest) lowest = ranges[slot].firstFileID;
+			if (ranges[slot].firstNotFileID > highest) highest = ranges[slot].firstNotFileID;
+		}
+
+		if (lowest > highest)
+			lowest = highest = 0;
+
+		firstFileID = lowest;
+		firstNotFileID = highest;
+		numEntries = highest - lowest < CAPACITY ? highest - lowest : CAPACITY;
+
+		for (u32 i = 0; i < numEntries; i++)
+			entries[i] = NO_ARCHIVE;
+
+		for (u32 slot = 0; slot < N; slot++)
+			Fill(slot);
+	}
+
+	[[nodiscard]] Location Resolve(u32 fileID)
+	{
+		stats.numLookups++;
+
+		const u32 i = fileID - firstFileID; // wraps around if fileID < firstFileID
+		Location res;
+
+		if (i < numEntries && entries[i] != FALLBACK)
+		{
+			const u16 entry = entries[i];
+			const u16 slot = entry >> SLOT_SHIFT;
+
+			res = entry == NO_ARCHIVE ? Location{Location::NONE, 0, false} :
+				Location{slot, static_cast<u16>(entry & FAT_INDEX_MASK), IsLoaded(slot)};
+		}
+		else if (fileID >= firstFileID && fileID < firstNotFileID)
+		{
+			stats.numFallbacks++;
+			res = Search(fileID);
+		}
+		else
+			res = {Location::NONE, 0, false};
+
+		if (!res.IsInArchive())
+			stats.numNotInArchive++;
+		else if (res.resident)
+			stats.numResident++;
+		else
+			stats.numNotResident++;
+
+		return res;
+	}
+
+	[[nodiscard]] bool IsResident(u32 fileID) { return Resolve(fileID).IsResident(); }
+
+	// nullptr if the file isn't in a resident archive
+	[[nodiscard]] const FatEntry* GetFatEntry(u32 fileID)
+	{
+		const Location location = Resolve(fileID);
+
+		return location.IsResident() ? &fatOf(*ranges[location.slot].archive)[location.fatIndex] : nullptr;
+	}
+
+	// The number of file IDs the table covers, the others fall back to searching
+	[[nodiscard]] u32 NumIndexed() const { return numEntries; }
+
+	void ResetStats() { stats = {}; }
+};
+
+inline constinit ArchiveIndex ARCHIVE_INDEX;
@@ -0,0 +1,269 @@
+#pragma once
+
+#include "../Formats/NARC_File.h"
+#include <algorithm>
+#include <span>
+#include <vector>
+
+/*
+	INFORMATION
+	Host-side tool (it isn't included by SM64DS_PI.h) that rewrites an archive so that its files are
+	stored in the order a level first loads them, which turns the seeks between them into one
+	sequential read. The FAT indices, and so the file IDs of FileList.h, stay the same: only the
+	offsets in the FAT and the order of the file images change, and the FNT is copied as is.
+
+		std::vector<u16> trace = ...; // file IDs in the order LoadFile/LoadFileAt requested them
+		std::vector<u8> packed;
+		ArchivePacker::Report report = ArchivePacker::Repack(narc, trace, firstFileID, packed); // of its ArchiveInfo
+
+	Files that aren't in the trace keep their order after the ones that are. The report replays the
+	trace against both layouts: a read that doesn't start where the previous one ended (give or take
+	the alignment padding) is a seek, and consecutive reads without a seek could be one card command.
+	tests/ArchivePackerTest.cpp round trips synthetic archives through it.
+*/
+
+namespace ArchivePacker
+{
+	struct Unpacked
+	{
+		std::vector<u8> fnt; // the whole section, header included
+		std::vector<std::vector<u8>> files; // by FAT index
+		std::vector<u16> layout;            // FAT indices in the order their images are stored
+	};
+
+	struct AccessCost
+	{
+		u32 numReads = 0;
+		u32 numSeeks = 0;
+		u32 numCommands = 0; // reads merged while there is no seek between them
+		u64 seekDistance = 0;
+		u64 bytesRead = 0;
+	};
+
+	struct Report
+	{
+		AccessCost before;
+		AccessCost after;
+	};
+
+	namespace Internal
+	{
+		inline u32 ReadU16(std::span<const u8> data, u32 offset) { return data[offset] | data[offset + 1] << 8; }
+		inline u32 ReadU32(std::span<const u8> data, u32 offset) { return ReadU16(data, offset) | ReadU16(data, offset + 2) << 16; }
+
+		inline void WriteU16(std::vector<u8>& data, u32 value)
+		{
+			data.push_back(value);
+			data.push_back(value >> 8);
+		}
+
+		inline void WriteU32(std::vector<u8>& data, u32 value)
+		{
+			WriteU16(data, value);
+			WriteU16(data, value >> 16);
+		}
+
+		inline bool HasMagic(std::span<const u8> data, u64 offset, const char (&magic)[5])
+		{
+			return offset + 4 <= data.size() && std::equal(magic, magic + 4, data.begin() + offset);
+		}
+
+		inline void WriteMagic(std::vector<u8>& data, const char (&magic)[5])
+		{
+			for (u32 i = 0; i < 4; i++)
+				data.push_back(magic[i]);
+		}
+
+		inline std::vector<NARC_File::FatEntry> ReadFAT(std::span<const u8> narc)
+		{
+			const u32 numFiles = ReadU16(narc, 0x18);
+			std::vector<NARC_File::FatEntry> res(numFiles);
+
+			for (u32 i = 0; i < numFiles; i++)
+				res[i] = {ReadU32(narc, 0x1c + 8 * i), ReadU32(narc, 0x20 + 8 * i)};
+
+			return res;
+		}
+	}
+
+	// Returns false if narc isn't a valid archive
+	inline bool Unpack(std::span<const u8> narc, Unpacked& res)
+	{
+		using namespace Internal;
+
+		if (narc.size() < 0x10 + 0xc || !HasMagic(narc, 0, "NARC") || !HasMagic(narc, 0x10, "BTAF"))
+			return false;
+
+		// the offsets are sums of sizes read from the file, so they're checked in u64 where they can't wrap
+		const u32 fatSize = ReadU32(narc, 0x14);
+		const u32 numFiles = ReadU16(narc, 0x18);
+		const u64 fntOffset = 0x10 + u64{fatSize};
+
+		if (fatSize < 0xc + 8 * numFiles || !HasMagic(narc, fntOffset, "BTNF") || fntOffset + 8 > narc.size())
+			return false;
+
+		const u64 imagesOffset = fntOffset + ReadU32(narc, fntOffset + 4);
+
+		if (!HasMagic(narc, imagesOffset, "GMIF") || imagesOffset + 8 > narc.size())
+			return false;
+
+		// the section size includes its 8 byte header
+		const u32 gmifSize = ReadU32(narc, imagesOffset + 4);
+		const u64 dataOffset = imagesOffset + 8;
+
+		if (gmifSize < 8 || imagesOffset + gmifSize > narc.size())
+			return false;
+
+		const u32 imagesSize = gmifSize - 8;
+
+		const std::vector<NARC_File::FatEntry> fat = ReadFAT(narc);
+
+		res.fnt.assign(narc.begin() + fntOffset, narc.begin() + imagesOffset);
+		res.files.assign(numFiles, {});
+		res.layout.resize(numFiles);
+
+		for (u32 i = 0; i < numFiles; i++)
+		{
+			if (fat[i].start > fat[i].end || fat[i].end > imagesSize)
+				return false;
+
+			res.files[i].assign(narc.begin() + dataOffset + fat[i].start, narc.begin() + dataOffset + fat[i].end);
+			res.layout[i] = i;
+		}
+
+		std::stable_sort(res.layout.begin(), res.layout.end(), [&](u16 a, u16 b) { return fat[a].start < fat[b].start; });
+
+		return true;
+	}
+
+	// Stores the file images in the order of layout, which must contain every FAT index once
+	inline std::vector<u8> Pack(const Unpacked& archive, std::span<const u16> layout, u32 alignment = 4, u8 padding = 0xff)
+	{
+		using namespace Internal;
+
+		const u32 numFiles = archive.files.size();
+		std::vector<NARC_File::FatEntry> fat(numFiles);
+		std::vector<u8> images;
+
+		for (u16 index : layout)
+		{
+			while (images.size() % alignment != 0)
+				images.push_back(padding);
+
+			fat[index].start = images.size();
+			images.insert(images.end(), archive.files[index].begin(), archive.files[index].end());
+			fat[index].end = images.size();
+		}
+
+		while (images.size() % alignment != 0)
+			images.push_back(padding);
+
+		const u32 fatSize = 0xc + 8 * numFiles;
+		const u32 fileSize = 0x10 + fatSize + archive.fnt.size() + 8 + images.size();
+
+		std::vector<u8> res;
+		res.reserve(fileSize);
+
+		WriteMagic(res, "NARC");
+		WriteU16(res, 0xfffe);
+		WriteU16(res, 0x0100);
+		WriteU32(res, fileSize);
+		WriteU16(res, 0x10);
+		WriteU16(res, 3);
+
+		WriteMagic(res, "BTAF");
+		WriteU32(res, fatSize);
+		WriteU16(res, numFiles);
+		WriteU16(res, 0);
+
+		for (const NARC_File::FatEntry& entry : fat)
+		{
+			WriteU32(res, entry.start);
+			WriteU32(res, entry.end);
+		}
+
+		res.insert(res.end(), archive.fnt.begin(), archive.fnt.end());
+
+		WriteMagic(res, "GMIF");
+		WriteU32(res, 8 + images.size());
+		res.insert(res.end(), images.begin(), images.end());
+
+		return res;
+	}
+
+	// The FAT indices of the traced files in the order of their first use, then the others in the
+	// order of layout. File IDs outside of the archive are ignored.
+	inline std::vector<u16> FirstUseOrder(std::span<const u16> trace, u32 firstFileID, std::span<const u16> layout)
+	{
+		const u32 numFiles = layout.size();
+		std::vector<bool> placed(numFiles, false);
+		std::vector<u16> res;
+		res.reserve(numFiles);
+
+		for (u16 fileID : trace)
+		{
+			const u32 index = fileID - firstFileID;
+
+			if (fileID >= firstFileID && index < numFiles && !placed[index])
+			{
+				placed[index] = true;
+				res.push_back(index);
+			}
+		}
+
+		for (u16 index : layout)
+			if (!placed[index]) res.push_back(index);
+
+		return res;
+	}
+
+	// Replays the trace against the FAT of narc, which must be valid
+	inline AccessCost Simulate(std::span<const u8> narc, std::span<const u16> trace, u32 firstFileID, u32 alignment = 4)
+	{
+		const std::vector<NARC_File::FatEntry> fat = Internal::ReadFAT(narc);
+
+		AccessCost res;
+		bool first = true;
+		u32 prevEnd = 0;
+
+		for (u16 fileID : trace)
+		{
+			const u32 index = fileID - firstFileID;
+			if (fileID < firstFileID || index >= fat.size()) continue;
+
+			const NARC_File::FatEntry& entry = fat[index];
+			const u32 gap = entry.start >= prevEnd ? entry.start - prevEnd : prevEnd - entry.start;
+
+			if (first || entry.start < prevEnd || gap >= alignment)
+			{
+				if (!first)
+				{
+					res.numSeeks++;
+					res.seekDistance += gap;
+				}
+
+				res.numCommands++;
+			}
+
+			res.numReads++;
+			res.bytesRead += entry.end - entry.start;
+			prevEnd = entry.end;
+			first = false;
+		}
+
+		return res;
+	}
+
+	// Returns an empty report and leaves res empty if narc isn't a valid archive
+	inline Report Repack(std::span<const u8> narc, std::span<const u16> trace, u32 firstFileID, std::vector<u8>& res)
+	{
+		Unpacked archive;
+		res.clear();
+
+		if (!Unpack(narc, archive)) return {};
+
+		res = Pack(archive, FirstUseOrder(trace, firstFileID, archive.layout));
+
+		return {Simulate(narc, trace, firstFileID), Simulate(res, trace, firstFileID)};
+	}
+}
@@ -0,0 +1,499 @@
+#pragma once
+
+#include "../SM64DS_PI.h"
+#include "OverlayProfileFormat.h"
+#include <span>
+
+/*
+	INFORMATION
+	A replacement for FS_LoadOverlay that times each phase of loading an overlay, and can take the
+	image from a staging buffer that OVERLAY_PRELOADER filled in the frames before, instead of reading
+	it from the card while the screen is black. Since FS_LoadOverlay has to be replaced by a patch
+	anyway, this header isn't included by SM64DS_PI.h, only by the file that replaces it:
+
+		#include "FileSystem/OverlayLoader.h"
+
+		// branched to from FS_LoadOverlay (0x02018ad0), which LoadOverlay calls for the level and
+		// actor bank overlays (LEVEL_OVL_MAP, ACTOR_BANK_OVL_MAP)
+		bool LoadOverlayPatch(bool isArm7, u32 ovID) { return OverlayLoader::Load(isArm7, ovID); }
+
+	Load does what FS_LoadOverlay does, one phase at a time (see OverlayProfileFormat::Phase):
+	LoadOverlayInfo and the FAT entry of the image, the card read (or the copy from the staging
+	buffer), the decompression of compressed overlays (Formats/BackwardLZ.h), clearing the bss, and
+	the static initializers between staticInitializerBegin and staticInitializerEnd after the caches
+	are flushed. Only the bss is cleared instead of the whole overlay, since the image overwrites the
+	rest. OVERLAY_PROFILER keeps the last CAPACITY loads; Dump prints them for
+	FileSystem/OverlayProfileReport.h:
+
+		OVERLAY_PROFILER.Dump(cout);
+
+	OVERLAY_PRELOADER is optional. It reads the overlays of the next level into a buffer a few
+	kilobytes per frame, e.g. while the star select screen is shown or the screen fades out:
+
+		alignas(4) static u8 staging[0x40000]; // or a block on the root heap that outlives the scene change
+
+		// when the next level is known
+		OVERLAY_PRELOADER.SetBuffer(staging);
+		OVERLAY_PRELOADER.StageLevel(NEXT_LEVEL_ID);
+
+		// every frame until the level is loaded
+		OVERLAY_PRELOADER.Update();
+
+		// once it's loaded, so that nothing is taken from the buffer after it's gone
+		OVERLAY_PRELOADER.SetBuffer({});
+
+	The actor bank settings of a level are in its level overlay, so the actor bank overlays of a
+	level aren't known before it's loaded. Instead, the preloader remembers the overlays that were
+	loaded after the overlay of each level, up to MAX_LEARNED of them, and StageLevel stages the ones
+	of the last visit. Actor bank overlays that stay loaded between two levels aren't loaded again,
+	so they aren't remembered either, and a level overlay that several levels share belongs to the
+	first of them in LEVEL_OVL_MAP.
+
+	An overlay that is still being read when it's loaded has the rest of its image read from the card
+	by Load, so staging never makes a load slower than reading the whole image would.
+*/
+
+namespace OverlayLoader
+{
+	static constexpr u32 ROM_HEADER = 0x027ffe00; // the mirror of the ROM header in main RAM
+	static constexpr u32 ROM_HEADER_FAT_OFFSET = 0x48;
+	static constexpr u32 CARD_PAGE_SIZE = 0x200;
+	static constexpr u32 CACHE_LINE_SIZE = 32;
+
+	struct RomRange
+	{
+		u32 start;
+		u32 end; // one past the last byte
+	};
+
+	// Reads the FAT entry of the file from the card
+	inline RomRange GetRomRange(u32 fileID)
+	{
+		const u32 fatAddress = *reinterpret_cast<const u32*>(ROM_HEADER + ROM_HEADER_FAT_OFFSET);
+
+		RomRange res;
+		OSReadROMArea(fatAddress + sizeof(RomRange) * fileID, reinterpret_cast<uintptr_t>(&res), sizeof(res));
+
+		return res;
+	}
+
+	// OverlayInfo::unk1c is the compressed size in bits 0-23 and flags in bits 24-31, like in the
+	// overlay table of the NitroSDK
+	inline bool IsCompressed(const OverlayInfo& info) { return (info.unk1c >> 24 & 1) != 0; }
+
+	// The level whose overlay it is (the first one in LEVEL_OVL_MAP), -1 if it isn't a level overlay
+	inline s32 LevelOf(u32 ovID)
+	{
+		for (s32 levelID = 0; levelID < NUM_LEVELS; levelID++)
+			if (LEVEL_OVL_MAP[levelID] == static_cast<s32>(ovID)) return levelID;
+
+		return -1;
+	}
+
+	// Writes back and invalidates the lines of the data cache that hold the range, like DC_FlushRange
+	inline void FlushDataCache(const void* start, u32 size)
+	{
+#ifdef __arm__
+		const uintptr_t end = reinterpret_cast<uintptr_t>(start) + size;
+
+		for (uintptr_t line = reinterpret_cast<uintptr_t>(start) & ~(CACHE_LINE_SIZE - 1); line < end; line += CACHE_LINE_SIZE)
+			asm volatile("mcr p15, 0, %0, c7, c14, 1" :: "r" (line) : "memory");
+
+		asm volatile("mcr p15, 0, %0, c7, c10, 4" :: "r" (0) : "memory"); // drain the write buffer
+#endif
+	}
+
+	// Like IC_InvalidateRange
+	inline void InvalidateInstructionCache(const void* start, u32 size)
+	{
+#ifdef __arm__
+		const uintptr_t end = reinterpret_cast<uintptr_t>(start) + size;
+
+		for (uintptr_t line = reinterpret_cast<uintptr_t>(start) & ~(CACHE_LINE_SIZE - 1); line < end; line += CACHE_LINE_SIZE)
+			asm volatile("mcr p15, 0, %0, c7, c5, 1" :: "r" (line) : "memory");
+#endif
+	}
+
+	inline constinit s32 lastLevelID = -1; // of the level overlay that was loaded last
+
+	inline bool Load(bool isArm7, u32 ovID); // defined after OVERLAY_PRELOADER
+}
+
+class OverlayProfiler
+{
+public:
+	static constexpr u32 CAPACITY = 64;
+
+	using Record = OverlayProfileFormat::Record;
+	using Phase = OverlayProfileFormat::Phase;
+
+private:
+	Record records[CAPACITY] = {};
+	u32 numLoads = 0; // in total, only the last CAPACITY are kept
+	Timer timer = {};
+
+public:
+	bool enabled = true;
+
+	// nullptr if the profiler isn't enabled
+	Record* Begin(u32 ovID, s32 levelID)
+	{
+		if (!enabled) return nullptr;
+
+		Record& res = records[numLoads++ % CAPACITY];
+		res = {};
+		res.ovID = ovID;
+		res.levelID = levelID < 0 ? OverlayProfileFormat::NO_LEVEL : levelID;
+		res.frame = FRAME_COUNTER;
+
+		return &res;
+	}
+
+	void StartPhase(Record* record)
+	{
+		if (!record) return;
+
+		timer.ResetTimer();
+		timer.StartTimer();
+	}
+
+	void EndPhase(Record* record, Phase phase)
+	{
+		if (!record) return;
+
+		timer.StopTimer();
+		record->ticks[phase] += timer.GetTime();
+	}
+
+	[[nodiscard]] u32 NumLoads() const { return numLoads; }
+	[[nodiscard]] u32 NumRecords() const { return numLoads < CAPACITY ? numLoads : CAPACITY; }
+
+	// The oldest record that is kept first
+	[[nodiscard]] const Record& GetRecord(u32 index) const
+	{
+		return records[(numLoads - NumRecords() + index) % CAPACITY];
+	}
+
+	void Clear() { numLoads = 0; }
+
+	void Dump(const ostream& os) const
+	{
+		char line[OverlayProfileFormat::LINE_SIZE + 1];
+
+		for (u32 i = 0; i < NumRecords(); i++)
+		{
+			OverlayProfileFormat::FormatLine(GetRecord(i), line);
+			os << static_cast<const char*>(line);
+		}
+
+		os << "OVLP end, " << numLoads << " loads, " << (numLoads - NumRecords()) << " dropped\n";
+	}
+};
+
+inline constinit OverlayProfiler OVERLAY_PROFILER;
+
+class OverlayPreloader
+{
+public:
+	static constexpr u32 MAX_STAGED = 8;
+	static constexpr u32 MAX_LEARNED = 7; // as many as there are actor banks
+	static constexpr u32 DEFAULT_BYTES_PER_FRAME = 0x4000;
+
+	struct Stats
+	{
+		u32 numStaged;
+		u32 numHits;        // loads that took the whole image from the buffer
+		u32 numPartialHits; // loads that had to read the rest of the image
+		u32 numDropped;     // overlays that didn't fit
+		u32 bytesPreloaded;
+	};
+
+private:
+	static constexpr u16 TAKEN = 0xffff;
+
+	struct Staged
+	{
+		u16 ovID; // TAKEN once Load copied it
+		u32 romStart;
+		u32 size;
+		u32 offset; // in the buffer
+		u32 numRead;
+	};
+
+	u8* buffer = nullptr;
+	u32 capacity = 0;
+	u32 used = 0;
+	Staged staged[MAX_STAGED] = {};
+	u32 numStaged = 0;
+
+	u16 learned[NUM_LEVELS][MAX_LEARNED] = {};
+	u8 numLearned[NUM_LEVELS] = {};
+
+	Staged* Find(u32 ovID)
+	{
+		for (u32 i = 0; i < numStaged; i++)
+			if (staged[i].ovID == ovID) return &staged[i];
+
+		return nullptr;
+	}
+
+public:
+	Stats stats = {};
+
+	// Drops everything that was staged. The start is rounded up to a multiple of 4, since Take copies words.
+	void SetBuffer(std::span<u8> newBuffer)
+	{
+		const u32 skip = -reinterpret_cast<uintptr_t>(newBuffer.data()) & 3;
+
+		buffer = newBuffer.data() + (newBuffer.size() > skip ? skip : 0);
+		capacity = newBuffer.size() > skip ? newBuffer.size() - skip : 0;
+		Clear();
+	}
+
+	void Clear()
+	{
+		used = 0;
+		numStaged = 0;
+	}
+
+	// Returns false if the overlay doesn't exist or doesn't fit
+	bool Stage(u32 ovID)
+	{
+		if (Find(ovID)) return true;
+
+		OverlayInfo info;
+		if (!LoadOverlayInfo(info, false, ovID)) return false;
+
+		const OverlayLoader::RomRange range = OverlayLoader::GetRomRange(info.fileID);
+		const u32 offset = (used + 3) & ~3;
+
+		if (numStaged == MAX_STAGED || range.end <= range.start || offset + (range.end - range.start) > capacity)
+		{
+			stats.numDropped++;
+			return false;
+		}
+
+		staged[numStaged++] = {static_cast<u16>(ovID), range.start, range.end - range.start, offset, 0};
+		used = offset + (range.end - range.start);
+		stats.numStaged++;
+
+		return true;
+	}
+
+	// Stages the level overlay and the overlays that were loaded after it the last time,
+	// returns the number of them that are staged
+	u32 StageLevel(s32 levelID)
+	{
+		if (levelID < 0 || levelID >= NUM_LEVELS || LEVEL_OVL_MAP[levelID] < 0) return 0;
+
+		u32 res = Stage(LEVEL_OVL_MAP[levelID]);
+		const s32 learnedID = OverlayLoader::LevelOf(LEVEL_OVL_MAP[levelID]);
+
+		for (u32 i = 0; i < numLearned[learnedID]; i++)
+			res += Stage(learned[learnedID][i]);
+
+		return res;
+	}
+
+	// Reads up to maxBytes of the staged overlays, returns true once all of them are read
+	bool Update(u32 maxBytes = DEFAULT_BYTES_PER_FRAME)
+	{
+		u32 budget = maxBytes;
+
+		for (u32 i = 0; i < numStaged && budget != 0; i++)
+		{
+			Staged& entry = staged[i];
+			if (entry.ovID == TAKEN || entry.numRead == entry.size) continue;
+
+			const u32 romAddress = entry.romStart + entry.numRead;
+			u32 chunk = entry.size - entry.numRead;
+
+			if (chunk > budget)
+			{
+				// end on a page, so that the next read doesn't start in the middle of one
+				const u32 past = (romAddress + budget) & (OverlayLoader::CARD_PAGE_SIZE - 1);
+				chunk = budget > past ? budget - past : budget;
+			}
+
+			OSReadROMArea(romAddress, reinterpret_cast<uintptr_t>(buffer + entry.offset + entry.numRead), chunk);
+			entry.numRead += chunk;
+			budget -= chunk;
+			stats.bytesPreloaded += chunk;
+		}
+
+		for (u32 i = 0; i < numStaged; i++)
+			if (staged[i].ovID != TAKEN && staged[i].numRead != staged[i].size) return false;
+
+		return true;
+	}
+
+	// The size of the image of the overlay, 0 if it isn't staged
+	[[nodiscard]] u32 StagedSize(u32 ovID)
+	{
+		const Staged* entry = Find(ovID);
+		return entry ? entry->size : 0;
+	}
+
+	// Copies the staged image to dest and reads the part that wasn't read yet. Returns the flags of
+	// OverlayProfileFormat for the record of the load, 0 if the overlay isn't staged.
+	u8 Take(u32 ovID, u8* dest)
+	{
+		Staged* entry = Find(ovID);
+		if (!entry) return 0;
+
+		const u8* src = buffer + entry->offset;
+		const u32 aligned = ((reinterpret_cast<uintptr_t>(src) | reinterpret_cast<uintptr_t>(dest)) & 3) == 0 ? entry->numRead & ~3 : 0;
+
+		CpuCopy32(src, dest, aligned);
+		CpuCopy8(src + aligned, dest + aligned, entry->numRead - aligned);
+
+		u8 res = OverlayProfileFormat::STAGED;
+
+		if (entry->numRead != entry->size)
+		{
+			OSReadROMArea(entry->romStart + entry->numRead, reinterpret_cast<uintptr_t>(dest + entry->numRead), entry->size - entry->numRead);
+			res = OverlayProfileFormat::PARTIALLY_STAGED;
+			stats.numPartialHits++;
+		}
+		else
+			stats.numHits++;
+
+		entry->ovID = TAKEN;
+
+		bool allTaken = true;
+
+		for (u32 i = 0; i < numStaged; i++)
+			allTaken &= staged[i].ovID == TAKEN;
+
+		if (allTaken) Clear();
+
+		return res;
+	}
+
+	// Called by Load for every overlay that is loaded
+	void Learn(u32 ovID)
+	{
+		const s32 levelID = OverlayLoader::LevelOf(ovID);
+
+		if (levelID >= 0)
+		{
+			numLearned[levelID] = 0;
+			return;
+		}
+
+		const s32 lastLevelID = OverlayLoader::lastLevelID;
+		if (lastLevelID < 0 || numLearned[lastLevelID] == MAX_LEARNED) return;
+
+		for (u32 i = 0; i < numLearned[lastLevelID]; i++)
+			if (learned[lastLevelID][i] == ovID) return;
+
+		learned[lastLevelID][numLearned[lastLevelID]++] = ovID;
+	}
+
+	void Dump(const ostream& os) const
+	{
+		os << "overlay preloader: " << stats.numStaged << " staged, " << stats.numHits << " hits, "
+		   << stats.numPartialHits << " partial hits, " << stats.numDropped << " dropped, "
+		   << stats.bytesPreloaded << " bytes preloaded\n";
+	}
+};
+
+inline constinit OverlayPreloader OVERLAY_PRELOADER;
+
+bool OverlayLoader::Load(bool isArm7, u32 ovID)
+{
+	using namespace OverlayProfileFormat;
+
+	if (!isArm7)
+	{
+		if (const s32 levelID = LevelOf(ovID); levelID >= 0)
+			lastLevelID = levelID;
+
+		OVERLAY_PRELOADER.Learn(ovID);
+	}
+
+	OverlayProfiler& profiler = OVERLAY_PROFILER;
+	OverlayProfiler::Record* record = profiler.Begin(ovID, lastLevelID);
+
+	profiler.StartPhase(record);
+
+	OverlayInfo info;
+	const bool found = LoadOverlayInfo(info, isArm7, ovID);
+
+	u8* const image = static_cast<u8*>(info.loadAddress);
+	RomRange range = {};
+	u32 imageSize = found && !isArm7 ? OVERLAY_PRELOADER.StagedSize(ovID) : 0;
+
+	if (found && imageSize == 0)
+	{
+		range = GetRomRange(info.fileID);
+		imageSize = range.end - range.start;
+	}
+
+	profiler.EndPhase(record, INFO);
+
+	if (!found || range.end < range.start || imageSize > info.loadSize + info.bssSize)
+	{
+		if (record) record->flags |= FAILED;
+		return false;
+	}
+
+	if (record)
+	{
+		record->imageSize = imageSize;
+		record->loadSize = info.loadSize;
+		record->bssSize = info.bssSize;
+		record->numStaticInitializers = reinterpret_cast<void (**)()>(info.staticInitializerEnd) -
+			reinterpret_cast<void (**)()>(info.staticInitializerBegin);
+	}
+
+	profiler.StartPhase(record);
+
+	// the old lines of the overlay area mustn't be written back over the new image later
+	FlushDataCache(image, info.loadSize + info.bssSize);
+
+	const u8 staged = isArm7 ? 0 : OVERLAY_PRELOADER.Take(ovID, image);
+
+	if (!staged)
+		OSReadROMArea(range.start, reinterpret_cast<uintptr_t>(image), imageSize);
+
+	profiler.EndPhase(record, READ);
+
+	if (record) record->flags |= staged;
+
+	if (IsCompressed(info))
+	{
+		profiler.StartPhase(record);
+		const bool decompressed = BackwardLZ::Decompress(image, imageSize);
+		profiler.EndPhase(record, DECOMPRESS);
+
+		if (record) record->flags |= COMPRESSED | (decompressed ? 0 : FAILED);
+		if (!decompressed) return false;
+	}
+
+	profiler.StartPhase(record);
+
+	u8* const bss = image + info.loadSize;
+
+	if (((reinterpret_cast<uintptr_t>(bss) | info.bssSize) & 3) == 0)
+		CpuFill32(0, bss, info.bssSize);
+	else
+		CpuFill8(bss, 0, info.bssSize);
+
+	profiler.EndPhase(record, CLEAR_BSS);
+
+	profiler.StartPhase(record);
+
+	FlushDataCache(image, info.loadSize + info.bssSize);
+	InvalidateInstructionCache(image, info.loadSize);
+
+	for (auto init = reinterpret_cast<void (**)()>(info.staticInitializerBegin);
+		init < reinterpret_cast<void (**)()>(info.staticInitializerEnd); init++)
+	{
+		if (*init) (*init)();
+	}
+
+	profiler.EndPhase(record, STATIC_INIT);
+
+	return true;
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include "../Math/MathCommon.h"
+
+/*
+	INFORMATION
+	The records of OVERLAY_PROFILER, shared by OverlayLoader.h (in game) and OverlayProfileReport.h
+	(on the host). OverlayProfiler::Dump prints one line per load through the debug console:
+
+		OVLP oooo ff ll frameNum imgsiz ldsize bsssiz nini infoTick readTick decoTick bss_Tick initTick
+
+	all fields in hex with a fixed width: the overlay ID, the flags, the level whose overlay was
+	loaded last (ff if none), the frame, the size of the image read from the card (compressed if
+	the overlay is), the load size, the bss size, the number of static initializers and the time
+	each phase took, in the ticks that Timer counts.
+*/
+
+namespace OverlayProfileFormat
+{
+	enum Phase : u8
+	{
+		INFO,        // LoadOverlayInfo and the FAT entry of the image
+		READ,        // from the card, or from the staging buffer of the preloader
+		DECOMPRESS,
+		CLEAR_BSS,
+		STATIC_INIT, // including flushing the data cache and invalidating the instruction cache
+
+		NUM_PHASES
+	};
+
+	enum Flags : u8
+	{
+		COMPRESSED       = 1 << 0,
+		STAGED           = 1 << 1, // the whole image was already in the staging buffer
+		PARTIALLY_STAGED = 1 << 2, // the rest of the image was read when the overlay was loaded
+		FAILED           = 1 << 3,
+	};
+
+	static constexpr u8 NO_LEVEL = 0xff;
+
+	struct Record
+	{
+		u16 ovID;
+		u8 flags;
+		u8 levelID;
+		u32 frame;
+		u32 imageSize;
+		u32 loadSize;
+		u32 bssSize;
+		u16 numStaticInitializers;
+		u32 ticks[NUM_PHASES];
+
+		[[nodiscard]] u32 TotalTicks() const
+		{
+			u32 res = 0;
+
+			for (u32 t : ticks)
+				res += t;
+
+			return res;
+		}
+	};
+
+	static constexpr char PREFIX[] = "OVLP ";
+
+	// the number of hex digits of each field, in the order of the line
+	static constexpr u8 FIELD_WIDTHS[] = {4, 2, 2, 8, 6, 6, 6, 4, 8, 8, 8, 8, 8};
+	static constexpr u32 NUM_FIELDS = sizeof(FIELD_WIDTHS);
+
+	static_assert(NUM_FIELDS == 8 + NUM_PHASES);
+
+	consteval u32 LineSize()
+	{
+		u32 res = sizeof(PREFIX) - 1;
+
+		for (u8 width : FIELD_WIDTHS)
+			res += width + 1; // a space or '\n' after each field
+
+		return res;
+	}
+
+	static constexpr u32 LINE_SIZE = LineSize();
+
+	static_assert(LINE_SIZE < 120, "a line must fit in the buffer of ostream");
+
+	inline void Fields(const Record& record, u32 (&res)[NUM_FIELDS])
+	{
+		const u32 fields[] = {record.ovID, record.flags, record.levelID, record.frame, record.imageSize,
+			record.loadSize, record.bssSize, record.numStaticInitializers};
+
+		for (u32 i = 0; i < 8; i++) res[i] = fields[i];
+		for (u32 i = 0; i < NUM_PHASES; i++) res[8 + i] = record.ticks[i];
+	}
+
+	// Writes LINE_SIZE characters and a '\0'. Values too large for their field are cut off.
+	inline void FormatLine(const Record& record, char* line)
+	{
+		static constexpr char digits[] = "0123456789abcdef";
+
+		u32 fields[NUM_FIELDS];
+		Fields(record, fields);
+
+		for (u32 i = 0; i < sizeof(PREFIX) - 1; i++)
+			*line++ = PREFIX[i];
+
+		for (u32 i = 0; i < NUM_FIELDS; i++)
+		{
+			for (s32 shift = 4 * (FIELD_WIDTHS[i] - 1); shift >= 0; shift -= 4)
+				*line++ = digits[fields[i] >> shift & 0xf];
+
+			*line++ = i == NUM_FIELDS - 1 ? '\n' : ' ';
+		}
+
+		*line = '\0';
+	}
+
+	// Reads the fields after PREFIX, returns false if the line is cut off or isn't hex
+	inline bool ParseFields(const char* fields, Record& res)
+	{
+		u32 values[NUM_FIELDS];
+
+		for (u32 i = 0; i < NUM_FIELDS; i++)
+		{
+			values[i] = 0;
+
+			for (u32 j = 0; j < FIELD_WIDTHS[i]; j++, fields++)
+			{
+				const char c = *fields;
+				const s32 digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+
+				if (digit < 0) return false;
+				values[i] = values[i] << 4 | digit;
+			}
+
+			if (i != NUM_FIELDS - 1 && *fields++ != ' ') return false;
+		}
+
+		res.ovID = values[0];
+		res.flags = values[1];
+		res.levelID = values[2];
+		res.frame = values[3];
+		res.imageSize = values[4];
+		res.loadSize = values[5];
+		res.bssSize = values[6];
+		res.numStaticInitializers = values[7];
+
+		for (u32 i = 0; i < NUM_PHASES; i++)
+			res.ticks[i] = values[8 + i];
+
+		return true;
+	}
+}
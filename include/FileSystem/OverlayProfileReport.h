@@ -0,0 +1,217 @@
+#pragma once
+
+#include "OverlayProfileFormat.h"
+#include <algorithm>
+#include <istream>
+#include <string>
+#include <vector>
+
+/*
+	INFORMATION
+	Host-side report of the loads that OVERLAY_PROFILER recorded (it isn't included by SM64DS_PI.h):
+
+		std::vector<OverlayProfileFormat::Record> records = ParseOverlayProfileDump(logFile); // the "OVLP " lines
+		OverlayProfileReport report(records);
+
+		report.transitions;        // the loads of each scene change and the time of each phase
+		report.overlays;           // per overlay: loads, average and worst time, card read speed
+		report.EstimateStaging();  // how much of the read time OVERLAY_PRELOADER could save
+
+	Loads at most MAX_FRAME_GAP frames apart belong to the same transition, since a scene change
+	loads its overlays back to back. Times are in microseconds, converted from the ticks of Timer at
+	the rate given to the constructor, by default the one of the OS tick (the bus clock / 64).
+	tests/OverlayProfileTest.cpp round trips random records through a log and the report.
+*/
+
+inline std::vector<OverlayProfileFormat::Record> ParseOverlayProfileDump(std::istream& is)
+{
+	using namespace OverlayProfileFormat;
+
+	std::vector<Record> res;
+	std::string line;
+
+	while (std::getline(is, line))
+	{
+		const std::size_t start = line.find(PREFIX);
+		if (start == std::string::npos) continue;
+
+		Record record;
+
+		if (ParseFields(line.c_str() + start + sizeof(PREFIX) - 1, record))
+			res.push_back(record);
+	}
+
+	return res;
+}
+
+class OverlayProfileReport
+{
+public:
+	using Record = OverlayProfileFormat::Record;
+
+	static constexpr u32 NUM_PHASES = OverlayProfileFormat::NUM_PHASES;
+	static constexpr u32 MAX_FRAME_GAP = 2;
+	static constexpr double TICKS_PER_SECOND = 33513982.0 / 64;
+
+	struct Transition
+	{
+		u32 firstFrame;
+		u32 lastFrame;
+		u8 levelID;     // of the last level overlay loaded in it, or before it
+		u32 numLoads = 0;
+		u32 numStaged = 0; // in part or in whole
+		u32 numFailed = 0;
+		u64 imageBytes = 0;
+		double micros[NUM_PHASES] = {};
+		double totalMicros = 0;
+	};
+
+	struct Overlay
+	{
+		u16 ovID;
+		u32 numLoads = 0;
+		u32 numStaged = 0;
+		u32 imageSize = 0;  // of the last load
+		u32 loadSize = 0;
+		u32 bssSize = 0;
+		bool compressed = false;
+		double averageMicros[NUM_PHASES] = {};
+		double worstTotalMicros = 0;
+		double cardBytesPerSecond = 0; // of the loads that read the whole image from the card
+	};
+
+	struct StagingEstimate
+	{
+		u32 numCardLoads = 0;        // loads that read the whole image from the card
+		double cardReadMicros = 0;   // the time they spent in READ
+		double stagedReadMicros = 0; // what it would have been at the speed of the staged loads
+	};
+
+	std::vector<Transition> transitions;
+	std::vector<Overlay> overlays; // sorted by ovID
+
+private:
+	std::vector<Record> records;
+	const double microsPerTick;
+
+	static bool IsStaged(const Record& record)
+	{
+		return (record.flags & (OverlayProfileFormat::STAGED | OverlayProfileFormat::PARTIALLY_STAGED)) != 0;
+	}
+
+	static bool IsCardLoad(const Record& record)
+	{
+		return (record.flags & (OverlayProfileFormat::STAGED | OverlayProfileFormat::PARTIALLY_STAGED |
+			OverlayProfileFormat::FAILED)) == 0;
+	}
+
+	double Micros(u64 ticks) const { return ticks * microsPerTick; }
+
+	void AddToTransitions(const Record& record)
+	{
+		if (transitions.empty() || record.frame - transitions.back().lastFrame > MAX_FRAME_GAP)
+			transitions.push_back({record.frame, record.frame, record.levelID});
+
+		Transition& transition = transitions.back();
+		transition.lastFrame = record.frame;
+		transition.levelID = record.levelID;
+		transition.numLoads++;
+		transition.numStaged += IsStaged(record);
+		transition.numFailed += (record.flags & OverlayProfileFormat::FAILED) != 0;
+		transition.imageBytes += record.imageSize;
+
+		for (u32 phase = 0; phase < NUM_PHASES; phase++)
+		{
+			transition.micros[phase] += Micros(record.ticks[phase]);
+			transition.totalMicros += Micros(record.ticks[phase]);
+		}
+	}
+
+	void AddToOverlays()
+	{
+		std::vector<u64> cardBytes, cardTicks;
+
+		for (const Record& record : records)
+		{
+			auto it = std::lower_bound(overlays.begin(), overlays.end(), record.ovID,
+				[](const Overlay& overlay, u16 ovID) { return overlay.ovID < ovID; });
+
+			if (it == overlays.end() || it->ovID != record.ovID)
+			{
+				cardBytes.insert(cardBytes.begin() + (it - overlays.begin()), 0);
+				cardTicks.insert(cardTicks.begin() + (it - overlays.begin()), 0);
+				it = overlays.insert(it, {record.ovID});
+			}
+
+			Overlay& overlay = *it;
+			overlay.numLoads++;
+			overlay.numStaged += IsStaged(record);
+			overlay.imageSize = record.imageSize;
+			overlay.loadSize = record.loadSize;
+			overlay.bssSize = record.bssSize;
+			overlay.compressed |= (record.flags & OverlayProfileFormat::COMPRESSED) != 0;
+
+			for (u32 phase = 0; phase < NUM_PHASES; phase++)
+				overlay.averageMicros[phase] += Micros(record.ticks[phase]);
+
+			overlay.worstTotalMicros = std::max(overlay.worstTotalMicros, Micros(record.TotalTicks()));
+
+			if (IsCardLoad(record))
+			{
+				cardBytes[it - overlays.begin()] += record.imageSize;
+				cardTicks[it - overlays.begin()] += record.ticks[OverlayProfileFormat::READ];
+			}
+		}
+
+		for (u32 i = 0; i < overlays.size(); i++)
+		{
+			for (double& micros : overlays[i].averageMicros)
+				micros /= overlays[i].numLoads;
+
+			if (cardTicks[i] != 0)
+				overlays[i].cardBytesPerSecond = cardBytes[i] / (Micros(cardTicks[i]) / 1e6);
+		}
+	}
+
+public:
+	explicit OverlayProfileReport(const std::vector<Record>& records, double ticksPerSecond = TICKS_PER_SECOND) :
+		records(records),
+		microsPerTick(1e6 / ticksPerSecond)
+	{
+		for (const Record& record : records)
+			AddToTransitions(record);
+
+		AddToOverlays();
+	}
+
+	// The card reads timed at the speed of the copies from the staging buffer, if any load was fully
+	// staged; otherwise stagedReadMicros stays 0, which is what reading ahead entirely would give
+	[[nodiscard]] StagingEstimate EstimateStaging() const
+	{
+		StagingEstimate res;
+		u64 stagedBytes = 0, stagedTicks = 0;
+
+		for (const Record& record : records)
+		{
+			if (IsCardLoad(record))
+			{
+				res.numCardLoads++;
+				res.cardReadMicros += Micros(record.ticks[OverlayProfileFormat::READ]);
+			}
+			else if (record.flags & OverlayProfileFormat::STAGED)
+			{
+				stagedBytes += record.imageSize;
+				stagedTicks += record.ticks[OverlayProfileFormat::READ];
+			}
+		}
+
+		if (stagedBytes != 0)
+		{
+			for (const Record& record : records)
+				if (IsCardLoad(record))
+					res.stagedReadMicros += Micros(stagedTicks) * record.imageSize / stagedBytes;
+		}
+
+		return res;
+	}
+};
@@ -8,6 +8,9 @@
 #include "Formats/KCL_File.h"
 #include "Formats/MESG_File.h"
 #include "Formats/LevelOverlay.h"
+#include "Formats/LZ16.h"
+#include "Formats/BackwardLZ.h"
+#include "Formats/NARC_File.h"
 
 #ifndef NO_DL_PATCH
 #include "Formats/DYLB_File.h"
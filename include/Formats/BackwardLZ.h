@@ -0,0 +1,81 @@
+#pragma once
+
+#include "../Math/MathCommon.h"
+
+/*
+	INFORMATION
+	The compression of overlays (and of the ARM9 binary), which is decompressed in place from the end
+	towards the start, so the image can be read to its load address and expanded there. The compressed
+	image ends with a footer:
+
+		u32 bufferTopAndBottom  bits 0-23: the size of the compressed part, counted from the end
+		                        bits 24-31: the size of the footer, padding included
+		u32 sizeIncrease        the decompressed size minus the compressed size
+
+	The bytes before the compressed part are stored as they are. The compressed part is read from
+	the start of the footer towards its start, in groups of a flag byte followed by 8 tokens, the most
+	significant bit first:
+	  0: a literal byte
+	  1: a back-reference of 2 bytes, read high byte first, (length - 3) << 12 | (distance - 3); the
+	     distance counts towards the end of the image, which is already decompressed
+*/
+
+namespace BackwardLZ
+{
+	static constexpr u32 FOOTER_SIZE = 8;
+
+	// The size after Decompress, or compressedSize if the image doesn't have a valid footer
+	inline u32 DecompressedSize(const u8* image, u32 compressedSize)
+	{
+		if (compressedSize < FOOTER_SIZE) return compressedSize;
+
+		const u8* end = image + compressedSize;
+		return compressedSize + (end[-4] | end[-3] << 8 | end[-2] << 16 | end[-1] << 24);
+	}
+
+	// Decompresses the image in place, the buffer must hold DecompressedSize bytes.
+	// Returns false, without changing the image, if the footer isn't valid.
+	inline bool Decompress(u8* image, u32 compressedSize)
+	{
+		if (compressedSize < FOOTER_SIZE) return false;
+
+		u8* const end = image + compressedSize;
+		const u32 bufferTopAndBottom = end[-8] | end[-7] << 8 | end[-6] << 16 | end[-5] << 24;
+		const u32 top = bufferTopAndBottom & 0xffffff;
+		const u32 bottom = bufferTopAndBottom >> 24;
+
+		if (top > compressedSize || bottom < FOOTER_SIZE || bottom > top)
+			return false;
+
+		const u8* src = end - bottom;
+		const u8* const srcStart = end - top;
+		u8* dst = end + (DecompressedSize(image, compressedSize) - compressedSize);
+
+		while (src > srcStart)
+		{
+			u32 flags = *--src;
+
+			for (u32 i = 0; i < 8 && src > srcStart; i++, flags <<= 1)
+			{
+				if ((flags & 0x80) == 0)
+				{
+					*--dst = *--src;
+					continue;
+				}
+
+				const u32 token = src[-1] << 8 | src[-2];
+				src -= 2;
+
+				const u32 distance = (token & 0xfff) + 3;
+
+				for (u32 length = (token >> 12) + 3; length != 0 && dst > srcStart; length--)
+				{
+					--dst;
+					*dst = dst[distance];
+				}
+			}
+		}
+
+		return true;
+	}
+}
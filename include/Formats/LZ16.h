@@ -0,0 +1,196 @@
+#pragma once
+
+#include "../Math/MathCommon.h"
+
+/*
+	INFORMATION
+	A faster replacement for DecompressLZ16, which copies one byte at a time and checks a flag bit for
+	every byte. The stream format is the same (the one LoadCompressedFileAt reads):
+
+		"LZ77"                  optional, the compressed files of overlay 0 start with it
+		u32 header              0x10 | decompressedSize << 8; if the size is 0, it's in the next u32
+		then groups of a flag byte followed by 8 tokens, the most significant bit first:
+		  0: a literal byte
+		  1: a back-reference of 2 bytes, (length - 3) << 12 | (distance - 1), big endian
+
+	What makes it faster:
+	- a flag byte of 0 copies its 8 literals without checking the bits, with word or halfword copies
+	  if the source and the destination are aligned
+	- a back-reference with a distance that's a multiple of 4 (or 2) is copied with word (or
+	  halfword) copies after the destination is aligned; reading a word of a back-reference never
+	  overlaps the bytes it writes, because the distance is at least the size of the word
+	- a back-reference with a distance of 1 is a fill, and is written with word stores
+
+	The destination must be in main RAM, since some bytes are still written one at a time.
+	Formats/LZ16Compressor.h is the host-side compressor, tests/LZ16Test.cpp the round-trip test
+	and benchmark.
+*/
+
+namespace LZ16
+{
+	static constexpr u8 TYPE = 0x10;
+	static constexpr u32 MIN_LENGTH = 3;
+	static constexpr u32 MAX_LENGTH = 0xf + MIN_LENGTH;
+	static constexpr u32 MAX_DISTANCE = 0x1000;
+
+	namespace Internal
+	{
+		using AliasedU32 [[gnu::may_alias]] = u32;
+		using AliasedU16 [[gnu::may_alias]] = u16;
+
+		[[gnu::always_inline]]
+		inline u32 Misalignment(const void* ptr, u32 alignment)
+		{
+			return reinterpret_cast<std::uintptr_t>(ptr) & (alignment - 1);
+		}
+
+		[[gnu::always_inline]]
+		inline u32 ReadU32(const u8* src)
+		{
+			return src[0] | src[1] << 8 | src[2] << 16 | src[3] << 24;
+		}
+
+		[[gnu::always_inline]]
+		inline void CopyLiterals8(u8*& dst, const u8*& src)
+		{
+			const u32 misalignment = Misalignment(dst, 4) | Misalignment(src, 4);
+
+			if (misalignment == 0)
+			{
+				reinterpret_cast<AliasedU32*>(dst)[0] = reinterpret_cast<const AliasedU32*>(src)[0];
+				reinterpret_cast<AliasedU32*>(dst)[1] = reinterpret_cast<const AliasedU32*>(src)[1];
+			}
+			else if ((misalignment & 1) == 0)
+			{
+				for (u32 i = 0; i < 4; i++)
+					reinterpret_cast<AliasedU16*>(dst)[i] = reinterpret_cast<const AliasedU16*>(src)[i];
+			}
+			else
+			{
+				for (u32 i = 0; i < 8; i++)
+					dst[i] = src[i];
+			}
+
+			dst += 8;
+			src += 8;
+		}
+
+		[[gnu::always_inline]]
+		inline void CopyMatch(u8* dst, u32 distance, u32 length)
+		{
+			const u8* src = dst - distance;
+
+			if (distance == 1)
+			{
+				const u32 value = *src;
+
+				for (; length > 0 && Misalignment(dst, 4) != 0; length--)
+					*dst++ = value;
+
+				const u32 word = value * 0x01010101;
+
+				for (; length >= 4; length -= 4, dst += 4)
+					*reinterpret_cast<AliasedU32*>(dst) = word;
+			}
+			else if ((distance & 3) == 0)
+			{
+				for (; length > 0 && Misalignment(dst, 4) != 0; length--)
+					*dst++ = *src++;
+
+				for (; length >= 4; length -= 4, dst += 4, src += 4)
+					*reinterpret_cast<AliasedU32*>(dst) = *reinterpret_cast<const AliasedU32*>(src);
+			}
+			else if ((distance & 1) == 0)
+			{
+				if (Misalignment(dst, 2) != 0)
+				{
+					*dst++ = *src++;
+					length--;
+				}
+
+				for (; length >= 2; length -= 2, dst += 2, src += 2)
+					*reinterpret_cast<AliasedU16*>(dst) = *reinterpret_cast<const AliasedU16*>(src);
+			}
+
+			for (; length > 0; length--)
+				*dst++ = *src++;
+		}
+
+		// Skips the "LZ77" magic, if there is one
+		inline const u8* StreamStart(const void* source)
+		{
+			const u8* src = static_cast<const u8*>(source);
+
+			if (src[0] == 'L' && src[1] == 'Z' && src[2] == '7' && src[3] == '7')
+				src += 4;
+
+			return src;
+		}
+	}
+
+	[[nodiscard]] inline bool IsCompressed(const void* source)
+	{
+		return Internal::StreamStart(source)[0] == TYPE;
+	}
+
+	[[nodiscard]] inline u32 DecompressedSize(const void* source)
+	{
+		const u8* src = Internal::StreamStart(source);
+		const u32 size = Internal::ReadU32(src) >> 8;
+
+		return size != 0 ? size : Internal::ReadU32(src + 4);
+	}
+
+	// Returns the decompressed size
+	inline u32 Decompress(const void* source, void* dest)
+	{
+		using namespace Internal;
+
+		const u8* src = StreamStart(source);
+		u32 size = ReadU32(src) >> 8;
+		src += 4;
+
+		if (size == 0)
+		{
+			size = ReadU32(src);
+			src += 4;
+		}
+
+		u8* dst = static_cast<u8*>(dest);
+		u8* const end = dst + size;
+
+		while (dst < end)
+		{
+			u32 flags = *src++;
+
+			if (flags == 0 && end - dst >= 8)
+			{
+				CopyLiterals8(dst, src);
+				continue;
+			}
+
+			for (u32 i = 0; i < 8 && dst < end; i++, flags <<= 1)
+			{
+				if ((flags & 0x80) == 0)
+				{
+					*dst++ = *src++;
+					continue;
+				}
+
+				const u32 token = src[0] << 8 | src[1];
+				src += 2;
+
+				const u32 distance = (token & 0xfff) + 1;
+				u32 length = (token >> 12) + MIN_LENGTH;
+
+				if (length > static_cast<u32>(end - dst))
+					length = end - dst;
+
+				CopyMatch(dst, distance, length);
+				dst += length;
+			}
+		}
+
+		return size;
+	}
+}
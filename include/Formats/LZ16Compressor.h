@@ -0,0 +1,216 @@
+#pragma once
+
+#include "LZ16.h"
+#include <algorithm>
+#include <span>
+#include <vector>
+
+/*
+	INFORMATION
+	Host-side compressor for the LZ16 format (it isn't included by SM64DS_PI.h), plus a byte-at-a-time
+	decompressor that works like DecompressLZ16, as a reference for LZ16::Decompress:
+
+		std::vector<u8> compressed = LZ16::Compress(file);                  // optimal parse
+		std::vector<u8> quick      = LZ16::Compress(file, {.optimal = false}); // greedy, like most tools
+
+	tests/LZ16Test.cpp fuzzes the round trip and benchmarks the two decompressors against each other.
+
+	The optimal parse finds the longest match at every position (which gives every shorter length at
+	the same distance too) and then picks the cheapest sequence of tokens from the end of the file
+	backwards, with a literal costing 9 bits and a back-reference 17 bits, flag bits included. That's
+	the exact size of the stream except for the padding of the last flag byte.
+*/
+
+namespace LZ16
+{
+	struct CompressOptions
+	{
+		bool optimal = true;
+		bool magic = true;      // start with "LZ77" like the files of overlay 0
+		bool vramSafe = false;  // no distance of 1, for decompressors that write halfwords
+	};
+
+	namespace Internal
+	{
+		struct Match
+		{
+			u16 length = 0;
+			u16 distance = 0;
+		};
+
+		// The longest match at every position, using hash chains of the first 3 bytes
+		inline std::vector<Match> FindLongestMatches(std::span<const u8> data, u32 minDistance)
+		{
+			static constexpr u32 HASH_BITS = 16;
+			static constexpr u32 NONE = ~0u;
+
+			const u32 size = data.size();
+
+			std::vector<Match> res(size);
+			std::vector<u32> head(1 << HASH_BITS, NONE);
+			std::vector<u32> prev(size, NONE);
+
+			const auto hash = [&](u32 i)
+			{
+				const u32 key = data[i] << 16 | data[i + 1] << 8 | data[i + 2];
+				return (key * 0x9e3779b1) >> (32 - HASH_BITS);
+			};
+
+			for (u32 i = 0; i + MIN_LENGTH <= size; i++)
+			{
+				const u32 h = hash(i);
+				const u32 maxLength = std::min(MAX_LENGTH, size - i);
+
+				for (u32 candidate = head[h]; candidate != NONE && i - candidate <= MAX_DISTANCE; candidate = prev[candidate])
+				{
+					if (i - candidate < minDistance) continue;
+
+					u32 length = 0;
+					while (length < maxLength && data[candidate + length] == data[i + length])
+						length++;
+
+					if (length > res[i].length)
+					{
+						res[i] = {static_cast<u16>(length), static_cast<u16>(i - candidate)};
+						if (length == maxLength) break;
+					}
+				}
+
+				if (res[i].length < MIN_LENGTH) res[i] = {};
+
+				prev[i] = head[h];
+				head[h] = i;
+			}
+
+			return res;
+		}
+
+		// One token per position that starts one, a length of 0 is a literal
+		inline std::vector<Match> Parse(std::span<const Match> longest, bool optimal)
+		{
+			const u32 size = longest.size();
+			std::vector<Match> res(size);
+
+			if (!optimal)
+			{
+				for (u32 i = 0; i < size; i += std::max<u32>(res[i].length, 1))
+					res[i] = longest[i];
+
+				return res;
+			}
+
+			std::vector<u32> cost(size + 1, 0); // in bits, from the position to the end
+
+			for (u32 i = size; i-- > 0;)
+			{
+				cost[i] = cost[i + 1] + 9;
+				res[i] = {};
+
+				for (u32 length = MIN_LENGTH; length <= longest[i].length; length++)
+				{
+					if (cost[i + length] + 17 < cost[i])
+					{
+						cost[i] = cost[i + length] + 17;
+						res[i] = {static_cast<u16>(length), longest[i].distance};
+					}
+				}
+			}
+
+			return res;
+		}
+	}
+
+	inline std::vector<u8> Compress(std::span<const u8> data, const CompressOptions& options = {})
+	{
+		using namespace Internal;
+
+		const u32 size = data.size();
+		const std::vector<Match> tokens = Parse(FindLongestMatches(data, options.vramSafe ? 2 : 1), options.optimal);
+
+		std::vector<u8> res;
+		res.reserve(size + size / 8 + 16);
+
+		if (options.magic)
+			for (u8 c : {'L', 'Z', '7', '7'})
+				res.push_back(c);
+
+		const auto writeU32 = [&](u32 value)
+		{
+			for (u32 i = 0; i < 4; i++)
+				res.push_back(value >> 8 * i);
+		};
+
+		if (size < 1 << 24 && size != 0)
+			writeU32(TYPE | size << 8);
+		else
+			writeU32(TYPE), writeU32(size);
+
+		std::size_t flagPos = 0;
+		u32 numTokens = 0;
+
+		for (u32 i = 0; i < size; numTokens++)
+		{
+			if (numTokens % 8 == 0)
+			{
+				flagPos = res.size();
+				res.push_back(0);
+			}
+
+			const Match& token = tokens[i];
+
+			if (token.length == 0)
+			{
+				res.push_back(data[i++]);
+				continue;
+			}
+
+			const u32 value = (token.length - MIN_LENGTH) << 12 | (token.distance - 1);
+
+			res[flagPos] |= 0x80 >> numTokens % 8;
+			res.push_back(value >> 8);
+			res.push_back(value);
+			i += token.length;
+		}
+
+		while (res.size() % 4 != 0)
+			res.push_back(0);
+
+		return res;
+	}
+
+	// Works like DecompressLZ16: one flag bit and one byte at a time
+	inline u32 DecompressReference(const void* source, void* dest)
+	{
+		const u8* src = Internal::StreamStart(source);
+		const u32 size = DecompressedSize(src);
+		src += Internal::ReadU32(src) >> 8 != 0 ? 4 : 8;
+
+		u8* dst = static_cast<u8*>(dest);
+		u32 written = 0;
+
+		while (written < size)
+		{
+			const u32 flags = *src++;
+
+			for (u32 bit = 0x80; bit != 0 && written < size; bit >>= 1)
+			{
+				if ((flags & bit) == 0)
+				{
+					dst[written++] = *src++;
+					continue;
+				}
+
+				const u32 token = src[0] << 8 | src[1];
+				src += 2;
+
+				const u32 distance = (token & 0xfff) + 1;
+				const u32 length = (token >> 12) + MIN_LENGTH;
+
+				for (u32 i = 0; i < length && written < size; i++, written++)
+					dst[written] = dst[written - distance];
+			}
+		}
+
+		return size;
+	}
+}
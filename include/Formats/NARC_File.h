@@ -0,0 +1,64 @@
+#pragma once
+
+#include "../Math/MathCommon.h"
+
+// The archives of ARCHIVE_INFOS. Sections are in the order FAT ("BTAF"), FNT ("BTNF") and
+// file images ("GMIF"); the FAT offsets are relative to the data of the GMIF section.
+struct NARC_File
+{
+	struct SectionHeader
+	{
+		char magic[4];
+		u32 size; // including this header
+	};
+
+	struct FatEntry
+	{
+		u32 start;
+		u32 end; // one past the last byte
+	};
+
+	struct FAT
+	{
+		SectionHeader header; // "BTAF"
+		u16 numFiles;
+		u16 unk0a; // padding
+		FatEntry entries[];
+	};
+
+	char magic[4];    // "NARC"
+	u16 byteOrder;    // 0xfffe
+	u16 version;      // 0x0100
+	u32 fileSize;
+	u16 headerSize;   // 0x10
+	u16 numSections;  // 3
+
+	const SectionHeader& Section(u32 index) const
+	{
+		const u8* section = reinterpret_cast<const u8*>(this) + headerSize;
+
+		for (u32 i = 0; i < index; i++)
+			section += reinterpret_cast<const SectionHeader*>(section)->size;
+
+		return *reinterpret_cast<const SectionHeader*>(section);
+	}
+
+	const FAT& GetFAT() const { return reinterpret_cast<const FAT&>(Section(0)); }
+	const SectionHeader& GetFNT() const { return Section(1); }
+	const u8* GetFileImages() const { return reinterpret_cast<const u8*>(&Section(2) + 1); }
+
+	// nullptr if there is no such file
+	const u8* GetFile(u32 index, u32& size) const
+	{
+		const FAT& fat = GetFAT();
+		if (index >= fat.numFiles) return nullptr;
+
+		size = fat.entries[index].end - fat.entries[index].start;
+		return GetFileImages() + fat.entries[index].start;
+	}
+};
+
+static_assert(sizeof(NARC_File) == 0x10);
+static_assert(sizeof(NARC_File::SectionHeader) == 0x8);
+static_assert(sizeof(NARC_File::FatEntry) == 0x8);
+static_assert(sizeof(NARC_File::FAT) == 0xc);
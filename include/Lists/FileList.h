@@ -1,15 +1,18 @@
 #pragma once
 
 #include "SharedFilePtr.h"
+#include "Lists/NameLookup.h"
 
-consteval SharedFilePtr::IDs SharedFilePtr::IDs::Get(const char* name)
+// FILES must be sorted by name, see NameLookup.h
+namespace FileList
 {
 	struct File
 	{
-		IDs ids;
+		SharedFilePtr::IDs ids;
 		const char* name;
-	}
-	constexpr files[] =
+	};
+
+	inline constexpr File FILES[] =
 	{
 		{0x065a, 0x0000, "MG/casino_back.bmd"},
 		{0x065b, 0x0001, "MG/d_2d_badwizer_nsc.bin"},
@@ -1428,6 +1431,8 @@ consteval SharedFilePtr::IDs SharedFilePtr::IDs::Get(const char* name)
 		{0x039d, 0x054b, "data/player/tx_sleep_wait.btp"},
 		{0x03bd, 0x054c, "data/player/wario_metal_model.bmd"},
 		{0x0075, 0x0587, "data/sound_data.sdat"},
+		{0x0504, 0x06b3, "data/special_obj/SW_lift/SW_lift.bmd"},
+		{0x0505, 0x06b4, "data/special_obj/SW_lift/SW_lift.kcl"},
 		{0x03d9, 0x05a3, "data/special_obj/b_ana_shutter/b_ana_shutter.bmd"},
 		{0x03da, 0x05a4, "data/special_obj/b_ana_shutter/b_ana_shutter.kcl"},
 		{0x03db, 0x05a5, "data/special_obj/b_si_so/b_si_so.bmd"},
@@ -1727,8 +1732,6 @@ consteval SharedFilePtr::IDs SharedFilePtr::IDs::Get(const char* name)
 		{0x0501, 0x06b0, "data/special_obj/rc_tikuwa/rc_tikuwa.kcl"},
 		{0x0502, 0x06b1, "data/special_obj/sl_ice_brock/sl_ice_brock.bmd"},
 		{0x0503, 0x06b2, "data/special_obj/sl_ice_brock/sl_ice_brock.kcl"},
-		{0x0504, 0x06b3, "data/special_obj/SW_lift/SW_lift.bmd"},
-		{0x0505, 0x06b4, "data/special_obj/SW_lift/SW_lift.kcl"},
 		{0x0506, 0x06c9, "data/special_obj/t_basket/t_basket.bmd"},
 		{0x0507, 0x06b5, "data/special_obj/td_obj_futa/td_obj_futa.bmd"},
 		{0x0508, 0x06b6, "data/special_obj/td_obj_futa/td_obj_futa.kcl"},
@@ -2071,24 +2074,24 @@ consteval SharedFilePtr::IDs SharedFilePtr::IDs::Get(const char* name)
 		{0x0659, 0x0808, "data/wipe/wipe_yoshi.bmd"}
 	};
 
-	const File* begin = std::begin(files);
-	const File* end = std::end(files);
-	const File* prevMid = nullptr;
-
-	while (true)
+	// Never a constant expression, the error message shows both names
+	constexpr SharedFilePtr::IDs UnknownFileName_ClosestIs(const char* name, const char* closest)
 	{
-		const File* mid = begin + (end - begin >> 1);
-		if (void FileNotFound(); mid == prevMid) FileNotFound();
-		prevMid = mid;
+		if (name < closest) return {};
+		return {};
+	}
+}
 
-		const char* c0 = name;
-		const char* c1 = mid->name;
+consteval SharedFilePtr::IDs SharedFilePtr::IDs::Get(const char* name)
+{
+	if (const FileList::File* file = NameLookup::Find(FileList::FILES, name))
+		return file->ids;
 
-		for(; *c0 == *c1; ++c0, ++c1)
-			if (*c0 == '\0') return mid->ids;
+	// with an unsorted table, the binary search can miss names that are in it
+	if (const FileList::File* file = NameLookup::FirstUnsorted(FileList::FILES))
+		return NameLookup::TableNotSorted_OutOfOrderAre<IDs>(file[-1].name, file->name);
 
-		if (*c0 < *c1) end = mid; else begin = mid;
-	}
+	return FileList::UnknownFileName_ClosestIs(name, NameLookup::Closest(FileList::FILES, name).name);
 }
 
 consteval u16 operator""_fileID(const char* name, std::size_t)
@@ -0,0 +1,188 @@
+#pragma once
+
+#include "Math/MathCommon.h"
+
+/*
+	INFORMATION
+	Compile-time lookups by name in the tables of FileList.h and SoundList.h. A table is an array at
+	namespace scope, so that it's only evaluated once per translation unit, of entries with a name
+	member, sorted by name in ASCII order (so "SW_lift" comes before "b_ana_shutter").
+
+	Find is a binary search. Since the table is sorted, all names between the bounds of the search
+	share the prefix that the searched name shares with the names just outside of them, so the
+	comparisons skip it; most names in the tables start with the same long directory or prefix.
+
+	Sortedness is only checked when a name isn't found, which is the only way an unsorted table can
+	go wrong, so it costs nothing otherwise. The lists report unknown names with the closest name in
+	the table, by printing both in a pointer comparison that isn't a constant expression:
+
+		error: '(((const char*)"data/enemy/kuribo/kuribo.bmd") < ((const char*)"data/enemy/kuribo/kuribo_model.bmd"))'
+		is not a constant expression
+*/
+
+namespace NameLookup
+{
+	consteval s32 Compare(const char* a, const char* b)
+	{
+		for (; *a == *b; ++a, ++b)
+			if (*a == '\0') return 0;
+
+		return static_cast<u8>(*a) < static_cast<u8>(*b) ? -1 : 1;
+	}
+
+	// The first entry that's out of order, nullptr if the table is sorted
+	template<class Entry, std::size_t N>
+	consteval const Entry* FirstUnsorted(const Entry (&table)[N])
+	{
+		for (const Entry* entry = table + 1; entry < table + N; entry++)
+			if (Compare(entry[-1].name, entry->name) >= 0) return entry;
+
+		return nullptr;
+	}
+
+	// The first entry whose name isn't less than name
+	template<class Entry, std::size_t N>
+	consteval const Entry* LowerBound(const Entry (&table)[N], const char* name)
+	{
+		const Entry* begin = table;
+		const Entry* end = table + N;
+		u32 prefixBegin = 0; // the length of the prefix name shares with begin[-1]
+		u32 prefixEnd = 0;   // and with *end
+
+		while (begin < end)
+		{
+			const Entry* mid = begin + ((end - begin) >> 1);
+
+			u32 i = prefixBegin < prefixEnd ? prefixBegin : prefixEnd;
+			while (name[i] == mid->name[i] && name[i] != '\0') i++;
+
+			if (static_cast<u8>(mid->name[i]) < static_cast<u8>(name[i]))
+			{
+				begin = mid + 1;
+				prefixBegin = i;
+			}
+			else
+			{
+				end = mid;
+				prefixEnd = i;
+			}
+		}
+
+		return begin;
+	}
+
+	// nullptr if there is no entry with that name
+	template<class Entry, std::size_t N>
+	consteval const Entry* Find(const Entry (&table)[N], const char* name)
+	{
+		const Entry* entry = LowerBound(table, name);
+
+		return entry != table + N && Compare(entry->name, name) == 0 ? entry : nullptr;
+	}
+
+	// Levenshtein distance, only computed up to limit: returns limit if it's at least that. Only the
+	// cells within limit of the diagonal can be lower than limit, so the others aren't computed.
+	consteval u32 EditDistance(const char* a, const char* b, u32 limit)
+	{
+		constexpr u32 MAX_LENGTH = 128;
+
+		u32 lengthA = 0, lengthB = 0;
+		while (a[lengthA] != '\0' && lengthA < MAX_LENGTH) lengthA++;
+		while (b[lengthB] != '\0' && lengthB < MAX_LENGTH) lengthB++;
+
+		if ((lengthA > lengthB ? lengthA - lengthB : lengthB - lengthA) >= limit) return limit;
+
+		u32 prev[MAX_LENGTH + 1];
+		u32 cur[MAX_LENGTH + 1];
+
+		for (u32 j = 0; j <= lengthB; j++)
+			prev[j] = cur[j] = j < limit ? j : limit;
+
+		for (u32 i = 1; i <= lengthA; i++)
+		{
+			const u32 first = i > limit ? i - limit : 1;
+			const u32 last = i + limit < lengthB ? i + limit : lengthB;
+
+			cur[first - 1] = first == 1 && i < limit ? i : limit;
+			u32 rowMin = cur[first - 1];
+
+			for (u32 j = first; j <= last; j++)
+			{
+				u32 distance = prev[j - 1] + (a[i - 1] != b[j - 1]);
+
+				if (prev[j] + 1 < distance) distance = prev[j] + 1;
+				if (cur[j - 1] + 1 < distance) distance = cur[j - 1] + 1;
+				if (limit < distance) distance = limit;
+
+				cur[j] = distance;
+				if (distance < rowMin) rowMin = distance;
+			}
+
+			if (rowMin >= limit) return limit;
+
+			for (u32 j = first - 1; j <= last; j++) prev[j] = cur[j];
+		}
+
+		return prev[lengthB];
+	}
+
+	// A lower bound of EditDistance: an edit changes at most one count up and one count down
+	consteval u32 CharCountDistance(const char* a, const char* b)
+	{
+		s32 counts[0x80] = {};
+
+		for (; *a != '\0'; ++a) counts[*a & 0x7f]++;
+		for (; *b != '\0'; ++b) counts[*b & 0x7f]--;
+
+		u32 more = 0, fewer = 0;
+
+		for (s32 count : counts)
+		{
+			if (count > 0) more += count;
+			else fewer -= count;
+		}
+
+		return more > fewer ? more : fewer;
+	}
+
+	// The entry with the name that has the lowest edit distance to name
+	template<class Entry, std::size_t N>
+	consteval const Entry& Closest(const Entry (&table)[N], const char* name)
+	{
+		const Entry* res = &table[0];
+		u32 bestDistance = 0x100; // more than any distance
+
+		// the neighbors in sorted order are usually close, so they're checked first, which makes the
+		// limit low from the start
+		constexpr std::size_t NUM_NEIGHBORS = 16;
+		const std::size_t lowerBound = LowerBound(table, name) - table;
+		const std::size_t firstNeighbor = lowerBound > NUM_NEIGHBORS / 2 ? lowerBound - NUM_NEIGHBORS / 2 : 0;
+
+		for (std::size_t i = 0; i < NUM_NEIGHBORS + N; i++)
+		{
+			const std::size_t index = i < NUM_NEIGHBORS ? firstNeighbor + i : i - NUM_NEIGHBORS;
+			if (index >= N) continue;
+
+			const Entry& entry = table[index];
+			if (CharCountDistance(name, entry.name) >= bestDistance) continue;
+
+			const u32 distance = EditDistance(name, entry.name, bestDistance);
+
+			if (distance < bestDistance)
+			{
+				res = &entry;
+				bestDistance = distance;
+			}
+		}
+
+		return *res;
+	}
+
+	// Never a constant expression, the error message shows both names
+	template<class Result>
+	constexpr Result TableNotSorted_OutOfOrderAre(const char* prev, const char* next)
+	{
+		if (prev < next) return {};
+		return {};
+	}
+}
@@ -2,6 +2,7 @@
 
 #include "Math.h"
 #include "Sound.h"
+#include "Lists/NameLookup.h"
 
 struct SoundIDs
 {
@@ -9,15 +10,16 @@ struct SoundIDs
 	u16 seqID;
 };
 
-consteval SoundIDs GetSoundInfo(const char* name)
+// SOUNDS must be sorted by name, see NameLookup.h
+namespace SoundList
 {
 	struct SoundInfo
 	{
 		SoundIDs ids;
 		const char* name;
 	};
-	
-	constexpr SoundInfo files[] =
+
+	inline constexpr SoundInfo SOUNDS[] =
 	{
 		{ 0x0002, 0x0118, "NCS_SE_BTL_BTN" },
 		{ 0x0002, 0x011c, "NCS_SE_BTL_CONNECTING" },
@@ -1469,26 +1471,37 @@ consteval SoundIDs GetSoundInfo(const char* name)
 		{ 0x0001, 0x0105, "NCS_SE_VT_PEACH_LETTER" },
 	};
 	
-	const SoundInfo* begin = std::begin(files);
-	const SoundInfo* end = std::end(files);
-	const SoundInfo* prevMid = nullptr;
-	
-	while (true)
+	// Never a constant expression, the error message shows both names
+	constexpr SoundIDs UnknownSoundName_ClosestIs(const char* name, const char* closest)
 	{
-		const SoundInfo* mid = begin + (end - begin >> 1);
-		if (void SoundNotFound(); mid == prevMid) SoundNotFound();
-		prevMid = mid;
-		
-		const char* c0 = name;
-		const char* c1 = mid->name;
-		
-		for(; *c0 == *c1; ++c0, ++c1)
-			if (*c0 == '\0') return mid->ids;
-		
-		if (*c0 < *c1) end = mid; else begin = mid;
+		if (name < closest) return {};
+		return {};
 	}
 }
 
+consteval SoundIDs GetSoundInfo(const char* name)
+{
+	if (const SoundList::SoundInfo* sound = NameLookup::Find(SoundList::SOUNDS, name))
+		return sound->ids;
+
+	// with an unsorted table, the binary search can miss names that are in it
+	if (const SoundList::SoundInfo* sound = NameLookup::FirstUnsorted(SoundList::SOUNDS))
+		return NameLookup::TableNotSorted_OutOfOrderAre<SoundIDs>(sound[-1].name, sound->name);
+
+	return SoundList::UnknownSoundName_ClosestIs(name, NameLookup::Closest(SoundList::SOUNDS, name).name);
+}
+
+// The reverse of GetSoundInfo, for debug output; nullptr if there is no such sound. Calling it at
+// run time puts SOUNDS and all the names in the binary (about 40 KB), so keep it out of release builds.
+constexpr const char* GetSoundName(SoundIDs ids)
+{
+	for (const SoundList::SoundInfo& sound : SoundList::SOUNDS)
+		if (sound.ids.seqArcID == ids.seqArcID && sound.ids.seqID == ids.seqID)
+			return sound.name;
+
+	return nullptr;
+}
+
 namespace Sound
 {
 	[[gnu::always_inline]]
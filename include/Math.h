@@ -3,8 +3,10 @@
 #include "Math/MathCommon.h"
 #include "Math/FixedPoint.h"
 #include "Math/Vector.h"
+#include "Math/FixVector.h"
 #include "Math/Matrix.h"
 #include "Math/Quaternion.h"
+#include "Math/VectorBatch.h"
 
 inline bool IsBetween (u8 x, u8 x1, u8 x2) { return x1 <= x && x < x2; } // alternative implemantation: (u8)(x - x1) < (x2 - x1)
 inline bool NotBetween(u8 x, u8 x1, u8 x2) { return x < x1 || x2 < x; }  // alternative implemantation: (u8)(x - x1) > (x2 - x1)
@@ -16,10 +18,10 @@ template <typename T>
 }
 
 consteval s32 operator""_deg(long double val) { return val * 32768.L / 180.L; }
-consteval s32 operator""_deg(u64 val) { return operator""_deg(static_cast<long double>(val)); }
+consteval s32 operator""_deg(unsigned long long val) { return operator""_deg(static_cast<long double>(val)); }
 
 consteval s32 operator""_rad(long double val) { return val * 32768.L / 3.141592653589793238462643383279502884L; }
-consteval s32 operator""_rad(u64 val) { return operator""_rad(static_cast<long double>(val)); }
+consteval s32 operator""_rad(unsigned long long val) { return operator""_rad(static_cast<long double>(val)); }
 
 extern "C"
 {
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "MathCommon.h"
+#include "FixedPoint.h"
+#include "Vector.h"
+
+// A plain vector over any fixed-point format, for positions that need more range (Vector3Q8)
+// or more precision (Vector3Q20) than Vector3. Instead of keeping a shifted copy of a position
+// (like posAsr3) for distance checks, keep the position in the wider format, compare distances
+// with WithinDist, and convert to a Vector3 relative to a nearby origin (the camera, the actor,
+// ...) before using the Vector3 and Matrix4x3 functions.
+template<FixedPoint F>
+struct BasicVector3
+{
+	F x, y, z;
+
+	constexpr BasicVector3() = default;
+	constexpr BasicVector3(F x, F y, F z) : x(x), y(y), z(z) {}
+
+	template<FixedPoint G>
+	constexpr explicit BasicVector3(const BasicVector3<G>& v):
+		x(FixCast<F>(v.x)),
+		y(FixCast<F>(v.y)),
+		z(FixCast<F>(v.z))
+	{}
+
+	constexpr explicit BasicVector3(const Vector3& v):
+		x(FixCast<F>(v.x)),
+		y(FixCast<F>(v.y)),
+		z(FixCast<F>(v.z))
+	{}
+
+	constexpr explicit operator Vector3() const
+	{
+		return {FixCast<Fix12i>(x), FixCast<Fix12i>(y), FixCast<Fix12i>(z)};
+	}
+
+	constexpr bool operator==(const BasicVector3&) const = default;
+
+	constexpr BasicVector3 operator+(const BasicVector3& v) const { return {x + v.x, y + v.y, z + v.z}; }
+	constexpr BasicVector3 operator-(const BasicVector3& v) const { return {x - v.x, y - v.y, z - v.z}; }
+	constexpr BasicVector3 operator-() const { return {-x, -y, -z}; }
+	constexpr BasicVector3 operator*(F scalar) const { return {x * scalar, y * scalar, z * scalar}; }
+	constexpr BasicVector3 operator<<(s32 shift) const { return {x << shift, y << shift, z << shift}; }
+	constexpr BasicVector3 operator>>(s32 shift) const { return {x >> shift, y >> shift, z >> shift}; }
+
+	constexpr BasicVector3& operator+=(const BasicVector3& v) & { return *this = *this + v; }
+	constexpr BasicVector3& operator-=(const BasicVector3& v) & { return *this = *this - v; }
+	constexpr BasicVector3& operator*=(F scalar) & { return *this = *this * scalar; }
+
+	// The products are summed in 64 bits and rounded once
+	[[nodiscard]]
+	constexpr F Dot(const BasicVector3& v) const
+	{
+		const s64 sum = static_cast<s64>(x.val) * v.x.val + static_cast<s64>(y.val) * v.y.val + static_cast<s64>(z.val) * v.z.val;
+
+		return {static_cast<s32>((sum + (1ll << (F::fracBits - 1))) >> F::fracBits), as_raw};
+	}
+
+	// Exact, without a square root and without any overflow
+	[[nodiscard]]
+	constexpr bool WithinDist(const BasicVector3& v, F dist) const
+	{
+		const s64 dx = static_cast<s64>(x.val) - v.x.val;
+		const s64 dy = static_cast<s64>(y.val) - v.y.val;
+		const s64 dz = static_cast<s64>(z.val) - v.z.val;
+		const s64 d  = dist.val;
+
+		if (dx > d || -dx > d || dy > d || -dy > d || dz > d || -dz > d) return false;
+
+		return static_cast<u64>(dx * dx) + static_cast<u64>(dy * dy) + static_cast<u64>(dz * dz) <= static_cast<u64>(d * d);
+	}
+
+	[[nodiscard]]
+	constexpr bool HorzWithinDist(const BasicVector3& v, F dist) const
+	{
+		return BasicVector3(x, v.y, z).WithinDist(v, dist);
+	}
+
+	// The difference to origin as a Vector3, which must fit in Fix12i
+	[[nodiscard]]
+	constexpr Vector3 RelativeTo(const BasicVector3& origin) const
+	{
+		return static_cast<Vector3>(*this - origin);
+	}
+};
+
+using Vector3Q8  = BasicVector3<Fix8i>;
+using Vector3Q20 = BasicVector3<Fix20i>;
@@ -2,6 +2,7 @@
 
 #include "ostream.h"
 #include "MathCommon.h"
+#include "FixedPointInstrument.h"
 #include <type_traits>
 #include <concepts>
 #include <limits>
@@ -18,6 +19,7 @@ struct Fix
 	T val;
 
 	using Promoted = CRTP<s32>;
+	static constexpr s32 fracBits = q;
 
 	constexpr Fix() = default;
 	constexpr Fix(std::integral auto val) : val(val << q) {}
@@ -42,19 +44,39 @@ struct Fix
 	Promoted operator+ (CRTP<T> f) { return {f.val, as_raw}; }
 
 	friend constexpr
-	Promoted operator- (CRTP<T> f) { return {-f.val, as_raw}; }
+	Promoted operator- (CRTP<T> f)
+	{
+		FIX_INSTRUMENT_RECORD(RecordAdd(-static_cast<s64>(f.val)))
+		return {-f.val, as_raw};
+	}
 
 	template<FixUR U> friend constexpr
-	Promoted operator+ (CRTP<T> f0, CRTP<U> f1) { return {f0.val + f1.val, as_raw}; }
+	Promoted operator+ (CRTP<T> f0, CRTP<U> f1)
+	{
+		FIX_INSTRUMENT_RECORD(RecordAdd(static_cast<s64>(f0.val) + f1.val))
+		return {f0.val + f1.val, as_raw};
+	}
 
 	template<FixUR U> friend constexpr
-	Promoted operator- (CRTP<T> f0, CRTP<U> f1) { return {f0.val - f1.val, as_raw}; }
+	Promoted operator- (CRTP<T> f0, CRTP<U> f1)
+	{
+		FIX_INSTRUMENT_RECORD(RecordAdd(static_cast<s64>(f0.val) - f1.val))
+		return {f0.val - f1.val, as_raw};
+	}
 
 	template<FixUR U> friend constexpr
-	CRTP<T>& operator+=(CRTP<T>& f0, CRTP<U> f1) { f0.val += f1.val; return f0; }
+	CRTP<T>& operator+=(CRTP<T>& f0, CRTP<U> f1)
+	{
+		FIX_INSTRUMENT_RECORD(RecordAdd<T>(static_cast<s64>(f0.val) + f1.val))
+		f0.val += f1.val; return f0;
+	}
 
 	template<FixUR U> friend constexpr
-	CRTP<T>& operator-=(CRTP<T>& f0, CRTP<U> f1) { f0.val -= f1.val; return f0; }
+	CRTP<T>& operator-=(CRTP<T>& f0, CRTP<U> f1)
+	{
+		FIX_INSTRUMENT_RECORD(RecordAdd<T>(static_cast<s64>(f0.val) - f1.val))
+		f0.val -= f1.val; return f0;
+	}
 
 	friend constexpr Promoted operator+ (s32 i,  CRTP<T> f) { return Promoted(i) + f; }
 	friend constexpr Promoted operator- (s32 i,  CRTP<T> f) { return Promoted(i) - f; }
@@ -63,16 +85,50 @@ struct Fix
 	friend constexpr CRTP<T>& operator+=(CRTP<T>& f, s32 i) { return f += Promoted(i); }
 	friend constexpr CRTP<T>& operator-=(CRTP<T>& f, s32 i) { return f -= Promoted(i); }
 
-	friend constexpr Promoted operator* (s32 i,  CRTP<T> f) { return {i * f.val, as_raw}; }
-	friend constexpr Promoted operator* (CRTP<T>  f, s32 i) { return {f.val * i, as_raw}; }
+	friend constexpr Promoted operator* (s32 i,  CRTP<T> f)
+	{
+		FIX_INSTRUMENT_RECORD(RecordIntMul(static_cast<s64>(i) * f.val))
+		return {i * f.val, as_raw};
+	}
+
+	friend constexpr Promoted operator* (CRTP<T>  f, s32 i)
+	{
+		FIX_INSTRUMENT_RECORD(RecordIntMul(static_cast<s64>(f.val) * i))
+		return {f.val * i, as_raw};
+	}
+
 	friend constexpr Promoted operator/ (CRTP<T>  f, s32 i) { return {f.val / i, as_raw}; }
-	friend constexpr CRTP<T>& operator*=(CRTP<T>& f, s32 i) { f.val *= i; return f; }
 	friend constexpr CRTP<T>& operator/=(CRTP<T>& f, s32 i) { f.val /= i; return f; }
 
-	friend constexpr Promoted operator<< (CRTP<T>  f, s32 i) { return {f.val << i, as_raw}; }
-	friend constexpr Promoted operator>> (CRTP<T>  f, s32 i) { return {f.val >> i, as_raw}; }
-	friend constexpr CRTP<T>& operator<<=(CRTP<T>& f, s32 i) { f.val <<= i; return f; }
-	friend constexpr CRTP<T>& operator>>=(CRTP<T>& f, s32 i) { f.val >>= i; return f; }
+	friend constexpr CRTP<T>& operator*=(CRTP<T>& f, s32 i)
+	{
+		FIX_INSTRUMENT_RECORD(RecordIntMul<T>(static_cast<s64>(f.val) * i))
+		f.val *= i; return f;
+	}
+
+	friend constexpr Promoted operator<< (CRTP<T>  f, s32 i)
+	{
+		FIX_INSTRUMENT_RECORD(RecordShiftLeft(f.val, i))
+		return {f.val << i, as_raw};
+	}
+
+	friend constexpr Promoted operator>> (CRTP<T>  f, s32 i)
+	{
+		FIX_INSTRUMENT_RECORD(RecordShiftRight(f.val, i))
+		return {f.val >> i, as_raw};
+	}
+
+	friend constexpr CRTP<T>& operator<<=(CRTP<T>& f, s32 i)
+	{
+		FIX_INSTRUMENT_RECORD(RecordShiftLeft<T>(f.val, i))
+		f.val <<= i; return f;
+	}
+
+	friend constexpr CRTP<T>& operator>>=(CRTP<T>& f, s32 i)
+	{
+		FIX_INSTRUMENT_RECORD(RecordShiftRight(f.val, i))
+		f.val >>= i; return f;
+	}
 
 	template<FixUR U> friend constexpr
 	Promoted operator&(CRTP<T>  f0, CRTP<U>  f1) { return {f0.val & f1.val, as_raw}; }
@@ -92,28 +148,38 @@ struct Fix
 	template<FixUR U> friend constexpr
 	CRTP<T>& operator^=(CRTP<T>& f0, CRTP<U>& f1) { f0.val ^= f1.val; return f0; }
 
-	template<FixUR U> [[gnu::always_inline, nodiscard]] friend
+	template<FixUR U> [[gnu::always_inline, nodiscard]] friend constexpr
 	Promoted operator*(CRTP<T> f0, CRTP<U> f1)
 	{
+		FIX_INSTRUMENT_RECORD(RecordMul(static_cast<s64>(f0.val) * f1.val, q))
+
 #ifdef FIXED_POINT_ROUND_PRODUCTS_DOWN
 		using LargeEnoughInt = std::conditional_t<sizeof(T) + sizeof(U) <= 4, s32, s64>;
 
 		return {static_cast<LargeEnoughInt>(f0.val) * f1.val >> q, as_raw};
 #else
 		const u64 product = static_cast<s64>(f0.val) * f1.val;
-		Promoted result;
-
-		asm(R"(
-			movs %[rs], %[lo], lsr %[s0]
-			adc  %[rs], %[rs], %[hi], lsl %[s1]
-		)":
-		[rs] "=&r" (result) :
-		[lo] "r" (static_cast<u32>(product)),
-		[hi] "r" (static_cast<u32>(product >> 32)),
-		[s0] "I" (q),
-		[s1] "I" (32 - q) : "cc");
-
-		return result;
+
+#ifdef __arm__
+		if !consteval
+		{
+			Promoted result;
+
+			asm(R"(
+				movs %[rs], %[lo], lsr %[s0]
+				adc  %[rs], %[rs], %[hi], lsl %[s1]
+			)":
+			[rs] "=&r" (result) :
+			[lo] "r" (static_cast<u32>(product)),
+			[hi] "r" (static_cast<u32>(product >> 32)),
+			[s0] "I" (q),
+			[s1] "I" (32 - q) : "cc");
+
+			return result;
+		}
+#endif
+		// same as the asm above: the last bit shifted out is added back like the carry flag
+		return {static_cast<s32>((product >> q) + (product >> (q - 1) & 1)), as_raw};
 #endif
 	}
 
@@ -129,7 +195,7 @@ struct Fix
 		f0.val %= f1.val; return f0;
 	}
 
-	template<FixUR U> friend inline
+	template<FixUR U> friend constexpr
 	CRTP<T>& operator*=(CRTP<T>& f0, CRTP<U> f1) { return f0 = f0 * f1; }
 
 	template<FixUR U> friend constexpr
@@ -195,25 +261,154 @@ struct Fix12 : Fix<T, 12, Fix12>
 using Fix12i = Fix12<s32>;
 using Fix12s = Fix12<s16>;
 
-consteval Fix12i operator""_f (u64 val) { return Fix12i(val, as_raw); }
-consteval Fix12s operator""_fs(u64 val) { return Fix12s(val, as_raw); }
+consteval Fix12i operator""_f (unsigned long long val) { return Fix12i(val, as_raw); }
+consteval Fix12s operator""_fs(unsigned long long val) { return Fix12s(val, as_raw); }
 
 consteval Fix12i operator""_f (long double val) { return Fix12i(val); }
 consteval Fix12s operator""_fs(long double val) { return Fix12s(val); }
 
-extern const Fix12s SINE_TABLE[0x2000];
-extern const Fix12s ATAN_TABLE[0x400];
+// Formats with more range (Fix8) or more precision (Fix20) than Fix12, e.g. for positions in
+// levels larger than Fix12i can address. They don't mix with Fix12 implicitly; use FixCast.
+template<FixUR T>
+struct Fix8 : Fix<T, 8, Fix8>
+{
+	using Fix<T, 8, Fix8>::Fix;
+};
+
+template<FixUR T>
+struct Fix20 : Fix<T, 20, Fix20>
+{
+	using Fix<T, 20, Fix20>::Fix;
+};
+
+using Fix8i  = Fix8<s32>;
+using Fix20i = Fix20<s32>;
+
+consteval Fix8i  operator""_f8 (unsigned long long val) { return Fix8i (val, as_raw); }
+consteval Fix20i operator""_f20(unsigned long long val) { return Fix20i(val, as_raw); }
+
+consteval Fix8i  operator""_f8 (long double val) { return Fix8i (val); }
+consteval Fix20i operator""_f20(long double val) { return Fix20i(val); }
+
+// Converts between fixed-point formats with a single shift. Converting to fewer fractional
+// bits rounds down like Vec3_Asr, and converting to more can overflow, like <<.
+template<FixedPoint To, FixedPoint From> [[gnu::always_inline, nodiscard]]
+constexpr To FixCast(From f)
+{
+	using ToUR = Underlying<To>;
+	constexpr s32 shift = To::fracBits - From::fracBits;
+
+	if constexpr (shift >= 0)
+		return To(static_cast<ToUR>(f.val << shift), as_raw);
+	else
+		return To(static_cast<ToUR>(f.val >> -shift), as_raw);
+}
+
+extern const Fix12s SINE_TABLE[0x2000]; // sine and cosine interleaved, for 0x1000 angles
+extern const Fix12s ATAN_TABLE[0x400];  // atan(i / 0x400) as an angle, for i in [0, 0x400)
+
+// Generators for the entries of SINE_TABLE and ATAN_TABLE, so that trigonometry
+// on angles known at compile time can be folded into constants. They are compared
+// with the tables of the game by tests/TrigTablesTest.cpp; at runtime, the tables
+// of the game are still used.
+namespace TrigTables
+{
+	constexpr long double pi = 3.141592653589793238462643383279502884L;
+
+	// Taylor series, accurate to long double precision for |x| <= pi/4
+	consteval long double SinSeries(long double x)
+	{
+		long double term = x, sum = x;
+
+		for (s32 n = 1; n < 12; n++)
+		{
+			term *= -x * x / ((2 * n) * (2 * n + 1));
+			sum += term;
+		}
+
+		return sum;
+	}
+
+	consteval long double CosSeries(long double x)
+	{
+		long double term = 1, sum = 1;
+
+		for (s32 n = 1; n < 12; n++)
+		{
+			term *= -x * x / ((2 * n - 1) * (2 * n));
+			sum += term;
+		}
+
+		return sum;
+	}
+
+	// Taylor series, accurate to long double precision for |x| <= 1/3
+	consteval long double AtanSeries(long double x)
+	{
+		long double power = x, sum = x;
+
+		for (s32 n = 1; n < 40; n++)
+		{
+			power *= -x * x;
+			sum += power / (2 * n + 1);
+		}
+
+		return sum;
+	}
+
+	// sin(2 pi * i / 0x1000)
+	consteval long double Sin(s32 i)
+	{
+		i &= 0xfff;
+
+		if (i >= 0x800) return -Sin(i - 0x800);
+		if (i >  0x400) i = 0x800 - i;
+
+		return i <= 0x200
+			? SinSeries(pi * i / 0x800)
+			: CosSeries(pi * (0x400 - i) / 0x800);
+	}
+
+	// atan(x) for 0 <= x <= 1
+	consteval long double Atan(long double x)
+	{
+		return x <= 0.5L
+			? AtanSeries(x)
+			: pi / 4 + AtanSeries((x - 1) / (x + 1));
+	}
+
+	consteval s32 Round(long double x)
+	{
+		return static_cast<s32>(x >= 0 ? x + 0.5L : x - 0.5L);
+	}
+
+	consteval Fix12s SineEntry(u32 index) // SINE_TABLE[index]
+	{
+		return {Round(Sin((index >> 1) + (index & 1 ? 0x400 : 0)) * 0x1000), as_raw};
+	}
+
+	consteval Fix12s AtanEntry(u32 index) // ATAN_TABLE[index]
+	{
+		return {Round(Atan(index / 1024.L) * 0x8000 / pi), as_raw};
+	}
+}
 
 [[gnu::always_inline]]
-inline const Fix12s& Sin(s16 angle)
+constexpr Fix12s Sin(s16 angle)
 {
-	return SINE_TABLE[static_cast<u16>(angle + 8) >> 4 << 1];
+	const u32 index = static_cast<u16>(angle + 8) >> 4 << 1;
+
+	if consteval { return TrigTables::SineEntry(index); }
+	else { return SINE_TABLE[index]; }
 }
 
 [[gnu::always_inline]]
-inline const Fix12s& Cos(s16 angle)
+constexpr Fix12s Cos(s16 angle)
 {
-	return SINE_TABLE[1 + (static_cast<u16>(angle + 8) >> 4 << 1)];
+	const u32 index = 1 + (static_cast<u16>(angle + 8) >> 4 << 1);
+
+	if consteval { return TrigTables::SineEntry(index); }
+	else { return SINE_TABLE[index]; }
 }
 
 s16 Atan2(s32 y, s32 x); // atan2 function, what about 0x020538b8?
@@ -224,6 +419,26 @@ Fix12i InvSqrt(Fix12i x);
 
 inline s16 Atan2(Fix12i y, Fix12i x) { return Atan2(y.val, x.val); }
 
+// An atan2 for constant expressions, with an octant reduction and table lookup that are assumed to be
+// the ones of Atan2 but haven't been checked against angles recorded from the game, so Atan2 doesn't
+// use it when it's constant-evaluated. Call it explicitly where a constant may differ slightly.
+consteval s16 Atan2Const(s32 y, s32 x)
+{
+	const s64 ax = x >= 0 ? x : -static_cast<s64>(x);
+	const s64 ay = y >= 0 ? y : -static_cast<s64>(y);
+
+	if (ax == 0 && ay == 0) return 0;
+
+	s32 angle = ay <= ax
+		? (ay == ax ? 0x2000 : TrigTables::AtanEntry((ay << 10) / ax).val)
+		: 0x4000 - TrigTables::AtanEntry((ax << 10) / ay).val;
+
+	if (x < 0) angle = 0x8000 - angle;
+	if (y < 0) angle = -angle;
+
+	return static_cast<s16>(angle);
+}
+
 Fix12i HardwareDivResultQ12();
 Fix12i HardwareDivQ12(Fix12i numerator, Fix12i denominator);
 
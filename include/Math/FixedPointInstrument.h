@@ -0,0 +1,172 @@
+#pragma once
+
+#include "ostream.h"
+#include "MathCommon.h"
+#include <limits>
+
+/*
+	INFORMATION
+	Defining FIXED_POINT_INSTRUMENT makes the Fix operators count, at run time, how often they
+	overflow or throw away precision. The counts are kept per tag, and the tag is set by
+	FIX_INSTRUMENT_SCOPE("name") for the rest of the enclosing block. Operations outside of
+	any scope are counted under "untagged". Print the table with FixInstrument::Dump(cout), the
+	sites with the most overflows first. Host builds, where the game's ostream doesn't print, use
+	FixInstrument::Report of FixedPointReport.h instead.
+
+	What is counted:
+	- a * b:  overflow if the result doesn't fit in 32 bits,
+	          precision loss if a nonzero product rounds to 0 (or is truncated to 0
+	          with FIXED_POINT_ROUND_PRODUCTS_DOWN)
+	- a + b, a - b, -a, a << i, a * n, n * a: overflow if the result doesn't fit in 32 bits
+	- a += b, a -= b, a <<= i, a *= n: overflow if the result doesn't fit in the type of a
+	- a >> i, a >>= i: precision loss if any nonzero bit is shifted out
+
+	Without FIXED_POINT_INSTRUMENT, this header is empty and the scopes compile to nothing.
+	Constant evaluation is never counted.
+*/
+
+#ifdef FIXED_POINT_INSTRUMENT
+
+namespace FixInstrument
+{
+	struct Site
+	{
+		const char* tag;
+		u32 numOps;
+		u32 numOverflows;
+		u32 numPrecisionLosses;
+	};
+
+	static constexpr u32 MAX_SITES = 32;
+
+	inline constinit Site sites[MAX_SITES] = {{"untagged", 0, 0, 0}};
+	inline constinit u32 numSites = 1;
+	inline constinit u32 currentSite = 0;
+
+	// Tags are compared by address, so pass string literals
+	inline u32 FindOrAddSite(const char* tag)
+	{
+		for (u32 i = 0; i < numSites; i++)
+			if (sites[i].tag == tag) return i;
+
+		if (numSites == MAX_SITES) return 0;
+
+		sites[numSites] = {tag, 0, 0, 0};
+		return numSites++;
+	}
+
+	template<class T = s32>
+	inline bool Overflows(s64 x)
+	{
+		return x < std::numeric_limits<T>::min() || x > std::numeric_limits<T>::max();
+	}
+
+	inline void Record(bool overflow, bool precisionLoss)
+	{
+		Site& site = sites[currentSite];
+
+		site.numOps++;
+		site.numOverflows += overflow;
+		site.numPrecisionLosses += precisionLoss;
+	}
+
+	// The product of the raw values, before it's shifted down by q
+	inline void RecordMul(s64 product, s32 q)
+	{
+#ifdef FIXED_POINT_ROUND_PRODUCTS_DOWN
+		const s64 res = product >> q;
+#else
+		const s64 res = (product + (1ll << (q - 1))) >> q;
+#endif
+
+		Record(Overflows(res), product != 0 && res == 0);
+	}
+
+	template<class T = s32>
+	inline void RecordAdd(s64 sum) { Record(Overflows<T>(sum), false); }
+
+	template<class T = s32>
+	inline void RecordIntMul(s64 product) { Record(Overflows<T>(product), false); }
+
+	template<class T = s32>
+	inline void RecordShiftLeft(s32 val, s32 i)
+	{
+		Record(val != 0 && (i >= 32 || Overflows<T>(static_cast<s64>(val) << i)), false);
+	}
+
+	inline void RecordShiftRight(s32 val, s32 i)
+	{
+		const u32 shiftedOut = i <= 0 ? 0 : i >= 32 ? ~0u : ~0u >> (32 - i);
+
+		Record(false, (static_cast<u32>(val) & shiftedOut) != 0);
+	}
+
+	inline void Reset()
+	{
+		for (u32 i = 0; i < numSites; i++)
+			sites[i].numOps = sites[i].numOverflows = sites[i].numPrecisionLosses = 0;
+	}
+
+	// Fills res with the sites that counted any operations, the most overflows first and then the
+	// most precision losses, and returns how many there are
+	inline u32 SortSites(const Site* (&res)[MAX_SITES])
+	{
+		const auto before = [](const Site& a, const Site& b)
+		{
+			return a.numOverflows != b.numOverflows ? a.numOverflows > b.numOverflows : a.numPrecisionLosses > b.numPrecisionLosses;
+		};
+
+		u32 numSorted = 0;
+
+		for (u32 i = 0; i < numSites; i++)
+		{
+			if (sites[i].numOps == 0) continue;
+
+			u32 j = numSorted++;
+			for (; j > 0 && before(sites[i], *res[j - 1]); j--)
+				res[j] = res[j - 1];
+
+			res[j] = &sites[i];
+		}
+
+		return numSorted;
+	}
+
+	inline void Dump(const ostream& os)
+	{
+		const Site* sorted[MAX_SITES];
+
+		for (u32 i = 0, numSorted = SortSites(sorted); i < numSorted; i++)
+		{
+			const Site& site = *sorted[i];
+
+			os << site.tag << ": ops " << site.numOps
+			   << ", overflows " << site.numOverflows
+			   << ", precision losses " << site.numPrecisionLosses << '\n';
+		}
+	}
+
+	class Scope
+	{
+		u32 prevSite;
+
+	public:
+		explicit Scope(const char* tag) : prevSite(currentSite) { currentSite = FindOrAddSite(tag); }
+		~Scope() { currentSite = prevSite; }
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+	};
+}
+
+#define FIX_INSTRUMENT_CONCAT_IMPL(a, b) a##b
+#define FIX_INSTRUMENT_CONCAT(a, b) FIX_INSTRUMENT_CONCAT_IMPL(a, b)
+#define FIX_INSTRUMENT_SCOPE(tag) const FixInstrument::Scope FIX_INSTRUMENT_CONCAT(fixInstrumentScope, __LINE__){tag}
+#define FIX_INSTRUMENT_RECORD(...) if !consteval { FixInstrument::__VA_ARGS__; }
+
+#else
+
+#define FIX_INSTRUMENT_SCOPE(tag)
+#define FIX_INSTRUMENT_RECORD(...)
+
+#endif
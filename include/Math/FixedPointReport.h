@@ -0,0 +1,41 @@
+#pragma once
+
+#include "FixedPointInstrument.h"
+#include <cstdio>
+
+/*
+	INFORMATION
+	Host-side report of the FIXED_POINT_INSTRUMENT counts (it isn't included by SM64DS_PI.h), for
+	builds that run test vectors through game math on a PC, where the game's ostream doesn't print:
+
+		{
+			FIX_INSTRUMENT_SCOPE("player gravity");
+			... // the code under test
+		}
+
+		FixInstrument::Report(); // to stdout
+
+	prints one row per tag, the tags with the most overflows first, like FixInstrument::Dump.
+	tests/FixedPointInstrumentTest.cpp runs physics steps through it.
+*/
+
+#ifdef FIXED_POINT_INSTRUMENT
+
+namespace FixInstrument
+{
+	inline void Report(std::FILE* file = stdout)
+	{
+		const Site* sorted[MAX_SITES];
+		const u32 numSorted = SortSites(sorted);
+
+		std::fprintf(file, "%-24s %10s %10s %10s\n", "tag", "ops", "overflows", "precision");
+
+		for (u32 i = 0; i < numSorted; i++)
+		{
+			const Site& site = *sorted[i];
+			std::fprintf(file, "%-24s %10u %10u %10u\n", site.tag, site.numOps, site.numOverflows, site.numPrecisionLosses);
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "MathCommon.h"
+#include "FixedPoint.h"
+#include "../NDSCore.h"
+
+/*
+	INFORMATION
+	The DS has a hardware divider and a hardware square root unit which work independently of the CPU
+	and of each other. The synchronous functions (HardwareDivQ12, Sqrt, Fix12i::Inverse, ...) start an
+	operation and immediately wait for its result, so the CPU idles for the whole latency. MathPipeline
+	collects a batch of jobs instead and keeps both units busy: every step issues one division and one
+	square root, optionally runs independent CPU work supplied by the caller while they are in flight,
+	and only then reads the results back. Results are identical to the synchronous functions because
+	the same game functions are used to start the operations and to read the results.
+*/
+
+// Saves the divider and square root unit state on construction and restores it on destruction,
+// so that a batch of jobs can't clobber an operation that was started before it
+struct ARMMathStateGuard
+{
+	ARMMathState state;
+
+	[[gnu::always_inline]] ARMMathStateGuard() { ARMMathSaveState(&state); }
+	[[gnu::always_inline]] ~ARMMathStateGuard() { ARMMathLoadState(&state); }
+
+	ARMMathStateGuard(const ARMMathStateGuard&) = delete;
+	ARMMathStateGuard& operator=(const ARMMathStateGuard&) = delete;
+};
+
+template<u32 capacity>
+class MathPipeline
+{
+	struct DivJob
+	{
+		Fix12i numerator;
+		Fix12i denominator;
+		Fix12i* res;
+		bool inverse;
+	};
+
+	struct SqrtJob
+	{
+		Fix12i x;
+		Fix12i* res;
+	};
+
+	DivJob divJobs[capacity];
+	SqrtJob sqrtJobs[capacity];
+	u16 numDivJobs = 0;
+	u16 numSqrtJobs = 0;
+
+	[[gnu::always_inline]]
+	void IssueDiv(const DivJob& job)
+	{
+		if (job.inverse)
+			job.denominator.InverseAsync();
+		else
+			HardwareDivAsync(job.numerator, job.denominator);
+	}
+
+public:
+	// Each of these returns false without queueing the job if the pipeline is full.
+	// res is written when Run is called, so it must stay valid until then.
+	bool Div(Fix12i numerator, Fix12i denominator, Fix12i& res) &
+	{
+		if (numDivJobs == capacity) return false;
+
+		divJobs[numDivJobs++] = {numerator, denominator, &res, false};
+		return true;
+	}
+
+	bool Inverse(Fix12i x, Fix12i& res) &
+	{
+		if (numDivJobs == capacity) return false;
+
+		divJobs[numDivJobs++] = {1._f, x, &res, true};
+		return true;
+	}
+
+	bool Sqrt(Fix12i x, Fix12i& res) &
+	{
+		if (numSqrtJobs == capacity) return false;
+
+		sqrtJobs[numSqrtJobs++] = {x, &res};
+		return true;
+	}
+
+	[[nodiscard]] u32 NumQueued() const { return numDivJobs > numSqrtJobs ? numDivJobs : numSqrtJobs; }
+	[[nodiscard]] bool Full() const { return numDivJobs == capacity || numSqrtJobs == capacity; }
+
+	// Runs all queued jobs and empties the queue. work(step) is called once per step while
+	// that step's division and square root are in flight; it must not use the divider or
+	// the square root unit itself (which rules out Fix12i division, Sqrt, Len, Normalize, ...).
+	template<class F>
+	void Run(F&& work) &
+	{
+		const ARMMathStateGuard guard;
+		const u32 numSteps = NumQueued();
+
+		for (u32 i = 0; i < numSteps; i++)
+		{
+			const bool hasDiv  = i < numDivJobs;
+			const bool hasSqrt = i < numSqrtJobs;
+
+			if (hasDiv)  IssueDiv(divJobs[i]);
+			if (hasSqrt) SqrtAsync(sqrtJobs[i].x);
+
+			work(i);
+
+			if (hasDiv)  *divJobs[i].res = HardwareDivResultQ12();
+			if (hasSqrt) *sqrtJobs[i].res = SqrtResultFix12i();
+		}
+
+		numDivJobs = 0;
+		numSqrtJobs = 0;
+	}
+
+	void Run() & { Run([](u32) {}); }
+};
@@ -10,6 +10,14 @@ struct Matrix3x3;
 struct Matrix4x3;
 struct Quaternion;
 
+// long call to force gcc to actually call the off-by-one address and therefore set the mode to thumb.
+// Host builds (see tests/) never call the game's functions, and x86 has no thumb mode.
+#ifdef __arm__
+#define THUMB_LONG_CALL __attribute__((long_call, target("thumb")))
+#else
+#define THUMB_LONG_CALL
+#endif
+
 extern "C"
 {
 	void Matrix3x3_FromQuaternion(const Quaternion& q, Matrix3x3& mF);
@@ -32,15 +40,14 @@ extern "C"
 	void MulVec3Mat3x3(const Vector3& v, const Matrix3x3& m, Vector3& res);
 	void MulMat3x3Mat3x3(const Matrix3x3& m1, const Matrix3x3& m0, Matrix3x3& mF); //m0 is applied to m1, so it's m0*m1=mF
 	void Matrix4x3_LoadIdentity(Matrix4x3& mF);
-	// long call to force gcc to actually call the off-by-one address and therefore set the mode to thumb.
-	void Matrix4x3_FromScale(Matrix4x3& mF, Fix12i x, Fix12i y, Fix12i z) __attribute__((long_call, target("thumb")));
+	void Matrix4x3_FromScale(Matrix4x3& mF, Fix12i x, Fix12i y, Fix12i z) THUMB_LONG_CALL;
 	void MulVec3Mat4x3(const Vector3& v, const Matrix4x3& m, Vector3& res);
 	void MulMat4x3Mat4x3(const Matrix4x3& m1, const Matrix4x3& m0, Matrix4x3& mF); //m0 is applied to m1, so it's m0*m1=mF
 	void InvMat4x3(const Matrix4x3& m0, Matrix4x3& mF);		//Loads inverse of m0 into mF
 
-	void Matrix3x3_SetRotationX(Matrix3x3& m, Fix12i sinTheta, Fix12i cosTheta) __attribute__((long_call, target("thumb"))); //Resets m to an X rotation matrix
-	void Matrix3x3_SetRotationY(Matrix3x3& m, Fix12i sinTheta, Fix12i cosTheta) __attribute__((long_call, target("thumb"))); //Resets m to a Y rotation matrix
-	void Matrix3x3_SetRotationZ(Matrix3x3& m, Fix12i sinTheta, Fix12i cosTheta) __attribute__((long_call, target("thumb"))); //Resets m to a Z rotation matrix
+	void Matrix3x3_SetRotationX(Matrix3x3& m, Fix12i sinTheta, Fix12i cosTheta) THUMB_LONG_CALL; //Resets m to an X rotation matrix
+	void Matrix3x3_SetRotationY(Matrix3x3& m, Fix12i sinTheta, Fix12i cosTheta) THUMB_LONG_CALL; //Resets m to a Y rotation matrix
+	void Matrix3x3_SetRotationZ(Matrix3x3& m, Fix12i sinTheta, Fix12i cosTheta) THUMB_LONG_CALL; //Resets m to a Z rotation matrix
 }
 
 struct Matrix2x2 // Matrix is column-major!
@@ -566,6 +573,98 @@ struct Matrix4x3 : private Matrix3x3 // Matrix is column-major!
 			});
 		}
 
+		[[gnu::always_inline, nodiscard]]
+		auto RotateZXY(const s16& angX, const s16& angY, const s16& angZ) &&
+		{
+			return NewProxy([this, &angX, &angY, &angZ]<bool resMayAlias> [[gnu::always_inline]] (Matrix4x3& res)
+			{
+				Eval<resMayAlias>(res);
+				res.RotateZXY(angX, angY, angZ);
+			});
+		}
+
+		[[gnu::always_inline, nodiscard]]
+		auto RotateXYZ(const s16& angX, const s16& angY, const s16& angZ) &&
+		{
+			return NewProxy([this, &angX, &angY, &angZ]<bool resMayAlias> [[gnu::always_inline]] (Matrix4x3& res)
+			{
+				Eval<resMayAlias>(res);
+				res.RotateXYZ(angX, angY, angZ);
+			});
+		}
+
+		[[gnu::always_inline, nodiscard]]
+		auto RotateZXY(const Vector3_16& ang) &&
+		{
+			return NewProxy([this, &ang]<bool resMayAlias> [[gnu::always_inline]] (Matrix4x3& res)
+			{
+				Eval<resMayAlias>(res);
+				res.RotateZXY(ang);
+			});
+		}
+
+		[[gnu::always_inline, nodiscard]]
+		auto RotateXYZ(const Vector3_16& ang) &&
+		{
+			return NewProxy([this, &ang]<bool resMayAlias> [[gnu::always_inline]] (Matrix4x3& res)
+			{
+				Eval<resMayAlias>(res);
+				res.RotateXYZ(ang);
+			});
+		}
+
+		// Translate and ApplyScale work on the result in place, so a chain like
+		// Matrix4x3::RotationY(ang).Translate(pos).ApplyScale(scale) needs no temporary matrices
+		[[gnu::always_inline, nodiscard]]
+		auto Translate(const Fix12i& x, const Fix12i& y, const Fix12i& z) &&
+		{
+			return NewProxy([this, &x, &y, &z]<bool resMayAlias> [[gnu::always_inline]] (Matrix4x3& res)
+			{
+				if constexpr (resMayAlias)
+				{
+					const Vector3 temp = {x, y, z}; // the arguments may be altered while the matrix is calculated
+					Eval<resMayAlias>(res);
+					res.Translate(temp);
+				}
+				else
+				{
+					Eval<resMayAlias>(res);
+					res.Translate(x, y, z);
+				}
+			});
+		}
+
+		[[gnu::always_inline, nodiscard]]
+		auto Translate(const Vector3& v) &&
+		{
+			return std::move(*this).Translate(v.x, v.y, v.z);
+		}
+
+		[[gnu::always_inline, nodiscard]]
+		auto ApplyScale(const Fix12i& x, const Fix12i& y, const Fix12i& z) &&
+		{
+			return NewProxy([this, &x, &y, &z]<bool resMayAlias> [[gnu::always_inline]] (Matrix4x3& res)
+			{
+				if constexpr (resMayAlias)
+				{
+					const Vector3 temp = {x, y, z};
+					Eval<resMayAlias>(res);
+					res.ApplyScale(temp);
+				}
+				else
+				{
+					Eval<resMayAlias>(res);
+					res.ApplyScale(x, y, z);
+				}
+			});
+		}
+
+		[[gnu::always_inline, nodiscard]]
+		auto ApplyScale(const Vector3& v) &&
+		{
+			return std::move(*this).ApplyScale(v.x, v.y, v.z);
+		}
+
 		[[gnu::always_inline, nodiscard]]
 		auto operator()(const Matrix4x3& other) &&
 		{
@@ -675,8 +774,8 @@ struct Matrix4x3 : private Matrix3x3 // Matrix is column-major!
 	template<class F> [[gnu::always_inline]]
 	Matrix4x3& operator=(Proxy<F>&& proxy) & { proxy.template Eval<true>(*this); return *this; }
 
-	      Matrix3x3& Linear()       { return *this; }
-	const Matrix3x3& Linear() const { return *this; }
+	constexpr       Matrix3x3& Linear()       { return *this; }
+	constexpr const Matrix3x3& Linear() const { return *this; }
 
 	Matrix4x3& RotateZ(s16 angZ) & { Matrix4x3_ApplyInPlaceToRotationZ(*this, angZ); return *this; }
 	Matrix4x3& RotateY(s16 angY) & { Matrix4x3_ApplyInPlaceToRotationY(*this, angY); return *this; }
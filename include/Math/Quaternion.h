@@ -4,6 +4,7 @@
 #include "Proxy.h"
 #include "Vector.h"
 #include <algorithm>
+#include <span>
 
 extern "C"
 {
@@ -14,6 +15,7 @@ extern "C"
 }
 
 inline void Quaternion_FromMatrix3x3(Quaternion& gF, const Matrix3x3& m);
+inline void Quaternion_Slerp(const Quaternion& q0, const Quaternion& q1, Fix12i t, Quaternion& qF);
 
 struct Quaternion : private Vector3
 {
@@ -825,6 +827,40 @@ inline auto LerpShortestPath(Q0&& q0, Quaternion::Proxy<F>&& q1, const Fix12i& t
 	});
 }
 
+// Normalized LerpShortestPath. It's cheap and accurate enough for
+// the small differences between poses that are blended frame by frame.
+[[gnu::always_inline, nodiscard]]
+inline auto Nlerp(const Quaternion& q0, const Quaternion& q1, const Fix12i& t)
+{
+	return Quaternion::Proxy([&q0, &q1, &t]<bool resMayAlias> [[gnu::always_inline]] (Quaternion& res)
+	{
+		LerpShortestPath(q0, q1, t).template Eval<resMayAlias>(res);
+		res.Normalize();
+	});
+}
+
+// Rotates at a constant angular speed along the shorter arc between q0 and q1
+[[gnu::always_inline, nodiscard]]
+inline auto Slerp(const Quaternion& q0, const Quaternion& q1, const Fix12i& t)
+{
+	return Quaternion::Proxy([&q0, &q1, &t]<bool resMayAlias> [[gnu::always_inline]] (Quaternion& res)
+	{
+		Quaternion_Slerp(q0, q1, t, res);
+	});
+}
+
+// Blends every bone rotation in poses towards the matching one in targets (e.g. for crossfading
+// between two animations). If the spans have different sizes, only the bones that are in both
+// are blended. Uses Nlerp, so for large differences between the poses, Slerp each bone instead
+// if a constant speed is needed.
+inline void BlendPoses(std::span<Quaternion> poses, std::span<const Quaternion> targets, Fix12i t)
+{
+	const std::size_t numBones = std::min(poses.size(), targets.size());
+
+	for (std::size_t i = 0; i < numBones; i++)
+		poses[i] = Nlerp(poses[i], targets[i], t);
+}
+
 inline const ostream& operator<<(const ostream& os, const Quaternion& q)
 {
 	os.set_buffer("+0x%r0%_f + 0x%r1%_f i + 0x%r2%_f j + 0x%r3%_f k");
@@ -887,3 +923,28 @@ inline void Quaternion_FromMatrix3x3(Quaternion& res, const Matrix3x3& m)
 
 	res *= SqrtResultFix12i().Inverse();
 }
+
+inline void Quaternion_Slerp(const Quaternion& q0, const Quaternion& q1, Fix12i t, Quaternion& res)
+{
+	Fix12i cosTheta = q0.Dot(q1);
+	const bool flip = cosTheta < 0._f;
+	if (flip) cosTheta = -cosTheta;
+
+	// sin(theta) gets too imprecise to divide by below about 5 degrees, where Nlerp is just as good
+	if (cosTheta >= Fix12i(0xff0, as_raw))
+	{
+		res = Nlerp(q0, q1, t);
+		return;
+	}
+
+	const Fix12i sinTheta = Sqrt(1._f - cosTheta * cosTheta);
+	const s32 theta = Atan2(sinTheta, cosTheta); // in [0, 0x4000]
+	const s16 angle1 = static_cast<s16>(t.val * theta >> 12);
+	const s16 angle0 = static_cast<s16>(theta - angle1);
+
+	const Fix12i invSin = sinTheta.Inverse();
+	const Fix12i w0 = Fix12i(Sin(angle0)) * invSin;
+	const Fix12i w1 = Fix12i(Sin(angle1)) * invSin;
+
+	res = q0 * w0 + q1 * (flip ? -w1 : w1);
+}
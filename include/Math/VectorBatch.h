@@ -0,0 +1,144 @@
+#pragma once
+
+#include "MathCommon.h"
+#include "FixedPoint.h"
+#include "Vector.h"
+#include "Matrix.h"
+#include <algorithm>
+#include <span>
+#include <tuple>
+
+// A structure-of-arrays view of many vectors, meant for transforming
+// whole point sets (particles, shadow vertices, ...) with a single call.
+// The three spans should have the same size; only the shortest one is used.
+struct Vector3Batch
+{
+	std::span<Fix12i> x, y, z;
+
+	[[nodiscard]]
+	constexpr std::size_t size() const { return std::min({x.size(), y.size(), z.size()}); }
+
+	[[nodiscard]]
+	constexpr Vector3 operator[](std::size_t i) const { return {x[i], y[i], z[i]}; }
+
+	constexpr void Set(std::size_t i, const Vector3& v) const
+	{
+		x[i] = v.x;
+		y[i] = v.y;
+		z[i] = v.z;
+	}
+
+	// Loads vectors from / stores vectors to an array-of-structures layout,
+	// as many as both of them have
+	constexpr void Gather(std::span<const Vector3> vs) const
+	{
+		for (std::size_t i = 0; i < std::min(vs.size(), size()); i++)
+			Set(i, vs[i]);
+	}
+
+	constexpr void Scatter(std::span<Vector3> vs) const
+	{
+		for (std::size_t i = 0; i < std::min(vs.size(), size()); i++)
+			vs[i] = (*this)[i];
+	}
+};
+
+namespace BatchImpl
+{
+	// Each output component is accumulated in 64 bits and shifted down once, without
+	// rounding, like MulVec3Mat4x3 / MulVec3Mat3x3 (MTX_MultVec43 / MTX_MultVec33 of the
+	// NitroSDK), so that the batched results are the same as the ones of the scalar path.
+	[[gnu::always_inline]]
+	constexpr s32 Dot3(s32 m0, s32 m1, s32 m2, s32 x, s32 y, s32 z)
+	{
+		const s64 sum = static_cast<s64>(m0) * x + static_cast<s64>(m1) * y + static_cast<s64>(m2) * z;
+
+		return static_cast<s32>(sum >> 12);
+	}
+
+	// load(i) returns the i-th source vector and store(i) returns references to the
+	// components of the i-th destination vector, which lets one loop serve both layouts
+	[[gnu::always_inline]]
+	constexpr void Transform(const Matrix3x3& m, const Vector3* translation, std::size_t count, auto load, auto store)
+	{
+		// hoisting the coefficients keeps them in registers for the whole loop,
+		// and the unrolled body lets GCC use ldm/stm on ARM or vectorize on other targets
+		const s32 m00 = m.c0.x.val, m01 = m.c1.x.val, m02 = m.c2.x.val;
+		const s32 m10 = m.c0.y.val, m11 = m.c1.y.val, m12 = m.c2.y.val;
+		const s32 m20 = m.c0.z.val, m21 = m.c1.z.val, m22 = m.c2.z.val;
+		const s32 tx = translation ? translation->x.val : 0;
+		const s32 ty = translation ? translation->y.val : 0;
+		const s32 tz = translation ? translation->z.val : 0;
+
+#pragma GCC unroll 4
+		for (std::size_t i = 0; i < count; i++)
+		{
+			// read all components first so that src and dst may be the same array
+			const auto& [sx, sy, sz] = load(i);
+			const s32 x = sx.val;
+			const s32 y = sy.val;
+			const s32 z = sz.val;
+
+			auto&& [dx, dy, dz] = store(i);
+			dx.val = Dot3(m00, m01, m02, x, y, z) + tx;
+			dy.val = Dot3(m10, m11, m12, x, y, z) + ty;
+			dz.val = Dot3(m20, m21, m22, x, y, z) + tz;
+		}
+	}
+
+	[[gnu::always_inline]]
+	constexpr auto Loader(const Vector3Batch& b)
+	{
+		return [&b] [[gnu::always_inline]] (std::size_t i) { return std::tie(b.x[i], b.y[i], b.z[i]); };
+	}
+
+	[[gnu::always_inline]]
+	constexpr auto Loader(std::span<const Vector3> vs)
+	{
+		return [vs] [[gnu::always_inline]] (std::size_t i) -> const Vector3& { return vs[i]; };
+	}
+
+	[[gnu::always_inline]]
+	constexpr auto Storer(const Vector3Batch& b) { return Loader(b); }
+
+	[[gnu::always_inline]]
+	constexpr auto Storer(std::span<Vector3> vs)
+	{
+		return [vs] [[gnu::always_inline]] (std::size_t i) -> Vector3& { return vs[i]; };
+	}
+}
+
+// Transforms every point of src by m and writes the results to dst. If src and dst have different
+// sizes, only as many vectors as the smaller one has are transformed.
+// src and dst may be the same array, but must not partially overlap.
+constexpr void TransformPoints(const Matrix4x3& m, const Vector3Batch& src, const Vector3Batch& dst)
+{
+	BatchImpl::Transform(m.Linear(), &m.c3, std::min(src.size(), dst.size()), BatchImpl::Loader(src), BatchImpl::Storer(dst));
+}
+
+// Transforms every direction / normal of src by the linear part of m (no translation)
+constexpr void TransformNormals(const Matrix3x3& m, const Vector3Batch& src, const Vector3Batch& dst)
+{
+	BatchImpl::Transform(m, nullptr, std::min(src.size(), dst.size()), BatchImpl::Loader(src), BatchImpl::Storer(dst));
+}
+
+constexpr void TransformNormals(const Matrix4x3& m, const Vector3Batch& src, const Vector3Batch& dst)
+{
+	TransformNormals(m.Linear(), src, dst);
+}
+
+// Array-of-structures versions for callers that already store Vector3 arrays
+constexpr void TransformPoints(const Matrix4x3& m, std::span<const Vector3> src, std::span<Vector3> dst)
+{
+	BatchImpl::Transform(m.Linear(), &m.c3, std::min(src.size(), dst.size()), BatchImpl::Loader(src), BatchImpl::Storer(dst));
+}
+
+constexpr void TransformNormals(const Matrix3x3& m, std::span<const Vector3> src, std::span<Vector3> dst)
+{
+	BatchImpl::Transform(m, nullptr, std::min(src.size(), dst.size()), BatchImpl::Loader(src), BatchImpl::Storer(dst));
+}
+
+constexpr void TransformNormals(const Matrix4x3& m, std::span<const Vector3> src, std::span<Vector3> dst)
+{
+	TransformNormals(m.Linear(), src, dst);
+}
@@ -386,3 +386,10 @@ namespace Memory
 			return ptr;
 	}
 }
+
+#include "Memory/HeapHook.h"
+#include "Memory/HeapTelemetry.h"
+#include "Memory/ScratchArena.h"
+#include "Memory/SegregatedFit.h"
+#include "Memory/HeapTraceWriter.h"
+#include "Memory/AllocationTracer.h"
@@ -0,0 +1,379 @@
+#pragma once
+
+extern u32 FRAME_COUNTER;
+
+/*
+	INFORMATION
+	Memory::Allocate, Memory::malloc, operator new, Memory::Deallocate, Memory::free and operator delete
+	all end up in the VAllocate and VDeallocate of a heap, but nothing records who allocated what.
+	AllocationTracer hooks those of up to MAX_HEAPS ExpandingHeaps (through a copy of their vtables,
+	like SegregatedFitIndex) and keeps a table of the live allocations with their size, the frame they
+	were made on and the code that made them:
+
+		AllocationTracer tracer;                 // a global, it's about 20 KB
+		tracer.Install(*Memory::rootHeapPtr);
+		tracer.Install(*Memory::gameHeapPtr);
+
+		// in a hook of Scene::SetSceneToSpawn, if it returns true:
+		tracer.OnSceneChange(cout);
+
+	OnSceneChange reports every allocation that was made during the scene before the current one and is
+	still alive, grouped by caller. When it's called, the current scene is still alive and about to be
+	replaced, so allocations of the scene before it should have been freed by then. Files that are
+	kept loaded on purpose (e.g. by a SharedFilePtr that is never released) show up as well.
+
+	There are no frame pointers to walk, so the callers are found by scanning the stack above the hook
+	for words that look like return addresses into code outside the allocation functions (everything
+	from Memory::Deallocate to operator new, and ActorBase::operator new). This finds the right function
+	most of the time, but a stale return address or a pointer to static data can be picked up instead.
+	The two innermost callers are kept, since the first one is often a wrapper like
+	SharedFilePtr::LoadInternal. The report prints raw addresses, which SymbolMap (see SymbolMap.h)
+	resolves against symbols9.x on the host.
+
+	With SetTraceWriter, every event of the hooked heaps is also written to a HeapTraceWriter, for
+	analyzing and replaying on the host (see HeapTraceAnalyzer.h).
+
+	Install the tracer after any other heap hook (e.g. SegregatedFitIndex::Install, which refuses a
+	heap that already has a hook), so that those are called by the tracer and don't show up as callers.
+*/
+
+class AllocationTracer
+{
+public:
+	static constexpr u32 MAX_HEAPS = 4;
+	static constexpr u32 CAPACITY = 1024; // live allocations, a power of 2
+	static constexpr u32 NUM_CALLERS = 2;
+	static constexpr u32 MAX_STACK_SCAN = 48; // in words
+	static constexpr u32 MAX_REPORTED_CALLERS = 32;
+
+	struct Allocation
+	{
+		const void* ptr;
+		u32 callers[NUM_CALLERS]; // 0 if not found, bit 0 is set for Thumb code
+		u32 frame;
+		u32 size;
+	};
+
+	struct Stats
+	{
+		u32 numLive;
+		u32 maxLive;
+		u32 numUntracked; // allocations that didn't fit in the table
+		u32 numLeaked;    // in the last report
+		u32 bytesLeaked;
+	};
+
+private:
+	// Memory::Deallocate to operator new, which contains Memory::*, Heap::* and the ExpandingHeap vtable functions
+	static constexpr u32 FRONT_END_START = 0x0203c1b4;
+	static constexpr u32 FRONT_END_END   = 0x0203cc24;
+	// ExpandingHeapAllocator and SolidHeapAllocator
+	static constexpr u32 BACK_END_START  = 0x0204dcfc;
+	static constexpr u32 BACK_END_END    = 0x0204eda0;
+	static constexpr u32 ACTOR_NEW_START = 0x02043444;
+	static constexpr u32 ACTOR_NEW_END   = 0x02043494;
+	static constexpr u32 CODE_START      = 0x01ff8000; // ITCM
+
+	static inline AllocationTracer* installed = nullptr;
+
+	HeapHook heaps[MAX_HEAPS] = {};
+	HeapTraceWriter* traceWriter = nullptr;
+	Allocation table[CAPACITY] = {};
+	u32 sceneStartFrame = 0;
+	u32 prevSceneStartFrame = 0;
+
+	static u32 Home(const void* ptr)
+	{
+		return static_cast<u32>(reinterpret_cast<uintptr_t>(ptr) >> 2) * 0x9e3779b1u >> (32 - __builtin_ctz(CAPACITY));
+	}
+
+	Allocation* Find(const void* ptr)
+	{
+		for (u32 i = Home(ptr); table[i].ptr; i = (i + 1) & (CAPACITY - 1))
+			if (table[i].ptr == ptr) return &table[i];
+
+		return nullptr;
+	}
+
+	void Insert(const Allocation& allocation)
+	{
+		if (stats.numLive == CAPACITY - 1) // keep one empty slot to end the probes
+		{
+			stats.numUntracked++;
+			return;
+		}
+
+		u32 i = Home(allocation.ptr);
+		while (table[i].ptr) i = (i + 1) & (CAPACITY - 1);
+
+		table[i] = allocation;
+
+		if (++stats.numLive > stats.maxLive)
+			stats.maxLive = stats.numLive;
+	}
+
+	// linear probing with backward shift deletion, so no tombstones pile up
+	void Erase(Allocation* allocation)
+	{
+		u32 i = allocation - table;
+
+		for (u32 j = (i + 1) & (CAPACITY - 1); table[j].ptr; j = (j + 1) & (CAPACITY - 1))
+		{
+			const u32 home = Home(table[j].ptr);
+
+			// move j into the hole at i unless its home lies cyclically in (i, j]
+			if (i <= j ? (home <= i || home > j) : (home <= i && home > j))
+			{
+				table[i] = table[j];
+				i = j;
+			}
+		}
+
+		table[i].ptr = nullptr;
+		stats.numLive--;
+	}
+
+	static bool IsAllocatorCode(u32 address)
+	{
+		return (address >= FRONT_END_START && address < FRONT_END_END) ||
+			(address >= BACK_END_START && address < BACK_END_END) ||
+			(address >= ACTOR_NEW_START && address < ACTOR_NEW_END);
+	}
+
+	// Everything below the root heap is code or static data of the ARM9 binary and the overlays
+	static bool IsCode(u32 address)
+	{
+		const u32 codeEnd = static_cast<u32>(reinterpret_cast<uintptr_t>(Memory::rootHeapPtr));
+		return address >= CODE_START && address < codeEnd && (address & 3) != 2;
+	}
+
+	[[gnu::noinline]]
+	static void FindCallers(u32 (&callers)[NUM_CALLERS])
+	{
+		volatile u32 marker = 0;
+		const u32* stack = const_cast<const u32*>(&marker);
+		const u32 hook = static_cast<u32>(reinterpret_cast<uintptr_t>(__builtin_return_address(0))); // in VAllocate
+		u32 numFound = 0;
+
+		for (u32 i = 0; i < MAX_STACK_SCAN && numFound < NUM_CALLERS; i++)
+		{
+			const u32 word = stack[i];
+
+			if (word != hook && IsCode(word) && !IsAllocatorCode(word & ~1u))
+				callers[numFound++] = word;
+		}
+
+		while (numFound < NUM_CALLERS)
+			callers[numFound++] = 0;
+	}
+
+	HeapHook* FindHeap(const Heap* heap)
+	{
+		for (HeapHook& h : heaps)
+			if (h.heap == heap) return &h;
+
+		return nullptr;
+	}
+
+	template<class Ret, class... Args>
+	static Ret CallChained(HeapHook::Slot slot, ExpandingHeap* heap, Args... args)
+	{
+		return installed->FindHeap(heap)->template CallChained<Ret>(slot, args...);
+	}
+
+	u8 IndexOf(const Heap* heap) { return FindHeap(heap) - heaps; }
+
+	static void* VAllocate(ExpandingHeap* heap, u32 size, s32 align)
+	{
+		void* ptr = CallChained<void*>(HeapHook::VALLOCATE, heap, size, align);
+
+		if (installed->traceWriter)
+		{
+			installed->traceWriter->RecordAllocate(installed->IndexOf(heap), FRAME_COUNTER,
+				ptr, size, align, heap->allocator->nodeID);
+		}
+
+		if (ptr)
+		{
+			Allocation allocation = {ptr, {}, FRAME_COUNTER, size};
+			FindCallers(allocation.callers);
+			installed->Insert(allocation);
+		}
+
+		return ptr;
+	}
+
+	static bool VDeallocate(ExpandingHeap* heap, void* ptr)
+	{
+		const bool res = CallChained<bool>(HeapHook::VDEALLOCATE, heap, ptr);
+
+		if (res && installed->traceWriter)
+			installed->traceWriter->RecordDeallocate(installed->IndexOf(heap), FRAME_COUNTER, ptr);
+
+		if (res)
+			if (Allocation* allocation = installed->Find(ptr))
+				installed->Erase(allocation);
+
+		return res;
+	}
+
+	static u32 VReallocate(ExpandingHeap* heap, void* ptr, u32 newSize)
+	{
+		const u32 res = CallChained<u32>(HeapHook::VREALLOCATE, heap, ptr, newSize);
+
+		if (res && installed->traceWriter)
+			installed->traceWriter->RecordReallocate(installed->IndexOf(heap), FRAME_COUNTER, ptr, newSize);
+
+		if (res)
+			if (Allocation* allocation = installed->Find(ptr))
+				allocation->size = newSize;
+
+		return res;
+	}
+
+	static void VDeallocateAll(ExpandingHeap* heap)
+	{
+		CallChained<void>(HeapHook::VDEALLOCATE_ALL, heap);
+
+		if (installed->traceWriter)
+			installed->traceWriter->RecordDeallocateAll(installed->IndexOf(heap), FRAME_COUNTER);
+
+		installed->EraseAllOf(*heap->allocator);
+	}
+
+	void EraseAllOf(const ExpandingHeapAllocator& allocator)
+	{
+		for (u32 i = 0; i < CAPACITY; )
+		{
+			// Erase may shift another entry into slot i, so i only advances if nothing was erased
+			if (table[i].ptr >= allocator.heapStart && table[i].ptr < allocator.heapEnd)
+				Erase(&table[i]);
+			else
+				i++;
+		}
+	}
+
+	void RecordHeap(const HeapHook& hooked)
+	{
+		const ExpandingHeapAllocator& allocator = *hooked.heap->allocator;
+
+		traceWriter->RecordHeap(&hooked - heaps, FRAME_COUNTER, allocator.heapStart,
+			static_cast<u8*>(allocator.heapEnd) - static_cast<u8*>(allocator.heapStart));
+	}
+
+public:
+	Stats stats = {};
+
+	AllocationTracer() = default;
+	AllocationTracer(const AllocationTracer&) = delete;
+	AllocationTracer& operator=(const AllocationTracer&) = delete;
+
+	// Returns false if the heap is already hooked, MAX_HEAPS heaps are, or another tracer is installed
+	bool Install(ExpandingHeap& heap)
+	{
+		if ((installed && installed != this) || FindHeap(&heap)) return false;
+
+		HeapHook* hooked = FindHeap(nullptr);
+		if (!hooked) return false;
+
+		installed = this;
+		hooked->Install(heap,
+		{
+			{HeapHook::VALLOCATE,       reinterpret_cast<void*>(&VAllocate)},
+			{HeapHook::VDEALLOCATE,     reinterpret_cast<void*>(&VDeallocate)},
+			{HeapHook::VDEALLOCATE_ALL, reinterpret_cast<void*>(&VDeallocateAll)},
+			{HeapHook::VREALLOCATE,     reinterpret_cast<void*>(&VReallocate)},
+		});
+
+		if (traceWriter) RecordHeap(*hooked);
+
+		return true;
+	}
+
+	// Also records every hooked heap, heaps installed later are recorded by Install. nullptr stops recording.
+	void SetTraceWriter(HeapTraceWriter* writer)
+	{
+		traceWriter = writer;
+
+		if (!writer) return;
+
+		for (const HeapHook& h : heaps)
+			if (h.heap) RecordHeap(h);
+	}
+
+	// The allocations made on the heap while it was hooked are forgotten
+	void Uninstall(ExpandingHeap& heap)
+	{
+		HeapHook* hooked = FindHeap(&heap);
+		if (!hooked) return;
+
+		hooked->Uninstall();
+		EraseAllOf(*heap.allocator);
+
+		for (const HeapHook& h : heaps)
+			if (h.heap) return;
+
+		installed = nullptr;
+	}
+
+	// Calls f(allocation) for every live allocation made during the previous scene
+	template<class F>
+	void ForEachLeak(F&& f) const
+	{
+		for (const Allocation& allocation : table)
+		{
+			if (allocation.ptr && allocation.frame >= prevSceneStartFrame && allocation.frame < sceneStartFrame)
+				f(allocation);
+		}
+	}
+
+	// Call when a new scene is set to be spawned, reports the leaks of the scene before the current one
+	void OnSceneChange(const ostream& os)
+	{
+		struct CallerLeaks
+		{
+			u32 callers[NUM_CALLERS];
+			u32 numBlocks;
+			u32 bytes;
+		};
+
+		CallerLeaks leaks[MAX_REPORTED_CALLERS];
+		u32 numCallers = 0;
+
+		stats.numLeaked = 0;
+		stats.bytesLeaked = 0;
+
+		ForEachLeak([&](const Allocation& allocation)
+		{
+			stats.numLeaked++;
+			stats.bytesLeaked += allocation.size;
+
+			u32 i = 0;
+			while (i < numCallers && leaks[i].callers[0] != allocation.callers[0]) i++;
+
+			if (i == numCallers)
+			{
+				if (numCallers == MAX_REPORTED_CALLERS) return;
+
+				leaks[numCallers++] = {{allocation.callers[0], allocation.callers[1]}, 0, 0};
+			}
+
+			leaks[i].numBlocks++;
+			leaks[i].bytes += allocation.size;
+		});
+
+		// only now, the leaks are those of the scene that ended when the current one started
+		prevSceneStartFrame = sceneStartFrame;
+		sceneStartFrame = FRAME_COUNTER;
+
+		if (stats.numLeaked == 0) return;
+
+		os << "leaks: " << stats.numLeaked << " blocks, " << stats.bytesLeaked << " bytes\n";
+
+		for (u32 i = 0; i < numCallers; i++)
+		{
+			os << "  " << leaks[i].callers[0] << " (from " << leaks[i].callers[1] << "): "
+			   << leaks[i].numBlocks << " blocks, " << leaks[i].bytes << " bytes\n";
+		}
+	}
+};
@@ -0,0 +1,261 @@
+#pragma once
+
+#include <span>
+
+/*
+	INFORMATION
+	When SharedFilePtr::Release drops numRefs to zero, the file is freed right away, even if the same
+	file (coins, stars, doors, ...) is loaded again a few frames later, which means another card read
+	and decompression. FILE_CACHE keeps tracked files loaded after their last user released them
+	("zombies") while the heap has room for them:
+
+		static SharedFilePtr* const models[] = {&COIN_YELLOW_POLY32_MODEL_PTR, &POWER_STAR_MODEL_PTR, ...};
+		FILE_CACHE.Track(models, SharedFilePtr::Kind::BMD);
+		FILE_CACHE.Install(*Memory::rootHeapPtr);  // evicts zombies when an allocation would fail
+
+		// once per frame
+		FILE_CACHE.Update(FRAME_COUNTER);
+
+		// in a hook of Scene::SetSceneToSpawn, if it returns true
+		FILE_CACHE.OnSceneChange();
+
+	The cache holds a reference to every tracked file that is loaded, taken the first Update after the
+	file was loaded, so the file stays loaded when its users release it and the next Load (or LoadBMD,
+	...) only increments numRefs. A file whose only reference is the cache's is a zombie. Zombies are
+	released in least recently used order when they take more than maxZombieBytes, when the heap has
+	less than minFreeBytes left, and when an allocation on the installed heap fails.
+
+	Files are only noticed once per frame, so a file that is loaded and released within one frame
+	isn't cached and isn't counted.
+
+	Models must be tracked as SharedFilePtr::Kind::BMD and OnSceneChange must be called from a hook of
+	Scene::SetSceneToSpawn when it returns true. A new scene resets the texture VRAM and the model data,
+	but LoadBMD only sets a BMD_File up for the first reference, so a model zombie kept across the change
+	would be used with textures that aren't uploaded anymore. OnSceneChange evicts those zombies, other
+	zombies stay.
+
+	Install it after a SegregatedFitIndex on the same heap (which refuses heaps that already have a
+	hook), so that the allocations the index fails reach the cache's evict and retry.
+
+	It's included by SM64DS_PI.h, since it needs SharedFilePtr.
+*/
+
+class FileCache
+{
+public:
+	static constexpr u32 CAPACITY = 64;
+
+	struct Stats
+	{
+		u32 numHits;       // zombies that were loaded again
+		u32 numMisses;     // tracked files that were read from the card
+		u32 numEvictions;
+		u32 numFailedAllocationsRescued;
+	};
+
+private:
+	struct Entry
+	{
+		SharedFilePtr* file;
+		SharedFilePtr::Kind kind;
+		u32 lastUsed;  // frame
+		bool holdsRef; // the cache holds a reference
+		bool inUse;    // someone besides the cache held a reference at the last Update
+	};
+
+	Entry entries[CAPACITY] = {};
+	u32 numEntries = 0;
+
+	static inline FileCache* installed = nullptr;
+
+	HeapHook hook;
+
+	static u32 SizeOf(const SharedFilePtr& file)
+	{
+		return (reinterpret_cast<const MemoryNode*>(file.filePtr) - 1)->size;
+	}
+
+	static bool IsZombie(const Entry& entry)
+	{
+		return entry.holdsRef && entry.file->numRefs == 1;
+	}
+
+	Entry* LeastRecentlyUsedZombie()
+	{
+		Entry* res = nullptr;
+
+		for (u32 i = 0; i < numEntries; i++)
+			if (IsZombie(entries[i]) && (!res || entries[i].lastUsed < res->lastUsed))
+				res = &entries[i];
+
+		return res;
+	}
+
+	u32 ZombieBytes() const
+	{
+		u32 res = 0;
+
+		for (u32 i = 0; i < numEntries; i++)
+			if (IsZombie(entries[i])) res += SizeOf(*entries[i].file);
+
+		return res;
+	}
+
+	void Evict(Entry& entry)
+	{
+		entry.file->Release();
+		entry.holdsRef = false;
+		entry.inUse = false;
+		stats.numEvictions++;
+	}
+
+	static void* VAllocate(ExpandingHeap*, u32 size, s32 align)
+	{
+		void* ptr = installed->hook.CallChained<void*>(HeapHook::VALLOCATE, size, align);
+
+		if (ptr) return ptr;
+
+		while (!ptr && installed->EvictOne())
+			ptr = installed->hook.CallChained<void*>(HeapHook::VALLOCATE, size, align);
+
+		if (ptr) installed->stats.numFailedAllocationsRescued++;
+
+		return ptr;
+	}
+
+public:
+	Stats stats = {};
+	u32 maxZombieBytes = 0x40000;
+	u32 minFreeBytes = 0x20000; // of the installed heap, or the root heap if none is installed
+
+	// Returns false if there is no room left
+	bool Track(SharedFilePtr& file, SharedFilePtr::Kind kind = SharedFilePtr::Kind::RAW)
+	{
+		for (u32 i = 0; i < numEntries; i++)
+			if (entries[i].file == &file) return true;
+
+		if (numEntries == CAPACITY) return false;
+
+		entries[numEntries++] = {&file, kind, 0, false, false};
+		return true;
+	}
+
+	bool Track(std::span<SharedFilePtr* const> files, SharedFilePtr::Kind kind = SharedFilePtr::Kind::RAW)
+	{
+		for (SharedFilePtr* file : files)
+			if (!Track(*file, kind)) return false;
+
+		return true;
+	}
+
+	// Releases the cache's reference, if it holds one
+	void Untrack(SharedFilePtr& file)
+	{
+		for (u32 i = 0; i < numEntries; i++)
+		{
+			if (entries[i].file != &file) continue;
+
+			if (entries[i].holdsRef) file.Release();
+
+			entries[i] = entries[--numEntries];
+			return;
+		}
+	}
+
+	// Releases the least recently used zombie, returns false if there is none
+	bool EvictOne()
+	{
+		Entry* entry = LeastRecentlyUsedZombie();
+		if (!entry) return false;
+
+		Evict(*entry);
+		return true;
+	}
+
+	// Releases all zombies, e.g. before a level that needs all the memory it can get
+	void EvictAll()
+	{
+		while (EvictOne());
+	}
+
+	// Releases the model zombies, whose textures and model data don't survive the scene change
+	void OnSceneChange()
+	{
+		for (u32 i = 0; i < numEntries; i++)
+			if (entries[i].kind == SharedFilePtr::Kind::BMD && IsZombie(entries[i]))
+				Evict(entries[i]);
+	}
+
+	void Update(u32 frame)
+	{
+		for (u32 i = 0; i < numEntries; i++)
+		{
+			Entry& entry = entries[i];
+			SharedFilePtr& file = *entry.file;
+
+			if (!entry.holdsRef)
+			{
+				if (file.IsReady())
+				{
+					file.Load(); // only increments numRefs since the file is loaded
+					entry.holdsRef = true;
+					entry.inUse = true;
+					entry.lastUsed = frame;
+					stats.numMisses++;
+				}
+
+				continue;
+			}
+
+			const bool inUse = file.numRefs > 1;
+
+			if (inUse)
+			{
+				if (!entry.inUse) stats.numHits++;
+				entry.lastUsed = frame;
+			}
+
+			entry.inUse = inUse;
+		}
+
+		ExpandingHeap* target = hook.heap ? hook.heap : Memory::rootHeapPtr;
+
+		while (ZombieBytes() > maxZombieBytes || target->allocator->MemoryLeft() < minFreeBytes)
+			if (!EvictOne()) break;
+	}
+
+	// Returns false if another heap or another FileCache is installed
+	bool Install(ExpandingHeap& target)
+	{
+		if (hook.IsInstalled()) return hook.heap == &target;
+		if (installed) return false;
+
+		installed = this;
+		hook.Install(target, {{HeapHook::VALLOCATE, reinterpret_cast<void*>(&VAllocate)}});
+		return true;
+	}
+
+	// Only valid if no other hook has been installed on the heap since
+	void Uninstall()
+	{
+		if (!hook.IsInstalled()) return;
+
+		hook.Uninstall();
+		installed = nullptr;
+	}
+
+	// The hit rate in 1/1000
+	[[nodiscard]] u32 HitRate() const
+	{
+		const u32 total = stats.numHits + stats.numMisses;
+		return total == 0 ? 0 : stats.numHits * 1000 / total;
+	}
+
+	void Dump(const ostream& os) const
+	{
+		os << "file cache: " << stats.numHits << " hits, " << stats.numMisses << " misses, "
+		   << stats.numEvictions << " evictions, " << ZombieBytes() << " zombie bytes\n";
+	}
+};
+
+inline constinit FileCache FILE_CACHE;
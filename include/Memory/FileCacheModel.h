@@ -0,0 +1,192 @@
+#pragma once
+
+#include "HeapModel.h"
+#include <unordered_map>
+
+/*
+	INFORMATION
+	Host-side model of FileCache (it isn't included by SM64DS_PI.h), for replaying recorded sequences
+	of SharedFilePtr loads and releases with different cache settings. Files are allocated on a
+	HeapModel, so the model also shows how the zombies affect the heap:
+
+		HeapModel heap(0x180000);
+		FileCacheModel cache(heap, {.maxZombieBytes = 0x40000, .minFreeBytes = 0x20000});
+		cache.Run(events);
+		cache.Stats(); // hits, misses and the bytes that were read from the card
+
+	Like the game, a load of a file with references only increments numRefs, and the cache takes its
+	reference at the end of the frame the file was loaded in. Zombies are evicted at the end of each
+	frame and when an allocation fails. Events of files that aren't tracked run without the cache,
+	which still matters since they allocate on the same heap.
+*/
+
+struct FileEvent
+{
+	enum Type : u8
+	{
+		LOAD,
+		RELEASE,
+	};
+
+	Type type;
+	bool tracked; // whether the file is tracked by the cache
+	u16 fileID;
+	u32 frame;
+	u32 size;     // for LOAD, the size of the file once loaded
+};
+
+class FileCacheModel
+{
+public:
+	struct Settings
+	{
+		u32 maxZombieBytes = 0x40000;
+		u32 minFreeBytes = 0x20000;
+	};
+
+	struct CacheStats
+	{
+		u32 numHits = 0;
+		u32 numMisses = 0;          // loads of tracked files that read the card
+		u32 numUncachedLoads = 0;   // loads of untracked files that read the card
+		u32 numEvictions = 0;
+		u32 numFailedLoads = 0;     // the heap was full even without zombies
+		u64 bytesRead = 0;          // from the card, tracked or not
+		u64 bytesSaved = 0;         // by hits
+	};
+
+private:
+	struct File
+	{
+		u32 address = 0; // 0 if not loaded
+		u32 size = 0;
+		u32 lastUsed = 0;
+		u8 numRefs = 0;
+		bool tracked = false;
+		bool holdsRef = false;
+	};
+
+	HeapModel& heap;
+	Settings settings;
+	std::unordered_map<u16, File> files;
+	CacheStats stats;
+
+	static bool IsZombie(const File& file) { return file.holdsRef && file.numRefs == 1; }
+
+	void Unload(File& file)
+	{
+		heap.Deallocate(file.address);
+		file.address = 0;
+		file.numRefs = 0;
+		file.holdsRef = false;
+	}
+
+	bool EvictOne()
+	{
+		File* lru = nullptr;
+
+		for (auto& [id, file] : files)
+			if (IsZombie(file) && (!lru || file.lastUsed < lru->lastUsed))
+				lru = &file;
+
+		if (!lru) return false;
+
+		Unload(*lru);
+		stats.numEvictions++;
+		return true;
+	}
+
+	u32 ZombieBytes() const
+	{
+		u32 res = 0;
+
+		for (const auto& [id, file] : files)
+			if (IsZombie(file)) res += file.size;
+
+		return res;
+	}
+
+	void Load(File& file, const FileEvent& e)
+	{
+		file.tracked = e.tracked;
+		file.lastUsed = e.frame;
+
+		if (file.address)
+		{
+			if (IsZombie(file)) stats.numHits++, stats.bytesSaved += file.size;
+
+			file.numRefs++;
+			return;
+		}
+
+		u32 address = heap.Allocate(e.size, 4);
+
+		while (!address && EvictOne())
+			address = heap.Allocate(e.size, 4);
+
+		if (!address)
+		{
+			stats.numFailedLoads++;
+			return;
+		}
+
+		file.address = address;
+		file.size = e.size;
+		file.numRefs = 1;
+		stats.bytesRead += e.size;
+
+		if (e.tracked)
+			stats.numMisses++;
+		else
+			stats.numUncachedLoads++;
+	}
+
+	void Release(File& file)
+	{
+		if (file.numRefs == 0) return;
+
+		if (--file.numRefs == 0)
+			Unload(file);
+	}
+
+	void EndFrame(u32 frame)
+	{
+		for (auto& [id, file] : files)
+		{
+			if (file.tracked && file.address && !file.holdsRef)
+			{
+				file.numRefs++;
+				file.holdsRef = true;
+			}
+
+			if (file.numRefs > 1) file.lastUsed = frame;
+		}
+
+		while (ZombieBytes() > settings.maxZombieBytes || heap.MemoryLeft() < settings.minFreeBytes)
+			if (!EvictOne()) break;
+	}
+
+public:
+	FileCacheModel(HeapModel& heap, Settings settings) : heap(heap), settings(settings) {}
+
+	// The events must be sorted by frame
+	void Run(std::span<const FileEvent> events)
+	{
+		for (std::size_t i = 0; i < events.size(); i++)
+		{
+			const FileEvent& e = events[i];
+			File& file = files[e.fileID];
+
+			if (e.type == FileEvent::LOAD)
+				Load(file, e);
+			else
+				Release(file);
+
+			if (i + 1 == events.size() || events[i + 1].frame != e.frame)
+				EndFrame(e.frame);
+		}
+	}
+
+	[[nodiscard]] const CacheStats& Stats() const { return stats; }
+	[[nodiscard]] u32 NumZombieBytes() const { return ZombieBytes(); }
+};
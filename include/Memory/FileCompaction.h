@@ -0,0 +1,350 @@
+#pragma once
+
+#include <span>
+
+/*
+	INFORMATION
+	Loaded files are raw pointers into the heap they were loaded on (usually the root heap), so after
+	a few level transitions the heap is full of holes left by unloaded files and by
+	BMD_File::ShrinkAllocation, which block large loads even if MemoryLeft() would suffice.
+	FileCompaction slides files down into those holes and patches the pointers to them:
+
+		static SharedFilePtr* const movable[] = {&MY_MODEL_PTR, &MY_ANIM_PTR, ...};
+
+		FileCompaction compaction;
+		compaction.Register(MY_MODEL_PTR, FileCompaction::BMD);  // or Register(movable), as plain data
+		compaction.Compact(*Memory::rootHeapPtr);                 // e.g. during a fade
+
+	Only registered files are moved, and only pointers that are known to FileCompaction are patched:
+	SharedFilePtr::filePtr, the pointers inside a BMD_File (which InitPointers made absolute), and the
+	commonModelDataArr entry of a BMD_File along with its ModelComponents::modelFile. So a file must
+	not be registered (or must be pinned) while anything else holds a pointer into it, which is the
+	case for every file that a ModelBase, Animation, TextureSequence or MeshCollider has been set up
+	with. In practice, compact during a level load before the actors are spawned, or register the
+	files that are only referenced through their SharedFilePtr.
+
+	A file is moved by allocating a block of the same size from the start of the heap. If that isn't
+	below the file, the file is copied to a temporary block at the end of the heap and freed, so that
+	it can slide into the hole directly before it. That only works on a heap that takes the first
+	block that fits: best fit and SegregatedFitIndex may take a hole above the file instead, so there
+	the file is left where it is. Files are visited in ascending address order so that each move makes
+	room for the next one. HeapModel::Compact does the same on the host.
+
+	It's included by SM64DS_PI.h, after SharedFilePtr, the formats and the models it patches.
+*/
+
+class FileCompaction
+{
+public:
+	enum Flags : u8
+	{
+		PINNED = 1 << 0, // never moved
+		BMD    = 1 << 1, // the file is a BMD_File whose pointers have been initialized
+	};
+
+	struct Stats
+	{
+		u16 numMoved;
+		u16 numSkipped; // registered files that were loaded but couldn't be moved down
+		u32 bytesMoved;
+		u16 fragmentationBefore; // in 1/1000, see HeapTelemetry::Usage
+		u16 fragmentationAfter;
+		u32 largestFreeBefore;
+		u32 largestFreeAfter;
+	};
+
+	static constexpr u32 MAX_FILES = 64;
+
+private:
+	struct Entry
+	{
+		SharedFilePtr* file;
+		u8 flags;
+	};
+
+	Entry entries[MAX_FILES];
+	u32 numEntries = 0;
+
+	[[gnu::always_inline]]
+	static MemoryNode& NodeOf(const void* data)
+	{
+		return *(reinterpret_cast<MemoryNode*>(const_cast<void*>(data)) - 1);
+	}
+
+	template<class T>
+	static void Rebase(T*& ptr, const char* oldStart, const char* oldEnd, char* newStart)
+	{
+		const char* p = reinterpret_cast<const char*>(ptr);
+
+		if (p >= oldStart && p < oldEnd)
+			ptr = reinterpret_cast<T*>(newStart + (p - oldStart));
+	}
+
+	// Material::textureID and paletteID hold a pointer if they are at least 0x02000000
+	static void RebaseID(s32& id, const char* oldStart, const char* oldEnd, char* newStart)
+	{
+		const uintptr_t start = reinterpret_cast<uintptr_t>(oldStart);
+		const uintptr_t address = static_cast<u32>(id);
+
+		if (address >= start && address < reinterpret_cast<uintptr_t>(oldEnd))
+			id = static_cast<s32>(reinterpret_cast<uintptr_t>(newStart) + (address - start));
+	}
+
+	// bmd is the copy at newStart. The old block is freed by now and may have been overwritten
+	// (or overlap the copy), so its tables are rebased first and only the copy's are walked.
+	// Textures and palettes that were loaded to VRAM and cut off by ShrinkAllocation keep
+	// their dangling data pointers, since these are outside the old block and left alone.
+	static void RebaseBMD(BMD_File& bmd, const char* oldStart, const char* oldEnd, char* newStart)
+	{
+		Rebase(bmd.bones, oldStart, oldEnd, newStart);
+		Rebase(bmd.displayLists, oldStart, oldEnd, newStart);
+		Rebase(bmd.textures, oldStart, oldEnd, newStart);
+		Rebase(bmd.palettes, oldStart, oldEnd, newStart);
+		Rebase(bmd.materials, oldStart, oldEnd, newStart);
+		Rebase(bmd.transformMap, oldStart, oldEnd, newStart);
+		Rebase(bmd.unknown, oldStart, oldEnd, newStart);
+
+		for (u32 i = 0; i < bmd.numBones; i++)
+		{
+			Rebase(bmd.bones[i].name, oldStart, oldEnd, newStart);
+			Rebase(bmd.bones[i].materialIDList, oldStart, oldEnd, newStart);
+			Rebase(bmd.bones[i].diplayListIDList, oldStart, oldEnd, newStart);
+		}
+
+		for (u32 i = 0; i < bmd.numDisplayLists; i++)
+		{
+			BMD_File::DisplayListHeader& header = bmd.displayLists[i];
+			Rebase(header.list, oldStart, oldEnd, newStart);
+
+			for (u32 j = 0; j < header.numLists; j++)
+			{
+				Rebase(header.list[j].transforms, oldStart, oldEnd, newStart);
+				Rebase(header.list[j].data, oldStart, oldEnd, newStart);
+			}
+		}
+
+		for (u32 i = 0; i < bmd.numTextures; i++)
+		{
+			Rebase(bmd.textures[i].name, oldStart, oldEnd, newStart);
+			Rebase(bmd.textures[i].data, oldStart, oldEnd, newStart);
+		}
+
+		for (u32 i = 0; i < bmd.numPalettes; i++)
+		{
+			Rebase(bmd.palettes[i].name, oldStart, oldEnd, newStart);
+			Rebase(bmd.palettes[i].data, oldStart, oldEnd, newStart);
+		}
+
+		for (u32 i = 0; i < bmd.numMaterials; i++)
+		{
+			BMD_File::Material& material = bmd.materials[i];
+			Rebase(material.name, oldStart, oldEnd, newStart);
+			RebaseID(material.textureID, oldStart, oldEnd, newStart);
+			RebaseID(material.paletteID, oldStart, oldEnd, newStart);
+		}
+
+		if (bmd.hasUnknown && bmd.unknown)
+		{
+			Rebase(bmd.unknown->unk00, oldStart, oldEnd, newStart);
+			Rebase(bmd.unknown->unk04, oldStart, oldEnd, newStart);
+			Rebase(bmd.unknown->unk08, oldStart, oldEnd, newStart);
+			Rebase(bmd.unknown->unk0c, oldStart, oldEnd, newStart);
+		}
+
+	}
+
+	static void PatchCommonModelData(const BMD_File* oldFile, BMD_File* newFile)
+	{
+		for (u32 i = 0; i < numCommonModelData; i++)
+		{
+			CommonModelData& data = commonModelDataArr[i];
+
+			if (data.file != oldFile) continue;
+
+			data.file = newFile;
+
+			if (data.modelComponents && data.modelComponents->modelFile == oldFile)
+				data.modelComponents->modelFile = newFile;
+		}
+	}
+
+	// Returns whether the file was moved
+	static bool Move(Entry& entry, ExpandingHeap& heap, u32& bytesMoved)
+	{
+		char* oldStart = entry.file->filePtr;
+		MemoryNode& oldNode = NodeOf(oldStart);
+		const u32 size = oldNode.size;
+
+		// the new block keeps the node ID of the old one, so DeallocateAll still frees it
+		ExpandingHeapAllocator& allocator = *heap.allocator;
+		const u32 prevNodeID = allocator.SetNodeID(oldNode.flags & MemoryNode::NODE_ID);
+		char* newStart = static_cast<char*>(heap.Allocate(size, 4));
+
+		if (newStart > oldStart)
+		{
+			heap.Deallocate(newStart);
+			newStart = nullptr;
+		}
+
+		if (newStart)
+		{
+			CpuCopy32(oldStart, newStart, size);
+			heap.Deallocate(oldStart);
+		}
+		else
+		{
+			// No hole before the file is big enough for it, but the one directly before it may be,
+			// once the file's own block is freed. First fit takes that hole (or the file's own place)
+			// since no hole before it fits, other policies may take one further up.
+			if (allocator.allocationMode != 0 || SegregatedFitIndex::IsInstalledOn(heap))
+			{
+				allocator.SetNodeID(prevNodeID);
+				return false;
+			}
+
+			// Allocating zeroes memory, so the file is parked in a temporary block at the end of the heap meanwhile.
+			char* temp = static_cast<char*>(heap.Allocate(size, -4));
+
+			if (!temp || temp < oldStart)
+			{
+				if (temp) heap.Deallocate(temp);
+
+				allocator.SetNodeID(prevNodeID);
+				return false;
+			}
+
+			CpuCopy32(oldStart, temp, size);
+			heap.Deallocate(oldStart);
+			newStart = static_cast<char*>(heap.Allocate(size, 4)); // can't fail, the old block is free
+			CpuCopy32(temp, newStart, size);
+			heap.Deallocate(temp);
+		}
+
+		allocator.SetNodeID(prevNodeID);
+
+		if (newStart == oldStart) return false;
+
+		if (entry.flags & BMD)
+		{
+			RebaseBMD(*reinterpret_cast<BMD_File*>(newStart), oldStart, oldStart + size, newStart);
+			PatchCommonModelData(reinterpret_cast<BMD_File*>(oldStart), reinterpret_cast<BMD_File*>(newStart));
+		}
+
+		entry.file->filePtr = newStart;
+
+		bytesMoved += size;
+		return true;
+	}
+
+public:
+	Stats stats = {};
+
+	// Returns false if there is no room left in the registry
+	bool Register(SharedFilePtr& file, u8 flags = 0)
+	{
+		for (u32 i = 0; i < numEntries; i++)
+		{
+			if (entries[i].file == &file)
+			{
+				entries[i].flags = flags;
+				return true;
+			}
+		}
+
+		if (numEntries == MAX_FILES) return false;
+
+		entries[numEntries++] = {&file, flags};
+		return true;
+	}
+
+	bool Register(std::span<SharedFilePtr* const> files, u8 flags = 0)
+	{
+		for (SharedFilePtr* file : files)
+			if (!Register(*file, flags)) return false;
+
+		return true;
+	}
+
+	void Unregister(SharedFilePtr& file)
+	{
+		for (u32 i = 0; i < numEntries; i++)
+		{
+			if (entries[i].file == &file)
+			{
+				entries[i] = entries[--numEntries];
+				return;
+			}
+		}
+	}
+
+	void SetPinned(SharedFilePtr& file, bool pinned)
+	{
+		for (u32 i = 0; i < numEntries; i++)
+		{
+			if (entries[i].file == &file)
+			{
+				if (pinned)
+					entries[i].flags |= PINNED;
+				else
+					entries[i].flags &= ~PINNED;
+			}
+		}
+	}
+
+	void Clear() { numEntries = 0; }
+
+	[[nodiscard]] u32 NumRegistered() const { return numEntries; }
+
+	// Moves every registered, loaded and unpinned file on heap as far down as possible.
+	// Returns the number of files that were moved.
+	u32 Compact(ExpandingHeap& heap)
+	{
+		ExpandingHeapAllocator& allocator = *heap.allocator;
+
+		const HeapTelemetry::Usage before = HeapTelemetry::Measure(allocator);
+		stats = {};
+		stats.fragmentationBefore = before.fragmentation;
+		stats.largestFreeBefore = before.largestFree;
+
+		// sort by address (insertion sort, the registry is small and usually almost sorted)
+		for (u32 i = 1; i < numEntries; i++)
+		{
+			const Entry entry = entries[i];
+			u32 j = i;
+
+			for (; j > 0 && entries[j - 1].file->filePtr > entry.file->filePtr; j--)
+				entries[j] = entries[j - 1];
+
+			entries[j] = entry;
+		}
+
+		for (u32 i = 0; i < numEntries; i++)
+		{
+			Entry& entry = entries[i];
+			const char* ptr = entry.file->filePtr;
+
+			if (!ptr || (entry.flags & PINNED) || entry.file->numRefs == 0 ||
+				ptr < allocator.heapStart || ptr >= allocator.heapEnd)
+				continue;
+
+			if (Move(entry, heap, stats.bytesMoved))
+				stats.numMoved++;
+			else
+				stats.numSkipped++;
+		}
+
+		const HeapTelemetry::Usage after = HeapTelemetry::Measure(allocator);
+		stats.fragmentationAfter = after.fragmentation;
+		stats.largestFreeAfter = after.largestFree;
+
+		return stats.numMoved;
+	}
+
+	void Dump(const ostream& os) const
+	{
+		os << "compaction: moved " << stats.numMoved << " files (" << stats.bytesMoved << " bytes), skipped "
+		   << stats.numSkipped << ", fragmentation " << static_cast<u32>(stats.fragmentationBefore) << " -> "
+		   << static_cast<u32>(stats.fragmentationAfter) << "/1000, largest free "
+		   << stats.largestFreeBefore << " -> " << stats.largestFreeAfter << '\n';
+	}
+};
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <initializer_list>
+
+/*
+	INFORMATION
+	The heap hooks (SegregatedFitIndex, AllocationTracer, FileCache) replace virtual functions of an
+	ExpandingHeap by pointing the heap to a copy of its vtable with some of the slots replaced.
+	HeapHook is that copy, along with the vtable the heap had before, through which the replaced
+	functions call the ones they replace. That vtable may be another hook's, so hooks chain: the one
+	installed last is called first.
+
+	Hooks can only be uninstalled in the reverse order, since a later hook calls the vtable of an
+	earlier one. Installed hooks are kept in a list, so that a hook that must be the first one on its
+	heap (SegregatedFitIndex) can check IsHooked.
+*/
+
+struct HeapHook
+{
+	// vtable slots, see the order of the virtual functions in Heap
+	enum Slot : u32
+	{
+		VALLOCATE       = 3,
+		VDEALLOCATE     = 4,
+		VDEALLOCATE_ALL = 5,
+		VREALLOCATE     = 8,
+	};
+
+	struct Replacement
+	{
+		Slot slot;
+		void* function;
+	};
+
+	static constexpr u32 VTABLE_SIZE   = 16;
+	static constexpr u32 VTABLE_PREFIX = 2; // offset to top and type info
+
+	ExpandingHeap* heap = nullptr;
+	void* const* chainedVTable = nullptr; // the vtable the heap had before Install
+	void* vtable[VTABLE_PREFIX + VTABLE_SIZE] = {};
+	HeapHook* nextInstalled = nullptr;
+
+	static inline HeapHook* firstInstalled = nullptr;
+
+	static void*const*& VTablePtr(Heap& heap) { return *reinterpret_cast<void*const**>(&heap); }
+
+	[[nodiscard]] bool IsInstalled() const { return heap != nullptr; }
+
+	// Whether any hook is installed on the heap
+	[[nodiscard]] static bool IsHooked(const ExpandingHeap& heap)
+	{
+		for (const HeapHook* hook = firstInstalled; hook; hook = hook->nextInstalled)
+			if (hook->heap == &heap) return true;
+
+		return false;
+	}
+
+	void Install(ExpandingHeap& target, std::initializer_list<Replacement> replacements)
+	{
+		heap = &target;
+		chainedVTable = VTablePtr(target);
+
+		for (u32 i = 0; i < VTABLE_PREFIX + VTABLE_SIZE; i++)
+			vtable[i] = const_cast<void*>(chainedVTable[static_cast<s32>(i) - VTABLE_PREFIX]);
+
+		for (const Replacement& replacement : replacements)
+			vtable[VTABLE_PREFIX + replacement.slot] = replacement.function;
+
+		VTablePtr(target) = &vtable[VTABLE_PREFIX];
+
+		nextInstalled = firstInstalled;
+		firstInstalled = this;
+	}
+
+	void Uninstall()
+	{
+		if (!heap) return;
+
+		VTablePtr(*heap) = chainedVTable;
+		heap = nullptr;
+		chainedVTable = nullptr;
+
+		for (HeapHook** link = &firstInstalled; *link; link = &(*link)->nextInstalled)
+		{
+			if (*link == this)
+			{
+				*link = nextInstalled;
+				break;
+			}
+		}
+
+		nextInstalled = nullptr;
+	}
+
+	// Calls the function the hook replaced
+	template<class Ret, class... Args>
+	Ret CallChained(Slot slot, Args... args) const
+	{
+		return reinterpret_cast<Ret(*)(ExpandingHeap*, Args...)>(chainedVTable[slot])(heap, args...);
+	}
+};
@@ -0,0 +1,534 @@
+#pragma once
+
+#include "../Math/MathCommon.h"
+#include <algorithm>
+#include <bit>
+#include <span>
+#include <vector>
+
+/*
+	INFORMATION
+	HeapModel is a reimplementation of ExpandingHeapAllocator for host-side tools (it isn't included
+	by SM64DS_PI.h and doesn't touch any game memory). It only tracks addresses, which start at 0
+	for the first byte after the allocator, so that allocation traces recorded in game can be
+	replayed against different heap sizes and allocation modes.
+
+	What it reproduces:
+	- every block starts with a MemoryNode (0x10 bytes) and sizes are rounded up to 4
+	- align > 0 searches the free list forwards and places the block at the start of the free block,
+	  align < 0 searches backwards and places it at the end, |align| is the alignment of the data
+	- allocationMode 0 takes the first free block that fits, 1 takes the smallest one
+	- SEGREGATED_FIT isn't a mode of the game, it takes the block SegregatedFitIndex would take (in a
+	  size class, the model tries the blocks in address order, the index the most recently freed first),
+	  or the first block that fits if the index has none, like the game's allocator behind the index
+	- the alignment padding before a block stays part of it (RELATIVE_ALLOCATION_OFFSET) and so does
+	  a remainder after it, if either is too small to hold a free MemoryNode and 4 bytes of data
+	- freed blocks are merged with the free blocks directly before and after them
+	- reallocating shrinks a block in place or grows it into the free block directly after it
+*/
+
+class HeapModel
+{
+public:
+	static constexpr u32 NODE_SIZE = 0x10;
+	static constexpr u32 MIN_FREE_DATA_SIZE = 4;
+
+	enum AllocationMode : u16
+	{
+		FIRST_FIT      = 0,
+		BEST_FIT       = 1,
+		SEGREGATED_FIT = 2,
+	};
+
+	struct Block
+	{
+		u32 start; // address of the MemoryNode, including the padding before it if allocated
+		u32 end;   // address after the last byte of data
+	};
+
+	struct AllocatedBlock : Block
+	{
+		u32 data;    // the address returned by Allocate
+		u16 nodeID;
+	};
+
+private:
+	u32 heapSize;
+	std::vector<Block> freeBlocks;          // sorted by address, like the game's free list
+	std::vector<AllocatedBlock> allocBlocks; // sorted by address
+
+	static constexpr u32 AlignUp  (u32 x, u32 align) { return (x + align - 1) & ~(align - 1); }
+	static constexpr u32 AlignDown(u32 x, u32 align) { return x & ~(align - 1); }
+
+	// Where the data of a block of the given size would be placed inside free, or 0 if it doesn't fit
+	static u32 PlaceForwards(const Block& free, u32 size, u32 align)
+	{
+		const u32 data = AlignUp(free.start + NODE_SIZE, align);
+		return data + size <= free.end ? data : 0;
+	}
+
+	static u32 PlaceBackwards(const Block& free, u32 size, u32 align)
+	{
+		if (free.end - free.start < NODE_SIZE + size) return 0;
+
+		const u32 data = AlignDown(free.end - size, align);
+		return data >= free.start + NODE_SIZE ? data : 0;
+	}
+
+	static bool CanHoldFreeNode(u32 start, u32 end) { return end - start >= NODE_SIZE + MIN_FREE_DATA_SIZE; }
+
+	// The size class of SegregatedFitIndex: the power of 2 of the data size, split into 4 ranges
+	static u32 SizeClass(u32 size)
+	{
+		const u32 fl = 31 - std::countl_zero(size | 1);
+		return fl * 4 + (fl >= 2 ? size >> (fl - 2) & 3 : 0);
+	}
+
+	// Like SegregatedFitIndex::Allocate: a block in the size class of size + padding that fits, or else
+	// a block of the smallest size class above it, which always fits. Returns the index of the block.
+	std::size_t FindSegregated(u32 size, u32 align, bool backwards, u32& data)
+	{
+		const u32 sizeClass = SizeClass(size + (align > 4 ? align - 4 : 0));
+		std::size_t next = freeBlocks.size();
+		u32 nextClass = ~0u;
+
+		for (std::size_t i = 0; i < freeBlocks.size(); i++)
+		{
+			const Block& free = freeBlocks[i];
+			const u32 freeClass = SizeClass(free.end - free.start - NODE_SIZE);
+
+			if (freeClass == sizeClass)
+			{
+				numBlocksVisited++;
+				data = backwards ? PlaceBackwards(free, size, align) : PlaceForwards(free, size, align);
+
+				if (data != 0) return i;
+			}
+			else if (freeClass > sizeClass && freeClass < nextClass)
+			{
+				next = i;
+				nextClass = freeClass;
+			}
+		}
+
+		if (next == freeBlocks.size()) return next;
+
+		numBlocksVisited++; // found with the bitmaps
+		data = backwards ? PlaceBackwards(freeBlocks[next], size, align) : PlaceForwards(freeBlocks[next], size, align);
+
+		return data != 0 ? next : freeBlocks.size();
+	}
+
+	void AllocateFrom(std::size_t freeIndex, u32 data, u32 size)
+	{
+		const Block free = freeBlocks[freeIndex];
+		AllocatedBlock block = {{data - NODE_SIZE, data + size}, data, nodeID};
+
+		freeBlocks.erase(freeBlocks.begin() + freeIndex);
+
+		if (CanHoldFreeNode(block.end, free.end))
+			freeBlocks.insert(freeBlocks.begin() + freeIndex, {block.end, free.end});
+		else
+			block.end = free.end;
+
+		if (CanHoldFreeNode(free.start, block.start))
+			freeBlocks.insert(freeBlocks.begin() + freeIndex, {free.start, block.start});
+		else
+			block.start = free.start;
+
+		allocBlocks.insert(std::upper_bound(allocBlocks.begin(), allocBlocks.end(), block.start,
+			[](u32 start, const AllocatedBlock& b) { return start < b.start; }), block);
+	}
+
+	std::vector<AllocatedBlock>::iterator FindAllocated(u32 data)
+	{
+		return std::find_if(allocBlocks.begin(), allocBlocks.end(),
+			[data](const AllocatedBlock& b) { return b.data == data; });
+	}
+
+	// Adds a free block and merges it with the free blocks directly before and after it
+	void InsertFree(Block freed)
+	{
+		auto next = std::lower_bound(freeBlocks.begin(), freeBlocks.end(), freed.start,
+			[](const Block& b, u32 start) { return b.start < start; });
+
+		if (next != freeBlocks.end() && next->start == freed.end)
+		{
+			freed.end = next->end;
+			next = freeBlocks.erase(next);
+		}
+
+		if (next != freeBlocks.begin() && std::prev(next)->end == freed.start)
+			std::prev(next)->end = freed.end;
+		else
+			freeBlocks.insert(next, freed);
+	}
+
+public:
+	u16 nodeID = 0;
+	AllocationMode allocationMode = FIRST_FIT;
+	u64 numBlocksVisited = 0; // free blocks Allocate looked at, to compare the cost of the modes
+
+	// size is the number of bytes after the ExpandingHeapAllocator
+	explicit HeapModel(u32 size, AllocationMode allocationMode = FIRST_FIT):
+		heapSize(size),
+		freeBlocks{{0, size}},
+		allocationMode(allocationMode)
+	{}
+
+	// Returns the address of the data, or 0 if there wasn't enough space (no block can start at 0)
+	u32 Allocate(u32 size, s32 align)
+	{
+		size = AlignUp(size ? size : 1, 4);
+		const bool backwards = align < 0;
+		const u32 absAlign = std::max(backwards ? -align : align, 4);
+
+		if (allocationMode == SEGREGATED_FIT)
+		{
+			u32 data = 0;
+			const std::size_t i = FindSegregated(size, absAlign, backwards, data);
+
+			if (i != freeBlocks.size())
+			{
+				AllocateFrom(i, data, size);
+				return data;
+			}
+		}
+
+		const bool firstFit = allocationMode != BEST_FIT;
+
+		std::size_t bestIndex = freeBlocks.size();
+		u32 bestData = 0;
+		u32 bestSize = ~0u;
+
+		for (std::size_t n = 0; n < freeBlocks.size(); n++)
+		{
+			numBlocksVisited++;
+
+			const std::size_t i = backwards ? freeBlocks.size() - 1 - n : n;
+			const Block& free = freeBlocks[i];
+			const u32 data = backwards ? PlaceBackwards(free, size, absAlign) : PlaceForwards(free, size, absAlign);
+
+			if (data == 0) continue;
+
+			const u32 freeSize = free.end - free.start;
+
+			if (firstFit || freeSize < bestSize)
+			{
+				bestIndex = i;
+				bestData = data;
+				bestSize = freeSize;
+
+				if (firstFit || freeSize == NODE_SIZE + size) break;
+			}
+		}
+
+		if (bestIndex == freeBlocks.size()) return 0;
+
+		AllocateFrom(bestIndex, bestData, size);
+		return bestData;
+	}
+
+	bool Deallocate(u32 data)
+	{
+		const auto it = FindAllocated(data);
+		if (it == allocBlocks.end()) return false;
+
+		const Block freed = *it;
+		allocBlocks.erase(it);
+		InsertFree(freed);
+
+		return true;
+	}
+
+	// Like ExpandingHeapAllocator::Reallocate: shrinks the block in place, freeing the end if it's big enough
+	// for a free block, or grows it into the free block directly after it. Returns the new size of the data,
+	// or 0 if the block couldn't grow.
+	u32 Reallocate(u32 data, u32 newSize)
+	{
+		const auto it = FindAllocated(data);
+		if (it == allocBlocks.end()) return 0;
+
+		newSize = AlignUp(newSize ? newSize : 1, 4);
+		const u32 newEnd = data + newSize;
+
+		if (newEnd <= it->end)
+		{
+			if (CanHoldFreeNode(newEnd, it->end))
+			{
+				const Block freed = {newEnd, it->end};
+				it->end = newEnd;
+				InsertFree(freed);
+			}
+
+			return it->end - data;
+		}
+
+		const auto next = std::lower_bound(freeBlocks.begin(), freeBlocks.end(), it->end,
+			[](const Block& b, u32 start) { return b.start < start; });
+
+		if (next == freeBlocks.end() || next->start != it->end || next->end < newEnd)
+			return 0;
+
+		if (CanHoldFreeNode(newEnd, next->end))
+		{
+			it->end = newEnd;
+			next->start = newEnd;
+		}
+		else
+		{
+			it->end = next->end;
+			freeBlocks.erase(next);
+		}
+
+		return it->end - data;
+	}
+
+	// Frees every block allocated with the given node ID
+	void DeallocateAll(u16 id)
+	{
+		std::vector<u32> datas;
+		for (const AllocatedBlock& b : allocBlocks)
+			if (b.nodeID == id) datas.push_back(b.data);
+
+		for (u32 data : datas)
+			Deallocate(data);
+	}
+
+	// Does what FileCompaction::Compact does in game: every block whose data address is in movable
+	// is moved to the lowest free address it fits at (including the hole directly before it, if the heap
+	// is FIRST_FIT), but never higher, visiting the blocks in ascending address order. onMove(oldData, newData) is called for each move,
+	// so that the caller can patch its handles. Returns the number of blocks moved.
+	template<class F>
+	u32 Compact(std::span<const u32> movable, F&& onMove)
+	{
+		std::vector<u32> sorted(movable.begin(), movable.end());
+		std::sort(sorted.begin(), sorted.end());
+
+		const u16 prevNodeID = nodeID;
+		u32 numMoved = 0;
+
+		for (u32 data : sorted)
+		{
+			const auto it = FindAllocated(data);
+			if (it == allocBlocks.end()) continue;
+
+			nodeID = it->nodeID;
+			const u32 size = it->end - it->data;
+			u32 newData = Allocate(size, 4);
+
+			if (newData > data)
+			{
+				Deallocate(newData);
+				newData = 0;
+			}
+
+			if (newData != 0)
+				Deallocate(data);
+			else
+			{
+				// only first fit is sure to take the hole before the block after the bounce
+				if (allocationMode != FIRST_FIT) continue;
+
+				// bounce through a temporary block at the end so the block can slide into the hole before it
+				const u32 temp = Allocate(size, -4);
+
+				if (temp == 0 || temp < data)
+				{
+					if (temp != 0) Deallocate(temp);
+					continue;
+				}
+
+				Deallocate(data);
+				newData = Allocate(size, 4);
+				Deallocate(temp);
+			}
+
+			if (newData == data) continue;
+
+			onMove(data, newData);
+			numMoved++;
+		}
+
+		nodeID = prevNodeID;
+		return numMoved;
+	}
+
+	[[nodiscard]] u32 Size() const { return heapSize; }
+
+	[[nodiscard]] u32 MemoryLeft() const
+	{
+		u32 res = 0;
+		for (const Block& b : freeBlocks)
+			res += b.end - b.start - NODE_SIZE;
+
+		return res;
+	}
+
+	// The largest size that Allocate(size, align) would succeed with
+	[[nodiscard]] u32 MaxAllocatableSize(s32 align = 4) const
+	{
+		const u32 absAlign = std::max(align < 0 ? -align : align, 4);
+		u32 res = 0;
+
+		for (const Block& b : freeBlocks)
+		{
+			const u32 data = AlignUp(b.start + NODE_SIZE, absAlign);
+			if (data < b.end) res = std::max(res, AlignDown(b.end - data, 4));
+		}
+
+		return res;
+	}
+
+	// 0 if all free memory is in one block, approaching 1 as it's split into many small ones
+	[[nodiscard]] float Fragmentation() const
+	{
+		const u32 left = MemoryLeft();
+		return left == 0 ? 0.f : 1.f - static_cast<float>(MaxAllocatableSize()) / left;
+	}
+
+	[[nodiscard]] std::span<const Block> FreeBlocks() const { return freeBlocks; }
+	[[nodiscard]] std::span<const AllocatedBlock> AllocatedBlocks() const { return allocBlocks; }
+};
+
+/*
+	INFORMATION
+	A trace is the sequence of allocations and deallocations of one or more heaps, e.g. recorded
+	with a VAllocate/VDeallocate hook during a level load (see HeapTraceWriter and HeapTraceAnalyzer).
+	Deallocations and reallocations refer to the allocation they apply to by its index in the trace.
+	HeapReplay runs a trace against a set of HeapModels and keeps the statistics needed to size the
+	heaps and to compare allocation modes.
+*/
+
+struct HeapTraceEvent
+{
+	enum Type : u8
+	{
+		ALLOCATE,
+		DEALLOCATE,
+		REALLOCATE,
+	};
+
+	Type type;
+	u8 heap;   // index into the heaps passed to HeapReplay
+	u16 nodeID;
+	s32 align;
+	u32 size;  // for ALLOCATE and REALLOCATE
+	u32 alloc; // for DEALLOCATE and REALLOCATE: the index of the ALLOCATE event in the trace
+};
+
+class HeapReplay
+{
+public:
+	struct Failure
+	{
+		u32 event; // index in the trace
+		u8 heap;
+		u32 size;
+		u32 memoryLeft;
+		u32 maxAllocatableSize;
+	};
+
+	struct HeapStats
+	{
+		u32 maxUsed = 0;                   // high-water mark of MemoryNodes and data
+		u32 minMaxAllocatableSize = ~0u;
+		float maxFragmentation = 0.f;
+	};
+
+private:
+	std::span<HeapModel> heaps;
+	std::vector<u32> addresses; // per event, the address ALLOCATE returned (0 on failure)
+	std::vector<HeapStats> stats;
+	std::vector<Failure> failures;
+	u32 numRejected = 0;
+
+	// Whether the event refers to a heap that was passed and, unless it's an ALLOCATE, to an earlier
+	// ALLOCATE on the same heap
+	bool IsValid(std::span<const HeapTraceEvent> trace, std::size_t i) const
+	{
+		const HeapTraceEvent& e = trace[i];
+
+		if (e.heap >= heaps.size() || e.type > HeapTraceEvent::REALLOCATE) return false;
+		if (e.type == HeapTraceEvent::ALLOCATE) return true;
+
+		return e.alloc < i && trace[e.alloc].type == HeapTraceEvent::ALLOCATE && trace[e.alloc].heap == e.heap;
+	}
+
+	void UpdateStats(u8 heap)
+	{
+		const HeapModel& model = heaps[heap];
+		HeapStats& s = stats[heap];
+
+		s.maxUsed = std::max(s.maxUsed, model.Size() - model.MemoryLeft());
+		s.minMaxAllocatableSize = std::min(s.minMaxAllocatableSize, model.MaxAllocatableSize());
+		s.maxFragmentation = std::max(s.maxFragmentation, model.Fragmentation());
+	}
+
+public:
+	explicit HeapReplay(std::span<HeapModel> heaps) : heaps(heaps), stats(heaps.size()) {}
+
+	// Replays the events and returns whether all allocations succeeded. Deallocations
+	// of failed allocations are skipped, like the game's deallocation of a nullptr.
+	// onEvent(index, heaps) is called after each event, e.g. to sample statistics over time.
+	// Events of a truncated or foreign trace (a heap that wasn't passed, an allocation that
+	// isn't an earlier ALLOCATE on the same heap) are skipped without calling onEvent and
+	// counted in NumRejected, and make Run return false.
+	// The failures and statistics are those of this run only; the heaps aren't reset.
+	template<class F>
+	bool Run(std::span<const HeapTraceEvent> trace, F&& onEvent)
+	{
+		addresses.assign(trace.size(), 0);
+		stats.assign(heaps.size(), {});
+		failures.clear();
+		numRejected = 0;
+
+		for (std::size_t i = 0; i < trace.size(); i++)
+		{
+			if (!IsValid(trace, i))
+			{
+				numRejected++;
+				continue;
+			}
+
+			const HeapTraceEvent& e = trace[i];
+			HeapModel& model = heaps[e.heap];
+
+			if (e.type == HeapTraceEvent::ALLOCATE)
+			{
+				model.nodeID = e.nodeID;
+				addresses[i] = model.Allocate(e.size, e.align);
+
+				if (addresses[i] == 0)
+				{
+					failures.push_back({static_cast<u32>(i), e.heap, e.size,
+						model.MemoryLeft(), model.MaxAllocatableSize(e.align)});
+				}
+			}
+			else if (const u32 address = addresses[e.alloc])
+			{
+				// a failed reallocation isn't a failure, the game keeps using the old block
+				if (e.type == HeapTraceEvent::REALLOCATE)
+					model.Reallocate(address, e.size);
+				else
+					model.Deallocate(address);
+			}
+
+			UpdateStats(e.heap);
+			onEvent(i, heaps);
+		}
+
+		return failures.empty() && numRejected == 0;
+	}
+
+	bool Run(std::span<const HeapTraceEvent> trace)
+	{
+		return Run(trace, [](std::size_t, std::span<HeapModel>) {});
+	}
+
+	// The address an ALLOCATE event returned (0 if it failed), valid from the event on
+	[[nodiscard]] u32 Address(u32 event) const { return addresses[event]; }
+	[[nodiscard]] std::span<const Failure> Failures() const { return failures; }
+	[[nodiscard]] u32 NumRejected() const { return numRejected; }
+	[[nodiscard]] const HeapStats& Stats(u8 heap) const { return stats[heap]; }
+};
@@ -0,0 +1,222 @@
+#pragma once
+
+#include <span>
+
+/*
+	INFORMATION
+	Read-only statistics about the root, game and sound heaps, for finding out how close a level gets
+	to running out of memory before Allocate starts returning nullptr. Only the free lists are walked
+	to measure a heap, which are short, so HeapTelemetry::Recorder::Sample can be called every frame.
+	The breakdown by node ID walks the list of allocated blocks and is meant to be used on demand.
+	The sound heap is a SolidHeapAllocator, so it has neither free blocks nor node IDs.
+*/
+
+namespace HeapTelemetry
+{
+	enum HeapIndex : u8
+	{
+		ROOT,
+		GAME,
+		SOUND,
+
+		NUM_HEAPS
+	};
+
+	struct Usage
+	{
+		u32 size;            // including the MemoryNodes
+		u32 used;            // including the MemoryNodes
+		u32 largestFree;     // the largest block of free data
+		u16 numFreeBlocks;
+		u16 fragmentation;   // in 1/1000: 0 if all free memory is in one block
+
+		// MemoryLeft (the total free data) vs MaxAllocatableSize (the largest free block),
+		// in 64 bits because largestFree * 1000 overflows for heaps above 4 MB
+		static u16 Fragmentation(u32 totalFree, u32 largestFree)
+		{
+			return totalFree == 0 ? 0 : 1000 - static_cast<u64>(largestFree) * 1000 / totalFree;
+		}
+	};
+
+	inline Usage Measure(const ExpandingHeapAllocator& allocator)
+	{
+		Usage res = {};
+		res.size = static_cast<u8*>(allocator.heapEnd) - static_cast<u8*>(allocator.heapStart);
+
+		u32 totalFree = 0;
+
+		for (const MemoryNode* node = allocator.firstFreeBlock; node; node = node->next)
+		{
+			totalFree += node->size;
+			res.numFreeBlocks++;
+
+			if (node->size > res.largestFree)
+				res.largestFree = node->size;
+		}
+
+		res.used = res.size - totalFree - res.numFreeBlocks * sizeof(MemoryNode);
+		res.fragmentation = Usage::Fragmentation(totalFree, res.largestFree);
+
+		return res;
+	}
+
+	inline Usage Measure(const SolidHeapAllocator& allocator)
+	{
+		Usage res = {};
+		res.size = static_cast<u8*>(allocator.heapEnd) - static_cast<u8*>(allocator.heapStart);
+		res.largestFree = static_cast<u8*>(allocator.freeBlockEnd) - static_cast<u8*>(allocator.freeBlockBegin);
+		res.used = res.size - res.largestFree;
+		res.numFreeBlocks = res.largestFree != 0;
+
+		return res;
+	}
+
+	// Returns a zeroed Usage if the heap doesn't exist (yet)
+	inline Usage Measure(HeapIndex heap)
+	{
+		switch (heap)
+		{
+		case ROOT:
+			if (Memory::rootHeapPtr) return Measure(*Memory::rootHeapPtr->allocator);
+			break;
+		case GAME:
+			if (Memory::gameHeapPtr) return Measure(*Memory::gameHeapPtr->allocator);
+			break;
+		case SOUND:
+			if (Memory::soundHeapAllocatorPtrPtr && *Memory::soundHeapAllocatorPtrPtr)
+				return Measure(**Memory::soundHeapAllocatorPtrPtr);
+			break;
+		default:
+			break;
+		}
+
+		return {};
+	}
+
+	struct NodeIDUsage
+	{
+		u8 nodeID;
+		u16 numBlocks;
+		u32 bytes; // including the MemoryNodes
+	};
+
+	// Fills res with the memory used per node ID, in the order the IDs are first encountered, and
+	// returns the number of entries used. The blocks of the IDs that don't fit into res are added
+	// to others, if given, whose nodeID is left alone.
+	inline u32 MeasureByNodeID(const ExpandingHeapAllocator& allocator, std::span<NodeIDUsage> res, NodeIDUsage* others = nullptr)
+	{
+		u32 numIDs = 0;
+
+		if (others)
+		{
+			others->numBlocks = 0;
+			others->bytes = 0;
+		}
+
+		for (const MemoryNode* node = allocator.firstAllocatedBlock; node; node = node->next)
+		{
+			const u8 id = node->flags & MemoryNode::NODE_ID;
+			u32 i = 0;
+
+			while (i < numIDs && res[i].nodeID != id) i++;
+
+			NodeIDUsage* usage;
+
+			if (i < numIDs)
+				usage = &res[i];
+			else if (numIDs < res.size())
+			{
+				usage = &res[numIDs++];
+				*usage = {id, 0, 0};
+			}
+			else if (others)
+				usage = others;
+			else
+				continue;
+
+			usage->numBlocks++;
+			usage->bytes += node->size + sizeof(MemoryNode);
+		}
+
+		return numIDs;
+	}
+
+	// Keeps the high-water marks of the current level and the usage of the last
+	// capacity samples. Call Sample(FRAME_COUNTER) once per frame and OnLevelChange()
+	// when a new level starts.
+	template<u32 capacity>
+	class Recorder
+	{
+	public:
+		struct Record
+		{
+			u32 frame;
+			u32 used[NUM_HEAPS];
+			u32 largestFree[NUM_HEAPS];
+		};
+
+		struct HighWaterMarks
+		{
+			u32 maxUsed[NUM_HEAPS];
+			u32 minLargestFree[NUM_HEAPS];
+			u16 maxFragmentation[NUM_HEAPS];
+		};
+
+	private:
+		Record records[capacity];
+		u32 numRecords = 0; // total, so the oldest record is at numRecords % capacity once full
+		HighWaterMarks marks;
+
+	public:
+		Recorder() { OnLevelChange(); }
+
+		void OnLevelChange()
+		{
+			for (u32 i = 0; i < NUM_HEAPS; i++)
+			{
+				marks.maxUsed[i] = 0;
+				marks.minLargestFree[i] = ~0u;
+				marks.maxFragmentation[i] = 0;
+			}
+		}
+
+		void Sample(u32 frame)
+		{
+			Record& record = records[numRecords++ % capacity];
+			record.frame = frame;
+
+			for (u32 i = 0; i < NUM_HEAPS; i++)
+			{
+				const Usage usage = Measure(static_cast<HeapIndex>(i));
+
+				record.used[i] = usage.used;
+				record.largestFree[i] = usage.largestFree;
+
+				if (usage.used > marks.maxUsed[i]) marks.maxUsed[i] = usage.used;
+				if (usage.largestFree < marks.minLargestFree[i]) marks.minLargestFree[i] = usage.largestFree;
+				if (usage.fragmentation > marks.maxFragmentation[i]) marks.maxFragmentation[i] = usage.fragmentation;
+			}
+		}
+
+		[[nodiscard]] const HighWaterMarks& Marks() const { return marks; }
+		[[nodiscard]] u32 NumRecords() const { return numRecords < capacity ? numRecords : capacity; }
+
+		// 0 is the most recent record
+		[[nodiscard]] const Record& GetRecord(u32 age) const
+		{
+			return records[(numRecords - 1 - age) % capacity];
+		}
+
+		void Dump(const ostream& os) const
+		{
+			static constexpr const char* names[NUM_HEAPS] = {"root", "game", "sound"};
+
+			for (u32 i = 0; i < NUM_HEAPS; i++)
+			{
+				os << names[i] << ": max used " << marks.maxUsed[i]
+				   << ", min largest free " << marks.minLargestFree[i]
+				   << ", max fragmentation " << static_cast<u32>(marks.maxFragmentation[i]) << "/1000\n";
+			}
+		}
+	};
+}
@@ -0,0 +1,456 @@
+#pragma once
+
+#include "HeapModel.h"
+#include "HeapTraceFormat.h"
+#include <array>
+#include <istream>
+#include <string>
+#include <unordered_map>
+
+/*
+	INFORMATION
+	Host-side tools for the traces written by HeapTraceWriter (it isn't included by SM64DS_PI.h):
+
+		std::vector<u8> data = ParseHeapTraceDump(logFile);  // the "HTRC " lines of the debug console
+		DecodedHeapTrace trace;
+		DecodeHeapTrace(data, trace);
+
+		HeapTraceAnalyzer analyzer(trace);
+		analyzer.Timeline(1);                     // live bytes of heap 1 over time
+		analyzer.Lifetimes(1);                    // how many frames allocations live
+
+		std::vector<HeapModel> heaps = analyzer.MakeHeaps(); // the recorded sizes, or try other ones
+		analyzer.Replay(heaps);                   // which allocations fail and what is in their way
+
+	Reallocations are replayed as well, since BMD_File::ShrinkAllocation and friends shape the heap.
+	DEALLOCATE_ALL frees everything that was allocated on the heap before it.
+*/
+
+struct DecodedHeapEvent
+{
+	HeapTraceFormat::EventType type;
+	u8 heap;
+	u16 nodeID;
+	s32 align;
+	u32 frame;
+	u32 address; // 0 for failed allocations; the heap start for HEAP
+	u32 size;    // for ALLOCATE and REALLOCATE; the heap size for HEAP
+};
+
+struct DecodedHeapTrace
+{
+	std::vector<DecodedHeapEvent> events;
+	u32 heapStart[HeapTraceFormat::MAX_HEAPS] = {};
+	u32 heapSize[HeapTraceFormat::MAX_HEAPS] = {}; // 0 if the heap wasn't recorded
+};
+
+// Returns false if the data ends in the middle of an event or contains an unknown event type.
+// The events before that are still decoded.
+inline bool DecodeHeapTrace(std::span<const u8> data, DecodedHeapTrace& res)
+{
+	using namespace HeapTraceFormat;
+
+	u32 frame = 0;
+	u32 prevAddress[MAX_HEAPS] = {};
+	u32 prevSize[MAX_HEAPS] = {};
+	u16 nodeIDs[MAX_HEAPS] = {};
+
+	const u8* pos = data.data();
+	const u8* const end = pos + data.size();
+
+	while (pos < end)
+	{
+		const u8 header = *pos++;
+		DecodedHeapEvent e = {};
+		e.type = static_cast<EventType>(header & TYPE);
+		e.heap = (header & HEAP_INDEX) >> HEAP_INDEX_SHIFT;
+		e.align = 4;
+
+		u32 x = 0;
+		if (!(pos = ReadVarint(pos, end, x))) return false;
+
+		frame += x;
+		e.frame = frame;
+
+		const auto readAddress = [&]
+		{
+			if (!(pos = ReadVarint(pos, end, x))) return false;
+
+			prevAddress[e.heap] += static_cast<u32>(UnZigZag(x)) * 4;
+			e.address = prevAddress[e.heap];
+			return true;
+		};
+
+		const auto readSize = [&]
+		{
+			if (!(pos = ReadVarint(pos, end, x))) return false;
+
+			prevSize[e.heap] += static_cast<u32>(UnZigZag(x));
+			e.size = prevSize[e.heap];
+			return true;
+		};
+
+		switch (e.type)
+		{
+		case HEAP:
+			if (!(pos = ReadVarint(pos, end, e.address)) || !(pos = ReadVarint(pos, end, e.size))) return false;
+
+			res.heapStart[e.heap] = e.address;
+			res.heapSize[e.heap] = e.size;
+			break;
+
+		case ALLOCATE:
+			if (!readAddress() || !readSize()) return false;
+
+			if (header & HAS_ALIGN)
+			{
+				if (pos == end) return false;
+				e.align = 1 << *pos++;
+			}
+
+			if (header & HAS_NODE_ID)
+			{
+				if (pos == end) return false;
+				nodeIDs[e.heap] = *pos++;
+			}
+
+			if (header & BACKWARDS) e.align = -e.align;
+			break;
+
+		case DEALLOCATE:
+			if (!readAddress()) return false;
+			break;
+
+		case REALLOCATE:
+			if (!readAddress() || !readSize()) return false;
+			break;
+
+		case DEALLOCATE_ALL:
+			break;
+
+		default:
+			return false;
+		}
+
+		e.nodeID = nodeIDs[e.heap];
+		res.events.push_back(e);
+	}
+
+	return true;
+}
+
+// Reads the bytes from the "HTRC " lines that HeapTraceWriter::Dump printed, ignoring everything else
+inline std::vector<u8> ParseHeapTraceDump(std::istream& is)
+{
+	const auto hexValue = [](char c) -> s32
+	{
+		if (c >= '0' && c <= '9') return c - '0';
+		if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+		if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+		return -1;
+	};
+
+	std::vector<u8> res;
+	std::string line;
+
+	while (std::getline(is, line))
+	{
+		const std::size_t start = line.find("HTRC ");
+		if (start == std::string::npos) continue;
+
+		for (std::size_t i = start + 5; i + 1 < line.size(); i += 2)
+		{
+			const s32 high = hexValue(line[i]);
+			const s32 low = hexValue(line[i + 1]);
+
+			if (high < 0 || low < 0) break;
+
+			res.push_back(high << 4 | low);
+		}
+	}
+
+	return res;
+}
+
+class HeapTraceAnalyzer
+{
+public:
+	struct TimelinePoint
+	{
+		u32 frame;
+		u32 liveBytes; // requested sizes, without MemoryNodes and padding
+		u32 numLive;
+	};
+
+	struct LifetimeHistogram
+	{
+		std::array<u32, 32> counts = {}; // counts[i]: allocations freed after 2^i - 1 to 2^(i+1) - 2 frames
+		u32 numNeverFreed = 0;           // still alive at the end of the trace
+	};
+
+	struct Blocker
+	{
+		u32 event; // the ALLOCATE in the decoded trace
+		u32 frame;
+		u32 size;
+		u16 nodeID;
+	};
+
+	struct BlockedAllocation
+	{
+		u32 event; // the failed ALLOCATE in the decoded trace
+		u32 size;
+		u32 memoryLeft;
+		u32 maxAllocatableSize;
+		std::vector<Blocker> blockers; // the fewest adjacent blocks that would make room if they were freed
+	};
+
+	struct ReplayReport
+	{
+		std::vector<BlockedAllocation> blocked;
+		std::vector<HeapReplay::HeapStats> stats; // per heap
+	};
+
+private:
+	const DecodedHeapTrace& trace;
+	std::vector<HeapTraceEvent> replayTrace;
+	std::vector<u32> decodedIndex; // per replay event, the index in the decoded trace
+
+	// Matches deallocations and reallocations to their allocations by address
+	void BuildReplayTrace()
+	{
+		std::unordered_map<u32, u32> live[HeapTraceFormat::MAX_HEAPS]; // address -> replay index
+
+		for (u32 i = 0; i < trace.events.size(); i++)
+		{
+			const DecodedHeapEvent& e = trace.events[i];
+
+			const auto emit = [&](HeapTraceEvent::Type type, u32 size, u32 alloc)
+			{
+				replayTrace.push_back({type, e.heap, e.nodeID, e.align, size, alloc});
+				decodedIndex.push_back(i);
+			};
+
+			switch (e.type)
+			{
+			case HeapTraceFormat::ALLOCATE:
+				if (e.address) live[e.heap][e.address] = replayTrace.size();
+
+				emit(HeapTraceEvent::ALLOCATE, e.size, 0);
+				break;
+
+			case HeapTraceFormat::DEALLOCATE:
+			case HeapTraceFormat::REALLOCATE:
+			{
+				const auto it = live[e.heap].find(e.address);
+				if (it == live[e.heap].end()) break; // allocated before the recording started
+
+				if (e.type == HeapTraceFormat::DEALLOCATE)
+				{
+					emit(HeapTraceEvent::DEALLOCATE, 0, it->second);
+					live[e.heap].erase(it);
+				}
+				else
+					emit(HeapTraceEvent::REALLOCATE, e.size, it->second);
+
+				break;
+			}
+
+			case HeapTraceFormat::DEALLOCATE_ALL:
+				for (const auto& [address, alloc] : live[e.heap])
+					emit(HeapTraceEvent::DEALLOCATE, 0, alloc);
+
+				live[e.heap].clear();
+				break;
+
+			default:
+				break;
+			}
+		}
+	}
+
+	// The window of consecutive blocks (free or allocated) that spans enough memory for a block
+	// of the given size with the fewest allocated blocks in it
+	static std::vector<const HeapModel::AllocatedBlock*> FindBlockers(const HeapModel& model, u32 size)
+	{
+		struct Span
+		{
+			u32 start;
+			u32 end;
+			const HeapModel::AllocatedBlock* allocated; // nullptr for free blocks
+		};
+
+		std::vector<Span> spans;
+		for (const HeapModel::Block& b : model.FreeBlocks()) spans.push_back({b.start, b.end, nullptr});
+		for (const HeapModel::AllocatedBlock& b : model.AllocatedBlocks()) spans.push_back({b.start, b.end, &b});
+
+		std::sort(spans.begin(), spans.end(), [](const Span& a, const Span& b) { return a.start < b.start; });
+
+		const u32 needed = HeapModel::NODE_SIZE + ((size + 3) & ~3u);
+		std::size_t bestFirst = 0, bestLast = 0;
+		u32 bestCount = ~0u;
+		u32 count = 0;
+
+		for (std::size_t first = 0, last = 0; last < spans.size(); last++)
+		{
+			count += spans[last].allocated != nullptr;
+
+			while (first < last && spans[last].end - spans[first + 1].start >= needed)
+				count -= spans[first++].allocated != nullptr;
+
+			if (spans[last].end - spans[first].start >= needed && count < bestCount)
+			{
+				bestCount = count;
+				bestFirst = first;
+				bestLast = last;
+			}
+		}
+
+		std::vector<const HeapModel::AllocatedBlock*> res;
+
+		if (bestCount != ~0u)
+			for (std::size_t i = bestFirst; i <= bestLast; i++)
+				if (spans[i].allocated) res.push_back(spans[i].allocated);
+
+		return res;
+	}
+
+public:
+	explicit HeapTraceAnalyzer(const DecodedHeapTrace& trace) : trace(trace)
+	{
+		BuildReplayTrace();
+	}
+
+	// The trace in the form HeapReplay takes
+	[[nodiscard]] std::span<const HeapTraceEvent> ReplayTrace() const { return replayTrace; }
+
+	// One point per frame with events on the heap, with the state at the end of that frame
+	[[nodiscard]] std::vector<TimelinePoint> Timeline(u8 heap) const
+	{
+		std::vector<TimelinePoint> res;
+		TimelinePoint point = {};
+		bool started = false;
+		std::vector<u32> sizes(replayTrace.size());
+
+		for (u32 i = 0; i < replayTrace.size(); i++)
+		{
+			const HeapTraceEvent& e = replayTrace[i];
+			const DecodedHeapEvent& decoded = trace.events[decodedIndex[i]];
+
+			if (e.heap != heap) continue;
+
+			if (started && decoded.frame != point.frame)
+				res.push_back(point);
+
+			point.frame = decoded.frame;
+			started = true;
+
+			if (e.type == HeapTraceEvent::ALLOCATE && decoded.address)
+			{
+				sizes[i] = e.size;
+				point.liveBytes += e.size;
+				point.numLive++;
+			}
+			else if (e.type == HeapTraceEvent::REALLOCATE)
+			{
+				point.liveBytes += e.size - sizes[e.alloc];
+				sizes[e.alloc] = e.size;
+			}
+			else if (e.type == HeapTraceEvent::DEALLOCATE)
+			{
+				point.liveBytes -= sizes[e.alloc];
+				point.numLive--;
+			}
+		}
+
+		if (started) res.push_back(point);
+
+		return res;
+	}
+
+	[[nodiscard]] LifetimeHistogram Lifetimes(u8 heap) const
+	{
+		LifetimeHistogram res;
+		std::vector<bool> freed(replayTrace.size());
+
+		for (u32 i = 0; i < replayTrace.size(); i++)
+		{
+			const HeapTraceEvent& e = replayTrace[i];
+			if (e.heap != heap || e.type != HeapTraceEvent::DEALLOCATE) continue;
+
+			const u32 lifetime = trace.events[decodedIndex[i]].frame - trace.events[decodedIndex[e.alloc]].frame;
+			res.counts[31 - __builtin_clz(lifetime + 1)]++;
+			freed[e.alloc] = true;
+		}
+
+		for (u32 i = 0; i < replayTrace.size(); i++)
+		{
+			const HeapTraceEvent& e = replayTrace[i];
+
+			if (e.heap == heap && e.type == HeapTraceEvent::ALLOCATE && trace.events[decodedIndex[i]].address && !freed[i])
+				res.numNeverFreed++;
+		}
+
+		return res;
+	}
+
+	// HeapModels with the recorded sizes, without the ExpandingHeapAllocator (recorded heaps start after it)
+	[[nodiscard]] std::vector<HeapModel> MakeHeaps() const
+	{
+		std::vector<HeapModel> res;
+
+		for (u32 i = 0; i < HeapTraceFormat::MAX_HEAPS; i++)
+			res.emplace_back(trace.heapSize[i]);
+
+		return res;
+	}
+
+	// Replays the trace against heaps (one per heap index) and finds out what was in the way of each
+	// allocation that failed
+	ReplayReport Replay(std::span<HeapModel> heaps) const
+	{
+		ReplayReport res;
+		HeapReplay replay(heaps);
+		std::size_t numFailures = 0;
+
+		// address -> replay index of the live allocations, for naming the blockers
+		std::vector<std::unordered_map<u32, u32>> live(heaps.size());
+
+		replay.Run(replayTrace, [&](std::size_t i, std::span<HeapModel> models)
+		{
+			const HeapTraceEvent& e = replayTrace[i];
+
+			if (e.type == HeapTraceEvent::ALLOCATE)
+			{
+				if (const u32 address = replay.Address(i))
+					live[e.heap][address] = i;
+			}
+			else if (e.type == HeapTraceEvent::DEALLOCATE)
+				live[e.heap].erase(replay.Address(e.alloc));
+
+			const std::span<const HeapReplay::Failure> failures = replay.Failures();
+			if (failures.size() == numFailures) return;
+
+			numFailures = failures.size();
+			const HeapReplay::Failure& failure = failures.back();
+
+			BlockedAllocation blocked = {decodedIndex[failure.event], failure.size, failure.memoryLeft, failure.maxAllocatableSize, {}};
+
+			for (const HeapModel::AllocatedBlock* block : FindBlockers(models[e.heap], e.size))
+			{
+				const auto it = live[e.heap].find(block->data);
+				if (it == live[e.heap].end()) continue;
+
+				const DecodedHeapEvent& alloc = trace.events[decodedIndex[it->second]];
+				blocked.blockers.push_back({decodedIndex[it->second], alloc.frame, alloc.size, alloc.nodeID});
+			}
+
+			res.blocked.push_back(std::move(blocked));
+		});
+
+		for (u8 i = 0; i < heaps.size(); i++)
+			res.stats.push_back(replay.Stats(i));
+
+		return res;
+	}
+};
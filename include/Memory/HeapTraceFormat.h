@@ -0,0 +1,86 @@
+#pragma once
+
+#include "../Math/MathCommon.h"
+
+/*
+	INFORMATION
+	The binary format of heap traces, shared by HeapTraceWriter (in game) and HeapTraceAnalyzer (on the
+	host). A trace is a sequence of events, each starting with a header byte:
+
+		bits 0-2: the event type
+		bits 3-4: the heap index (the index of the heap in AllocationTracer)
+		bit 5:    the allocation was made backwards (align < 0)
+		bit 6:    the alignment isn't 4, a byte with log2(|align|) follows the other fields
+		bit 7:    the node ID changed, a byte with the new node ID follows the other fields
+
+	followed by unsigned LEB128 varints, most of them zigzag-encoded deltas to the previous event:
+
+		HEAP:       frame delta, heap start, heap size (sent once per heap, before its other events)
+		ALLOCATE:   frame delta, address delta / 4, size delta (the address is 0 if the allocation failed)
+		DEALLOCATE: frame delta, address delta / 4
+		REALLOCATE: frame delta, address delta / 4, size delta (the new size)
+		DEALLOCATE_ALL: frame delta
+
+	The frame delta is relative to the previous event of any heap, the address and size deltas are
+	relative to the previous event of the same heap. The node ID is the one set on the heap's
+	allocator when the allocation was made, which starts out as 0 for every heap.
+*/
+
+namespace HeapTraceFormat
+{
+	enum EventType : u8
+	{
+		HEAP,
+		ALLOCATE,
+		DEALLOCATE,
+		REALLOCATE,
+		DEALLOCATE_ALL,
+	};
+
+	enum HeaderBits : u8
+	{
+		TYPE           = 0x7 << 0,
+		HEAP_INDEX     = 0x3 << 3,
+		BACKWARDS      = 0x1 << 5,
+		HAS_ALIGN      = 0x1 << 6,
+		HAS_NODE_ID    = 0x1 << 7,
+
+		HEAP_INDEX_SHIFT = 3,
+	};
+
+	constexpr u32 MAX_HEAPS = 4;
+	constexpr u32 MAX_VARINT_SIZE = 5;
+	constexpr u32 MAX_EVENT_SIZE = 1 + 3 * MAX_VARINT_SIZE + 2;
+
+	constexpr u32 ZigZag(s32 x) { return static_cast<u32>(x) << 1 ^ static_cast<u32>(x >> 31); }
+	constexpr s32 UnZigZag(u32 x) { return static_cast<s32>(x >> 1) ^ -static_cast<s32>(x & 1); }
+
+	// Returns the position after the varint
+	constexpr u8* WriteVarint(u8* pos, u32 x)
+	{
+		while (x >= 0x80)
+		{
+			*pos++ = x | 0x80;
+			x >>= 7;
+		}
+
+		*pos++ = x;
+		return pos;
+	}
+
+	// Returns the position after the varint, or nullptr if it doesn't end before end
+	constexpr const u8* ReadVarint(const u8* pos, const u8* end, u32& x)
+	{
+		x = 0;
+
+		for (u32 shift = 0; pos < end && shift < 7 * MAX_VARINT_SIZE; shift += 7)
+		{
+			const u8 byte = *pos++;
+			x |= static_cast<u32>(byte & 0x7f) << shift;
+
+			if (!(byte & 0x80)) return pos;
+		}
+
+		return nullptr;
+	}
+}
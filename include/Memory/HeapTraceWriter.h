@@ -0,0 +1,200 @@
+#pragma once
+
+#include "HeapTraceFormat.h"
+#include <span>
+
+/*
+	INFORMATION
+	Writes heap events in the format described in HeapTraceFormat.h into a buffer that is reserved up
+	front, so recording doesn't allocate and doesn't change the heaps it records. AllocationTracer
+	feeds it the events of the heaps it's installed on:
+
+		static u8 traceBuffer[0x8000];
+		HeapTraceWriter writer;
+		writer.SetBuffer(traceBuffer);
+		tracer.SetTraceWriter(&writer);  // also records the position and size of each heap
+
+		// later, e.g. when a button combination is pressed:
+		writer.Dump(cout);
+
+	An event takes 3 to 5 bytes most of the time. Once the buffer is full, further events are dropped
+	and counted, and the trace ends at the last complete event. Dump prints the trace through the
+	debug console as lines of hex digits starting with "HTRC ", which ParseHeapTraceDump reads back.
+*/
+
+class HeapTraceWriter
+{
+	u8* buffer = nullptr;
+	u32 capacity = 0;
+	u32 size = 0;
+	u32 prevFrame = 0;
+	u32 prevAddress[HeapTraceFormat::MAX_HEAPS] = {};
+	u32 prevSize[HeapTraceFormat::MAX_HEAPS] = {};
+	u16 nodeIDs[HeapTraceFormat::MAX_HEAPS] = {};
+
+	static u32 AddressOf(const void* ptr) { return static_cast<u32>(reinterpret_cast<uintptr_t>(ptr)); }
+
+	// Returns the position to write the rest of the event to, or nullptr if it might not fit
+	u8* Begin(u8 header, u32 frame)
+	{
+		if (capacity - size < HeapTraceFormat::MAX_EVENT_SIZE)
+		{
+			stats.numDropped++;
+			return nullptr;
+		}
+
+		u8* pos = buffer + size;
+		*pos++ = header;
+		pos = HeapTraceFormat::WriteVarint(pos, frame - prevFrame);
+		prevFrame = frame;
+
+		return pos;
+	}
+
+	void End(u8* pos)
+	{
+		size = pos - buffer;
+		stats.numEvents++;
+	}
+
+	u8* WriteAddress(u8* pos, u8 heap, const void* ptr)
+	{
+		const u32 address = AddressOf(ptr);
+		pos = HeapTraceFormat::WriteVarint(pos, HeapTraceFormat::ZigZag(static_cast<s32>(address - prevAddress[heap]) >> 2));
+		prevAddress[heap] = address;
+
+		return pos;
+	}
+
+	u8* WriteSize(u8* pos, u8 heap, u32 newSize)
+	{
+		pos = HeapTraceFormat::WriteVarint(pos, HeapTraceFormat::ZigZag(static_cast<s32>(newSize - prevSize[heap])));
+		prevSize[heap] = newSize;
+
+		return pos;
+	}
+
+	static u8 Header(HeapTraceFormat::EventType type, u8 heap)
+	{
+		return type | heap << HeapTraceFormat::HEAP_INDEX_SHIFT;
+	}
+
+public:
+	struct Stats
+	{
+		u32 numEvents;
+		u32 numDropped; // because the buffer was full
+	};
+
+	Stats stats = {};
+
+	// Clears the trace
+	void SetBuffer(std::span<u8> newBuffer)
+	{
+		buffer = newBuffer.data();
+		capacity = newBuffer.size();
+		Reset();
+	}
+
+	// Clears the trace, the heaps need to be recorded again afterwards
+	void Reset()
+	{
+		size = 0;
+		prevFrame = 0;
+		stats = {};
+
+		for (u32 i = 0; i < HeapTraceFormat::MAX_HEAPS; i++)
+		{
+			prevAddress[i] = 0;
+			prevSize[i] = 0;
+			nodeIDs[i] = 0;
+		}
+	}
+
+	void RecordHeap(u8 heap, u32 frame, const void* start, u32 heapSize)
+	{
+		if (u8* pos = Begin(Header(HeapTraceFormat::HEAP, heap), frame))
+		{
+			pos = HeapTraceFormat::WriteVarint(pos, AddressOf(start));
+			End(HeapTraceFormat::WriteVarint(pos, heapSize));
+		}
+	}
+
+	// ptr is nullptr if the allocation failed
+	void RecordAllocate(u8 heap, u32 frame, const void* ptr, u32 allocSize, s32 align, u16 nodeID)
+	{
+		const u32 absAlign = align < 0 ? -align : align;
+		u8 header = Header(HeapTraceFormat::ALLOCATE, heap);
+
+		if (align < 0)             header |= HeapTraceFormat::BACKWARDS;
+		if (absAlign > 4)          header |= HeapTraceFormat::HAS_ALIGN;
+		if (nodeID != nodeIDs[heap]) header |= HeapTraceFormat::HAS_NODE_ID;
+
+		if (u8* pos = Begin(header, frame))
+		{
+			pos = WriteAddress(pos, heap, ptr);
+			pos = WriteSize(pos, heap, allocSize);
+
+			if (header & HeapTraceFormat::HAS_ALIGN)
+				*pos++ = 31 - __builtin_clz(absAlign);
+
+			if (header & HeapTraceFormat::HAS_NODE_ID)
+			{
+				*pos++ = nodeID;
+				nodeIDs[heap] = nodeID;
+			}
+
+			End(pos);
+		}
+	}
+
+	void RecordDeallocate(u8 heap, u32 frame, const void* ptr)
+	{
+		if (u8* pos = Begin(Header(HeapTraceFormat::DEALLOCATE, heap), frame))
+			End(WriteAddress(pos, heap, ptr));
+	}
+
+	void RecordReallocate(u8 heap, u32 frame, const void* ptr, u32 newSize)
+	{
+		if (u8* pos = Begin(Header(HeapTraceFormat::REALLOCATE, heap), frame))
+		{
+			pos = WriteAddress(pos, heap, ptr);
+			End(WriteSize(pos, heap, newSize));
+		}
+	}
+
+	void RecordDeallocateAll(u8 heap, u32 frame)
+	{
+		if (u8* pos = Begin(Header(HeapTraceFormat::DEALLOCATE_ALL, heap), frame))
+			End(pos);
+	}
+
+	[[nodiscard]] std::span<const u8> Data() const { return {buffer, size}; }
+	[[nodiscard]] bool IsFull() const { return stats.numDropped != 0; }
+
+	void Dump(const ostream& os) const
+	{
+		static constexpr u32 BYTES_PER_LINE = 48;
+		static constexpr char digits[] = "0123456789abcdef";
+
+		char line[5 + 2 * BYTES_PER_LINE + 2] = "HTRC ";
+
+		for (u32 start = 0; start < size; start += BYTES_PER_LINE)
+		{
+			const u32 end = start + BYTES_PER_LINE < size ? start + BYTES_PER_LINE : size;
+			char* pos = line + 5;
+
+			for (u32 i = start; i < end; i++)
+			{
+				*pos++ = digits[buffer[i] >> 4];
+				*pos++ = digits[buffer[i] & 0xf];
+			}
+
+			*pos++ = '\n';
+			*pos = '\0';
+			os << static_cast<const char*>(line);
+		}
+
+		os << "HTRC end, " << stats.numEvents << " events, " << stats.numDropped << " dropped\n";
+	}
+};
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <new>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+/*
+	INFORMATION
+	A bump allocator for temporaries that only live for part of a frame (collision query results,
+	particle spawn parameters, intermediate matrices, ...), as an alternative to MATRIX_SCRATCH_PAPER,
+	which is shared by everything and easily clobbered, and to the game heap, which walks a free list.
+	It owns a SolidHeap, so allocating is just moving a pointer:
+
+		ScratchArena scratch;                // e.g. a global
+		scratch.Create(0x4000);              // once, when the heaps exist
+		scratch.BeginFrame();                // once per frame, frees everything
+
+		ScratchArena::Scope scope(scratch);  // everything allocated from here on is freed with scope
+		ScratchSpan<Matrix4x3> mats = scratch.Allocate<Matrix4x3>(numBones);
+
+	Scopes nest. They use SolidHeapAllocator::SaveState/LoadState, so a scope costs one small
+	allocation for the state. If the arena is too full for it, the failure is counted in
+	numFailedScopes and the scope frees nothing, so what's allocated in it stays until the
+	enclosing scope ends or the next BeginFrame. Nothing allocated from the arena is ever
+	destructed, so only trivially destructible types can be allocated.
+
+	If the arena runs out of space, Allocate returns an empty span and the failure is counted,
+	so check the span (or numOverflows during development) and size the arena accordingly.
+*/
+
+template<class T>
+using ScratchSpan = std::span<T>;
+
+class ScratchArena
+{
+	SolidHeap* heap = nullptr;
+	u32 depth = 0; // the number of open scopes, which is also the ID of the last saved state
+
+public:
+	struct Stats
+	{
+		u32 maxUsed;             // high-water mark since Create
+		u32 numOverflows;        // allocations that failed since Create
+		u32 largestFailedSize;
+		u32 numFailedScopes;     // scopes whose state couldn't be saved since Create
+	};
+
+	Stats stats = {};
+
+	class Scope
+	{
+		ScratchArena& arena;
+		u32 id;
+		bool saved;
+
+	public:
+		[[gnu::always_inline]]
+		explicit Scope(ScratchArena& arena) : arena(arena), id(++arena.depth)
+		{
+			saved = arena.heap->allocator->SaveState(id);
+
+			if (!saved) arena.stats.numFailedScopes++;
+		}
+
+		[[gnu::always_inline]]
+		~Scope()
+		{
+			// if SaveState failed, there is no state with this ID to go back to
+			if (saved) arena.heap->allocator->LoadState(id);
+
+			arena.depth--;
+		}
+
+		[[nodiscard]] bool Saved() const { return saved; }
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+	};
+
+	// Returns whether the heap could be created
+	bool Create(u32 size, Heap* parent = Memory::rootHeapPtr)
+	{
+		heap = Heap::CreateSolidHeap(size, parent, 4);
+		return heap != nullptr;
+	}
+
+	void Destroy()
+	{
+		if (heap) heap->Destroy();
+		heap = nullptr;
+	}
+
+	// Frees everything. Must not be called while a Scope is open.
+	void BeginFrame()
+	{
+		heap->allocator->Reset(3);
+	}
+
+	[[nodiscard]] bool IsCreated() const { return heap != nullptr; }
+
+	[[nodiscard]] u32 MemoryLeft() const { return heap->allocator->MemoryLeft(4); }
+
+	[[nodiscard]]
+	void* AllocateBytes(u32 size, s32 align = 4)
+	{
+		SolidHeapAllocator& allocator = *heap->allocator;
+		void* ptr = allocator.Allocate(size, align);
+
+		if (!ptr)
+		{
+			stats.numOverflows++;
+
+			if (size > stats.largestFailedSize)
+				stats.largestFailedSize = size;
+
+			return nullptr;
+		}
+
+		const u32 used = static_cast<u8*>(allocator.heapEnd) - static_cast<u8*>(allocator.heapStart)
+			- (static_cast<u8*>(allocator.freeBlockEnd) - static_cast<u8*>(allocator.freeBlockBegin));
+
+		if (used > stats.maxUsed)
+			stats.maxUsed = used;
+
+		return ptr;
+	}
+
+	// The elements are default-initialized, so scalars and trivial structs are left uninitialized
+	template<class T> [[nodiscard]]
+	ScratchSpan<T> Allocate(u32 count)
+	{
+		static_assert(std::is_trivially_destructible_v<T>, "ScratchArena never calls destructors");
+
+		void* ptr = AllocateBytes(sizeof(T) * count, alignof(T) < 4 ? 4 : alignof(T));
+
+		if (!ptr) return {};
+
+		T* data = static_cast<T*>(ptr);
+		for (u32 i = 0; i < count; i++)
+			new (data + i) T;
+
+		return {data, count};
+	}
+
+	template<class T, class... Args> [[nodiscard]]
+	T* New(Args&&... args)
+	{
+		static_assert(std::is_trivially_destructible_v<T>, "ScratchArena never calls destructors");
+
+		void* ptr = AllocateBytes(sizeof(T), alignof(T) < 4 ? 4 : alignof(T));
+
+		return ptr ? new (ptr) T(std::forward<Args>(args)...) : nullptr;
+	}
+
+	void Dump(const ostream& os) const
+	{
+		os << "scratch: max used " << stats.maxUsed
+		   << ", overflows " << stats.numOverflows
+		   << ", largest failed " << stats.largestFailedSize
+		   << ", failed scopes " << stats.numFailedScopes << '\n';
+	}
+};
@@ -0,0 +1,411 @@
+#pragma once
+
+#include <algorithm>
+
+/*
+	INFORMATION
+	ExpandingHeapAllocator::Allocate walks the free list until it finds a block that fits (or, in best
+	fit mode, the whole list), which gets slow on heaps with many free blocks like the root heap.
+	SegregatedFitIndex keeps an index of the free blocks of one ExpandingHeap, sorted into size classes
+	(a TLSF-like two-level bitmap: the power of 2 of the size, split into 4 ranges), so that a block
+	that fits is found in constant time.
+
+	The heap itself isn't changed: the blocks are still the game's MemoryNodes in the game's lists,
+	and blocks are still split and merged by AllocateNode and Deallocate, so everything else that
+	reads the heap (SizeofInternal, MemoryLeft, MaxAllocatableSize, HeapTelemetry, ...) keeps working.
+	The index only decides which free block to use: the smallest size class that is guaranteed to fit,
+	which is close to best fit. The direction (the sign of align) still decides whether the block is
+	placed at the start or at the end of the free block, but, unlike the game, not which block is used.
+
+	Install(heap) redirects VAllocate, VDeallocate, VReallocate and VDeallocateAll of that heap through
+	a copy of its vtable, so all allocations go through the index, including the game's own. If the
+	heap has more free blocks than MAX_FREE_BLOCKS, the heap falls back to the game's allocator until
+	the index fits again after a deallocation. If the index has no block for an allocation, the game's
+	allocator gets to try as well. Each index has its own HeapHook (see HeapHook.h).
+
+	The index must be the first hook on its heap: it doesn't call the hooks below it for the
+	allocations it serves, so they would see every deallocation but not every allocation. Install
+	returns false if the heap already has a hook, so install AllocationTracer, FileCache, ... after it.
+
+	To compare the block choice with the game's on a recorded trace, replay it with HeapModel's
+	SEGREGATED_FIT mode (see HeapModel.h).
+*/
+
+class SegregatedFitIndex
+{
+public:
+	static constexpr u32 MAX_FREE_BLOCKS = 256;
+	static constexpr u32 MAX_HEAPS = 4;
+
+private:
+	static constexpr u16 NONE = 0xffff;
+	static constexpr u32 NUM_FIRST_LEVELS = 32;
+	static constexpr u32 NUM_SECOND_LEVELS = 4;
+	static constexpr u32 NUM_BUCKETS = 64;
+
+	struct Entry
+	{
+		MemoryNode* node;
+		u8* end;         // the end of the node when it was added
+		u16 prevInBin;
+		u16 nextInBin;
+		u16 nextByStart;
+		u16 nextByEnd;
+		u8 bin;
+	};
+
+	HeapHook hook; // per index, because the heaps can be of different classes (or already hooked)
+	Entry entries[MAX_FREE_BLOCKS];
+	u16 firstUnused;
+	u16 binHeads[NUM_FIRST_LEVELS * NUM_SECOND_LEVELS];
+	u32 firstLevelBitmap;
+	u8 secondLevelBitmaps[NUM_FIRST_LEVELS];
+	u16 byStart[NUM_BUCKETS];
+	u16 byEnd[NUM_BUCKETS];
+	bool valid = false;
+
+	static inline SegregatedFitIndex* installed[MAX_HEAPS] = {};
+
+	static u32 Bucket(const void* address) { return reinterpret_cast<uintptr_t>(address) >> 4 & (NUM_BUCKETS - 1); }
+
+	static u8* End(MemoryNode* node) { return reinterpret_cast<u8*>(node + 1) + node->size; }
+
+	static u32 FirstLevel(u32 size) { return 31 - __builtin_clz(size | 1); }
+
+	static u32 Bin(u32 size)
+	{
+		const u32 fl = FirstLevel(size);
+		const u32 sl = fl >= 2 ? size >> (fl - 2) & 3 : 0;
+
+		return fl * NUM_SECOND_LEVELS + sl;
+	}
+
+	void Clear()
+	{
+		for (u32 i = 0; i < MAX_FREE_BLOCKS; i++)
+			entries[i].nextInBin = i + 1 < MAX_FREE_BLOCKS ? i + 1 : NONE;
+
+		firstUnused = 0;
+		firstLevelBitmap = 0;
+
+		for (u16& head : binHeads) head = NONE;
+		for (u8& bitmap : secondLevelBitmaps) bitmap = 0;
+		for (u16& head : byStart) head = NONE;
+		for (u16& head : byEnd) head = NONE;
+	}
+
+	bool Add(MemoryNode* node)
+	{
+		if (firstUnused == NONE) return false;
+
+		const u16 i = firstUnused;
+		Entry& e = entries[i];
+		firstUnused = e.nextInBin;
+
+		e.node = node;
+		e.end = End(node);
+		e.bin = Bin(node->size);
+
+		e.prevInBin = NONE;
+		e.nextInBin = binHeads[e.bin];
+		if (e.nextInBin != NONE) entries[e.nextInBin].prevInBin = i;
+		binHeads[e.bin] = i;
+
+		firstLevelBitmap |= 1 << (e.bin / NUM_SECOND_LEVELS);
+		secondLevelBitmaps[e.bin / NUM_SECOND_LEVELS] |= 1 << (e.bin % NUM_SECOND_LEVELS);
+
+		e.nextByStart = byStart[Bucket(node)];
+		byStart[Bucket(node)] = i;
+		e.nextByEnd = byEnd[Bucket(e.end)];
+		byEnd[Bucket(e.end)] = i;
+
+		return true;
+	}
+
+	static void Unlink(u16* head, u16 i, u16 Entry::* next, Entry* entries)
+	{
+		while (*head != i) head = &(entries[*head].*next);
+		*head = entries[i].*next;
+	}
+
+	void Remove(u16 i)
+	{
+		Entry& e = entries[i];
+
+		if (e.prevInBin != NONE)
+			entries[e.prevInBin].nextInBin = e.nextInBin;
+		else
+			binHeads[e.bin] = e.nextInBin;
+
+		if (e.nextInBin != NONE)
+			entries[e.nextInBin].prevInBin = e.prevInBin;
+
+		if (binHeads[e.bin] == NONE)
+		{
+			u8& bitmap = secondLevelBitmaps[e.bin / NUM_SECOND_LEVELS];
+			bitmap &= ~(1 << (e.bin % NUM_SECOND_LEVELS));
+
+			if (bitmap == 0)
+				firstLevelBitmap &= ~(1 << (e.bin / NUM_SECOND_LEVELS));
+		}
+
+		Unlink(&byStart[Bucket(e.node)], i, &Entry::nextByStart, entries);
+		Unlink(&byEnd[Bucket(e.end)], i, &Entry::nextByEnd, entries);
+
+		e.nextInBin = firstUnused;
+		firstUnused = i;
+	}
+
+	u16 FindByStart(const void* address) const
+	{
+		for (u16 i = byStart[Bucket(address)]; i != NONE; i = entries[i].nextByStart)
+			if (entries[i].node == address) return i;
+
+		return NONE;
+	}
+
+	u16 FindByEnd(const void* address) const
+	{
+		for (u16 i = byEnd[Bucket(address)]; i != NONE; i = entries[i].nextByEnd)
+			if (entries[i].end == address) return i;
+
+		return NONE;
+	}
+
+	// The first entry of the first non-empty bin at or after bin
+	u16 FindFrom(u32 bin) const
+	{
+		u32 fl = bin / NUM_SECOND_LEVELS;
+		u32 slMap = secondLevelBitmaps[fl] & (~0u << (bin % NUM_SECOND_LEVELS));
+
+		if (slMap == 0)
+		{
+			const u32 flMap = fl + 1 < NUM_FIRST_LEVELS ? firstLevelBitmap & (~0u << (fl + 1)) : 0;
+			if (flMap == 0) return NONE;
+
+			fl = __builtin_ctz(flMap);
+			slMap = secondLevelBitmaps[fl];
+		}
+
+		return binHeads[fl * NUM_SECOND_LEVELS + __builtin_ctz(slMap)];
+	}
+
+	// Where the data of an allocation would go in the free block, or nullptr if it doesn't fit
+	static u8* Place(MemoryNode* node, u32 size, u32 align, bool backwards)
+	{
+		u8* const start = reinterpret_cast<u8*>(node + 1);
+		u8* const end = End(node);
+
+		if (backwards)
+		{
+			if (static_cast<u32>(end - start) < size) return nullptr;
+
+			u8* const data = reinterpret_cast<u8*>(reinterpret_cast<uintptr_t>(end - size) & ~(align - 1));
+			return data >= start ? data : nullptr;
+		}
+		else
+		{
+			u8* const data = reinterpret_cast<u8*>(reinterpret_cast<uintptr_t>(start) + align - 1 & ~(align - 1));
+			return data + size <= end ? data : nullptr;
+		}
+	}
+
+	void* Allocate(u32 size, s32 align)
+	{
+		const bool backwards = align < 0;
+		const u32 absAlign = std::max(backwards ? -align : align, 4);
+		size = (size + 3) & ~3u;
+
+		// any block in a bin after the one of size + padding fits, and some in that bin may fit too
+		const u32 maxSize = size + (absAlign > 4 ? absAlign - 4 : 0);
+		u32 bin = Bin(maxSize);
+		u16 i = binHeads[bin];
+		u8* data = nullptr;
+
+		for (; i != NONE; i = entries[i].nextInBin)
+			if ((data = Place(entries[i].node, size, absAlign, backwards))) break;
+
+		if (i == NONE)
+		{
+			if (bin + 1 == NUM_FIRST_LEVELS * NUM_SECOND_LEVELS) return nullptr;
+
+			i = FindFrom(bin + 1);
+			if (i == NONE) return nullptr;
+
+			data = Place(entries[i].node, size, absAlign, backwards);
+			if (!data) return nullptr;
+		}
+
+		ExpandingHeapAllocator& allocator = *hook.heap->allocator;
+		MemoryNode* const node = entries[i].node;
+		MemoryNode* const prevFree = node->prev;
+		MemoryNode* const nextFree = node->next;
+
+		Remove(i);
+
+		void* const res = ExpandingHeapAllocator::AllocateNode(
+			reinterpret_cast<MemoryNode*>(&allocator.firstFreeBlock), node, data, size, backwards);
+
+		// the parts of the block that are left over are the free blocks that are now in its place
+		for (MemoryNode* n = prevFree ? prevFree->next : allocator.firstFreeBlock; n != nextFree; n = n->next)
+			if (!Add(n)) valid = false;
+
+		return res;
+	}
+
+	// Has to be called before the block is freed. Merging with neighbours grows the previous
+	// free block or replaces the next one, so only those need to be updated in the index.
+	struct FreeNeighbours
+	{
+		MemoryNode::Target target;
+		u16 prev;
+		u16 next;
+	};
+
+	FreeNeighbours FindFreeNeighbours(void* ptr) const
+	{
+		MemoryNode::Target target(static_cast<MemoryNode*>(ptr) - 1);
+
+		return {target, FindByEnd(target.start), FindByStart(target.end)};
+	}
+
+	void OnFreed(const FreeNeighbours& neighbours)
+	{
+		MemoryNode* merged;
+
+		if (neighbours.prev != NONE)
+		{
+			merged = entries[neighbours.prev].node;
+			Remove(neighbours.prev);
+		}
+		else
+			merged = static_cast<MemoryNode*>(neighbours.target.start);
+
+		if (neighbours.next != NONE)
+			Remove(neighbours.next);
+
+		if (!Add(merged))
+			valid = false;
+	}
+
+	void Rebuild()
+	{
+		Clear();
+		valid = true;
+
+		for (MemoryNode* node = hook.heap->allocator->firstFreeBlock; node; node = node->next)
+		{
+			if (!Add(node))
+			{
+				valid = false;
+				return;
+			}
+		}
+	}
+
+	static SegregatedFitIndex* Find(ExpandingHeap* heap)
+	{
+		for (SegregatedFitIndex* index : installed)
+			if (index && index->hook.heap == heap) return index;
+
+		return nullptr;
+	}
+
+	static void* VAllocate(ExpandingHeap* heap, u32 size, s32 align)
+	{
+		SegregatedFitIndex* index = Find(heap);
+
+		if (!index->valid)
+			return index->hook.CallChained<void*>(HeapHook::VALLOCATE, size, align);
+
+		if (void* ptr = index->Allocate(size, align)) return ptr;
+
+		// the game's allocator may still find a block, e.g. for a big alignment, and splits it without the index
+		void* ptr = index->hook.CallChained<void*>(HeapHook::VALLOCATE, size, align);
+		if (ptr) index->Rebuild();
+
+		return ptr;
+	}
+
+	static bool VDeallocate(ExpandingHeap* heap, void* ptr)
+	{
+		SegregatedFitIndex* index = Find(heap);
+
+		if (!index->valid || !ptr)
+		{
+			const bool res = index->hook.CallChained<bool>(HeapHook::VDEALLOCATE, ptr);
+			if (res) index->Rebuild();
+
+			return res;
+		}
+
+		const FreeNeighbours neighbours = index->FindFreeNeighbours(ptr);
+		const bool res = index->hook.CallChained<bool>(HeapHook::VDEALLOCATE, ptr);
+
+		if (res) index->OnFreed(neighbours);
+
+		return res;
+	}
+
+	// rare enough to simply rebuild the index
+	static u32 VReallocate(ExpandingHeap* heap, void* ptr, u32 newSize)
+	{
+		SegregatedFitIndex* index = Find(heap);
+		const u32 res = index->hook.CallChained<u32>(HeapHook::VREALLOCATE, ptr, newSize);
+		index->Rebuild();
+
+		return res;
+	}
+
+	static void VDeallocateAll(ExpandingHeap* heap)
+	{
+		SegregatedFitIndex* index = Find(heap);
+		index->hook.CallChained<void>(HeapHook::VDEALLOCATE_ALL);
+		index->Rebuild();
+	}
+
+public:
+	SegregatedFitIndex() = default;
+	SegregatedFitIndex(const SegregatedFitIndex&) = delete;
+	SegregatedFitIndex& operator=(const SegregatedFitIndex&) = delete;
+
+	[[nodiscard]] bool IsInstalled() const { return hook.IsInstalled(); }
+
+	// Whether an index decides which free blocks the heap's allocations take
+	[[nodiscard]] static bool IsInstalledOn(ExpandingHeap& heap) { return Find(&heap) != nullptr; }
+	[[nodiscard]] bool IsValid() const { return valid; } // false while the heap has too many free blocks
+
+	// Returns false if the heap already has a hook (including an index) or MAX_HEAPS heaps have one
+	bool Install(ExpandingHeap& target)
+	{
+		if (hook.IsInstalled() || HeapHook::IsHooked(target)) return false;
+
+		SegregatedFitIndex** slot = nullptr;
+		for (SegregatedFitIndex*& s : installed)
+			if (!s) { slot = &s; break; }
+
+		if (!slot) return false;
+
+		*slot = this;
+		hook.Install(target,
+		{
+			{HeapHook::VALLOCATE,       reinterpret_cast<void*>(&VAllocate)},
+			{HeapHook::VDEALLOCATE,     reinterpret_cast<void*>(&VDeallocate)},
+			{HeapHook::VDEALLOCATE_ALL, reinterpret_cast<void*>(&VDeallocateAll)},
+			{HeapHook::VREALLOCATE,     reinterpret_cast<void*>(&VReallocate)},
+		});
+
+		Rebuild();
+		return true;
+	}
+
+	void Uninstall()
+	{
+		if (!hook.IsInstalled()) return;
+
+		hook.Uninstall();
+
+		for (SegregatedFitIndex*& s : installed)
+			if (s == this) s = nullptr;
+	}
+};
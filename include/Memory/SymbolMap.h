@@ -0,0 +1,154 @@
+#pragma once
+
+#include "../Math/MathCommon.h"
+#include <algorithm>
+#include <istream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+	INFORMATION
+	SymbolMap reads a linker script like symbols9.x on the host (it isn't included by SM64DS_PI.h)
+	and turns the raw code addresses that AllocationTracer and other in-game reports print into
+	function names:
+
+		std::ifstream file("symbols9.x");
+		SymbolMap symbols;
+		symbols.Load(file);
+
+		std::cout << symbols.Describe(0x020439c5) << '\n'; // "_ZN...+0x81 (thumb)"
+
+	Only assignments of the form "name = 0xADDRESS;" are read, anything in comments is ignored.
+	An address is attributed to the symbol with the highest address below or at it, so addresses
+	in functions without a symbol are attributed to the preceding one.
+*/
+
+class SymbolMap
+{
+public:
+	struct Symbol
+	{
+		u32 address;
+		std::string name;
+	};
+
+	struct Location
+	{
+		const Symbol* symbol; // nullptr if the address is below every symbol
+		u32 offset;
+	};
+
+private:
+	std::vector<Symbol> symbols; // sorted by address
+
+	static std::string StripComments(std::string_view text)
+	{
+		std::string res;
+		res.reserve(text.size());
+
+		for (std::size_t i = 0; i < text.size(); )
+		{
+			if (text.compare(i, 2, "/*") == 0)
+			{
+				const std::size_t end = text.find("*/", i + 2);
+				i = end == std::string_view::npos ? text.size() : end + 2;
+			}
+			else
+				res += text[i++];
+		}
+
+		return res;
+	}
+
+	static std::string_view Trim(std::string_view s)
+	{
+		const std::size_t first = s.find_first_not_of(" \t\r\n");
+		if (first == std::string_view::npos) return {};
+
+		return s.substr(first, s.find_last_not_of(" \t\r\n") - first + 1);
+	}
+
+public:
+	// Returns the number of symbols read
+	std::size_t Load(std::istream& is)
+	{
+		const std::string source{std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>()};
+		const std::string text = StripComments(source);
+		std::size_t numRead = 0;
+
+		for (std::size_t start = 0; start < text.size(); )
+		{
+			std::size_t end = text.find(';', start);
+			if (end == std::string::npos) end = text.size();
+
+			const std::string_view statement(text.data() + start, end - start);
+			start = end + 1;
+
+			const std::size_t equals = statement.find('=');
+			if (equals == std::string_view::npos) continue;
+
+			const std::string_view name = Trim(statement.substr(0, equals));
+			const std::string_view value = Trim(statement.substr(equals + 1));
+
+			// skips expressions like "__dtcm_start + 0x3ff8"
+			if (name.empty() || value.size() < 3 || value.compare(0, 2, "0x") != 0 ||
+				value.find_first_not_of("0123456789abcdefABCDEF", 2) != std::string_view::npos)
+				continue;
+
+			symbols.push_back({static_cast<u32>(std::stoul(std::string(value.substr(2)), nullptr, 16)), std::string(name)});
+			numRead++;
+		}
+
+		std::stable_sort(symbols.begin(), symbols.end(),
+			[](const Symbol& a, const Symbol& b) { return a.address < b.address; });
+
+		return numRead;
+	}
+
+	// The Thumb bit of address is ignored
+	[[nodiscard]] Location Lookup(u32 address) const
+	{
+		address &= ~1u;
+
+		const auto it = std::upper_bound(symbols.begin(), symbols.end(), address,
+			[](u32 address, const Symbol& s) { return address < s.address; });
+
+		if (it == symbols.begin()) return {nullptr, 0};
+
+		return {&*std::prev(it), address - std::prev(it)->address};
+	}
+
+	[[nodiscard]] std::string Describe(u32 address) const
+	{
+		static constexpr char digits[] = "0123456789abcdef";
+
+		const auto hex = [](u32 x)
+		{
+			std::string res = "0x";
+			bool started = false;
+
+			for (s32 shift = 28; shift >= 0; shift -= 4)
+			{
+				const u32 digit = x >> shift & 0xf;
+				if (digit != 0 || started || shift == 0)
+				{
+					res += digits[digit];
+					started = true;
+				}
+			}
+
+			return res;
+		};
+
+		const Location location = Lookup(address);
+		std::string res = location.symbol ? location.symbol->name + '+' + hex(location.offset) : hex(address);
+
+		if (address & 1) res += " (thumb)";
+
+		return res;
+	}
+
+	[[nodiscard]] std::size_t NumSymbols() const { return symbols.size(); }
+};
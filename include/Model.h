@@ -66,3 +66,5 @@ enum Command2a
 		NORMAL_SOURCE        = 0x2    << 30,
 		VERTEX_SOURCE        = 0x3    << 30,
 };
+
+#include "Model/TextureRegistry.h"
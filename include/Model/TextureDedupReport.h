@@ -0,0 +1,211 @@
+#pragma once
+
+#include "TextureHash.h"
+#include "../Formats/LZ16.h"
+#include <algorithm>
+#include <span>
+#include <string>
+#include <vector>
+
+/*
+	INFORMATION
+	Host-side report of how much VRAM TEXTURE_REGISTRY could save for a set of BMD files that are
+	loaded at the same time, e.g. the models of the objects of a level (it isn't included by
+	SM64DS_PI.h):
+
+		std::vector<TextureDedupReport::Input> files = {{"coin_yellow_poly32.bmd", data}, ...};
+		TextureDedupReport report(files);
+
+		report.textureBytes - report.uniqueTextureBytes;  // VRAM the registry saves, in bytes
+		report.groups;                                    // the duplicates and the files they are in
+
+	Files that start with "LZ77" are decompressed first. Duplicates are found by the same keys as
+	TEXTURE_REGISTRY, including those within the same file, and Tex4x4 textures are never counted
+	as duplicates; the byte counts are the sizes in the Texture and Palette entries.
+	tests/TextureDedupTest.cpp checks the report on synthetic files.
+*/
+
+class TextureDedupReport
+{
+public:
+	struct Input
+	{
+		std::string name;
+		std::span<const u8> data;
+	};
+
+	struct Use
+	{
+		u32 file;  // index in the input
+		u32 index; // of the texture or palette in the file
+		std::string name;
+	};
+
+	struct Group
+	{
+		TextureHash::Key key;
+		bool isPalette;
+		std::vector<Use> uses; // more than one
+	};
+
+	struct File
+	{
+		std::string name;
+		bool valid = false;
+		u32 textureBytes = 0;
+		u32 paletteBytes = 0;
+		u32 sharedTextureBytes = 0; // of the textures that use the slot of an earlier file or texture
+		u32 sharedPaletteBytes = 0;
+	};
+
+	std::vector<File> files;
+	std::vector<Group> groups; // the textures first, the most bytes saved first
+	u64 textureBytes = 0;
+	u64 uniqueTextureBytes = 0;
+	u64 paletteBytes = 0;
+	u64 uniquePaletteBytes = 0;
+
+private:
+	struct Item
+	{
+		TextureHash::Key key;
+		bool isPalette;
+		Use use;
+	};
+
+	static u32 ReadU32(std::span<const u8> data, u32 offset)
+	{
+		return data[offset] | data[offset + 1] << 8 | data[offset + 2] << 16 | static_cast<u32>(data[offset + 3]) << 24;
+	}
+
+	static std::string ReadName(std::span<const u8> data, u32 offset)
+	{
+		std::string res;
+
+		for (u32 i = offset; i < data.size() && data[i] != '\0'; i++)
+			res.push_back(data[i]);
+
+		return res;
+	}
+
+	// The header is BMD_File with file offsets instead of pointers, as before InitPointers
+	static bool ReadItems(std::span<const u8> bmd, u32 fileIndex, std::vector<Item>& res)
+	{
+		if (bmd.size() < 0x3c) return false;
+
+		const u32 numTextures = ReadU32(bmd, 0x14);
+		const u32 textures = ReadU32(bmd, 0x18);
+		const u32 numPalettes = ReadU32(bmd, 0x1c);
+		const u32 palettes = ReadU32(bmd, 0x20);
+
+		if (textures + 0x14ull * numTextures > bmd.size() || palettes + 0x10ull * numPalettes > bmd.size())
+			return false;
+
+		for (u32 i = 0; i < numTextures; i++)
+		{
+			const u32 entry = textures + 0x14 * i;
+			const u32 data = ReadU32(bmd, entry + 0x4);
+			const u32 size = ReadU32(bmd, entry + 0x8);
+
+			if (data + static_cast<u64>(size) > bmd.size()) return false;
+
+			res.push_back({TextureHash::TextureKey(bmd.data() + data, size, ReadU32(bmd, entry + 0x10)), false,
+				{fileIndex, i, ReadName(bmd, ReadU32(bmd, entry))}});
+		}
+
+		for (u32 i = 0; i < numPalettes; i++)
+		{
+			const u32 entry = palettes + 0x10 * i;
+			const u32 data = ReadU32(bmd, entry + 0x4);
+			const u32 size = ReadU32(bmd, entry + 0x8);
+
+			if (data + static_cast<u64>(size) > bmd.size()) return false;
+
+			res.push_back({TextureHash::PaletteKey(bmd.data() + data, size), true,
+				{fileIndex, i, ReadName(bmd, ReadU32(bmd, entry))}});
+		}
+
+		return true;
+	}
+
+	static bool Less(const Item& a, const Item& b)
+	{
+		if (a.isPalette != b.isPalette) return b.isPalette;
+		if (a.key.hash != b.key.hash) return a.key.hash < b.key.hash;
+		if (a.key.size != b.key.size) return a.key.size < b.key.size;
+		if (a.key.params != b.key.params) return a.key.params < b.key.params;
+		if (a.use.file != b.use.file) return a.use.file < b.use.file;
+		return a.use.index < b.use.index;
+	}
+
+public:
+	explicit TextureDedupReport(std::span<const Input> inputs)
+	{
+		std::vector<Item> items;
+
+		for (u32 i = 0; i < inputs.size(); i++)
+		{
+			files.push_back({inputs[i].name});
+
+			std::span<const u8> data = inputs[i].data;
+			std::vector<u8> decompressed;
+
+			if (data.size() >= 8 && data[0] == 'L' && data[1] == 'Z' && data[2] == '7' && data[3] == '7' && LZ16::IsCompressed(data.data()))
+			{
+				decompressed.resize(LZ16::DecompressedSize(data.data()));
+				LZ16::Decompress(data.data(), decompressed.data());
+				data = decompressed;
+			}
+
+			const u32 numItems = items.size();
+			files[i].valid = ReadItems(data, i, items);
+
+			if (!files[i].valid)
+				items.resize(numItems);
+		}
+
+		// in the order the files are given, so the first use of a key is the one that's uploaded
+		std::sort(items.begin(), items.end(), Less);
+
+		for (u32 start = 0, end; start < items.size(); start = end)
+		{
+			const Item& first = items[start];
+			const bool shareable = first.isPalette || TextureHash::IsShareable(first.key.params);
+			end = start + 1;
+
+			while (shareable && end < items.size() && items[end].isPalette == first.isPalette && items[end].key == first.key)
+				end++;
+
+			for (u32 i = start; i < end; i++)
+			{
+				File& file = files[items[i].use.file];
+				const u32 size = items[i].key.size;
+
+				(first.isPalette ? file.paletteBytes : file.textureBytes) += size;
+				(first.isPalette ? paletteBytes : textureBytes) += size;
+
+				if (i != start && size != 0)
+					(first.isPalette ? file.sharedPaletteBytes : file.sharedTextureBytes) += size;
+			}
+
+			(first.isPalette ? uniquePaletteBytes : uniqueTextureBytes) += first.key.size;
+
+			if (end - start > 1 && first.key.size != 0)
+			{
+				Group& group = groups.emplace_back(first.key, first.isPalette);
+
+				for (u32 i = start; i < end; i++)
+					group.uses.push_back(items[i].use);
+			}
+		}
+
+		std::stable_sort(groups.begin(), groups.end(), [](const Group& a, const Group& b)
+		{
+			if (a.isPalette != b.isPalette) return b.isPalette;
+			return static_cast<u64>(a.key.size) * (a.uses.size() - 1) > static_cast<u64>(b.key.size) * (b.uses.size() - 1);
+		});
+	}
+
+	[[nodiscard]] u64 TextureBytesSaved() const { return textureBytes - uniqueTextureBytes; }
+	[[nodiscard]] u64 PaletteBytesSaved() const { return paletteBytes - uniquePaletteBytes; }
+};
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "../Math/MathCommon.h"
+
+/*
+	INFORMATION
+	The content keys of TEXTURE_REGISTRY (Model/TextureRegistry.h), shared with the host-side report
+	in Model/TextureDedupReport.h so that both find the same duplicates. Two textures can share their
+	VRAM if their data is the same and so are their format and dimensions; the other bits of
+	cmd2aPart1 (repeat, flip, color 0 mode) are sent with every texture and can differ. Palettes only
+	need the same data.
+
+	Tex4x4 textures are never shared. Their palette indices are in texture slot 1, at an address that
+	follows from the VRAM offset of the texels, and AddToArrayAndLoadTexAndPal uploads them from the
+	texture data; nothing shows that it skips them for a texture with a size of 0, so sharing the
+	texels could leave the indices of the sharing texture unloaded or overwrite those of another one.
+
+	The data can't be compared after it was loaded, since ShrinkAllocation cuts it off, so the key
+	has a 64-bit hash made of two independent 32-bit hashes of the words of the data.
+*/
+
+namespace TextureHash
+{
+	// S_SIZE | T_SIZE | FORMAT of Command2a
+	static constexpr u32 PARAMS_MASK = 0x1ff << 20;
+	static constexpr u32 FORMAT_MASK = 0x7 << 26;
+	static constexpr u32 TEXEL_4x4 = 0x5 << 26;
+
+	// Whether a texture with these parameters (cmd2aPart1, or the params of its key) can be shared
+	constexpr bool IsShareable(u32 params) { return (params & FORMAT_MASK) != TEXEL_4x4; }
+
+	struct Key
+	{
+		u64 hash;
+		u32 size;
+		u32 params; // cmd2aPart1 & PARAMS_MASK, 0 for palettes
+
+		friend constexpr bool operator==(const Key&, const Key&) = default;
+	};
+
+	namespace Internal
+	{
+		using AliasedU32 [[gnu::may_alias]] = u32;
+
+		constexpr u32 Rotl(u32 x, u32 shift) { return x << shift | x >> (32 - shift); }
+
+		// The finalizer of MurmurHash3
+		constexpr u32 Mix(u32 h)
+		{
+			h ^= h >> 16;
+			h *= 0x85ebca6b;
+			h ^= h >> 13;
+			h *= 0xc2b2ae35;
+			h ^= h >> 16;
+
+			return h;
+		}
+	}
+
+	inline u64 Hash(const void* data, u32 size)
+	{
+		using namespace Internal;
+
+		const u8* bytes = static_cast<const u8*>(data);
+		u32 a = 0x9e3779b9 ^ size;
+		u32 b = 0x7f4a7c15 + size;
+		u32 i = 0;
+
+		const auto add = [&](u32 word)
+		{
+			a = Rotl(a ^ word, 13) * 0x9e3779b1;
+			b = Rotl(b + word, 17) * 0xcc9e2d51 + 0x1b873593;
+		};
+
+		if ((reinterpret_cast<uintptr_t>(bytes) & 3) == 0)
+		{
+			for (; i + 4 <= size; i += 4)
+				add(*reinterpret_cast<const AliasedU32*>(bytes + i));
+		}
+		else
+		{
+			for (; i + 4 <= size; i += 4)
+				add(bytes[i] | bytes[i + 1] << 8 | bytes[i + 2] << 16 | static_cast<u32>(bytes[i + 3]) << 24);
+		}
+
+		if (i < size)
+		{
+			u32 tail = 0;
+
+			for (u32 shift = 0; i < size; i++, shift += 8)
+				tail |= static_cast<u32>(bytes[i]) << shift;
+
+			add(tail);
+		}
+
+		return static_cast<u64>(Mix(a)) << 32 | Mix(b ^ a);
+	}
+
+	inline Key TextureKey(const void* data, u32 size, u32 cmd2aPart1)
+	{
+		return {Hash(data, size), size, cmd2aPart1 & PARAMS_MASK};
+	}
+
+	inline Key PaletteKey(const void* data, u32 size)
+	{
+		return {Hash(data, size), size, 0};
+	}
+}
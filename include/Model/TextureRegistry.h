@@ -0,0 +1,285 @@
+#pragma once
+
+#include "TextureHash.h"
+#include "../Formats/BMD_File.h"
+
+/*
+	INFORMATION
+	AddToArrayAndLoadTexAndPal uploads every texture and palette of a model to VRAM, even if another
+	model that is loaded already uploaded the same data, like the coins, stars and doors that several
+	models of COIN_*_MODEL_PTR and DOOR_*_MODEL_PTR have in common. TEXTURE_REGISTRY remembers the
+	VRAM slot of every texture and palette that was uploaded by its key (see TextureHash.h), and lets
+	the textures and palettes of later models with the same key use that slot instead:
+
+		// instead of file.AddToArrayAndLoadTexAndPal(), e.g. at its call in SharedFilePtr::LoadBMD
+		CommonModelData* data = TEXTURE_REGISTRY.LoadTexAndPal(file);
+
+		// after every call to CleanCommonModelDataArr
+		TEXTURE_REGISTRY.Sync();
+
+	Before the upload, the textures and palettes that have a slot already get a size of 0, so that
+	they take no VRAM. After it, their sizes are restored and the VRAM offsets of their slots are put
+	into cmd2aPart1 and vramOffset; their own flags (repeat, flip, color 0 mode) stay the same. A
+	texture that is the same as an earlier one of the same model shares its slot as well. Tex4x4
+	textures are always uploaded (see TextureHash.h).
+
+	A slot is counted once for every texture or palette of the files in commonModelDataArr that
+	uses it. Sync counts them again, and forgets the slots that nothing uses anymore, so that a
+	later model with the same data uploads it again instead of using VRAM that may have been reused.
+	Clear forgets all of them, e.g. when InitialiseVramGlobals resets the VRAM allocation.
+
+	Only the first MAX_PER_FILE textures and palettes of a model are looked up, the others are
+	uploaded as usual. Slots that don't fit into the registry aren't shared.
+*/
+
+class TextureRegistry
+{
+public:
+	static constexpr u32 MAX_TEXTURES = 192;
+	static constexpr u32 MAX_PALETTES = 96;
+	static constexpr u32 MAX_PER_FILE = 64;
+
+	struct Stats
+	{
+		u32 numShared;          // textures and palettes that used an existing slot
+		u32 textureBytesSaved;
+		u32 paletteBytesSaved;
+		u32 numNotRegistered;   // uploads that didn't fit into the registry
+	};
+
+private:
+	static constexpr u16 NONE = 0xffff;
+	static constexpr u16 SAME_FILE = 0x8000; // | the index of the texture or palette in the same file
+
+	struct Slot
+	{
+		TextureHash::Key key;
+		u32 vramOffset; // Command2a::VRAM_OFFSET_DIV_8 for textures, Palette::vramOffset for palettes
+		u16 numRefs;
+	};
+
+	// The texture or palette of the file while it's loaded
+	struct Pending
+	{
+		TextureHash::Key key;
+		u16 source; // the slot, SAME_FILE | index, or NONE if it's uploaded
+	};
+
+	struct Table
+	{
+		Slot* slots;
+		u32& numSlots;
+		u32 capacity;
+		Pending* pending;
+	};
+
+	Slot textureSlots[MAX_TEXTURES] = {};
+	Slot paletteSlots[MAX_PALETTES] = {};
+	u32 numTextureSlots = 0;
+	u32 numPaletteSlots = 0;
+
+	Pending pendingTextures[MAX_PER_FILE] = {};
+	Pending pendingPalettes[MAX_PER_FILE] = {};
+
+	Table Textures() { return {textureSlots, numTextureSlots, MAX_TEXTURES, pendingTextures}; }
+	Table Palettes() { return {paletteSlots, numPaletteSlots, MAX_PALETTES, pendingPalettes}; }
+
+	static u16 FindSlot(const Table& table, const TextureHash::Key& key)
+	{
+		for (u32 i = 0; i < table.numSlots; i++)
+			if (table.slots[i].key == key) return i;
+
+		return NONE;
+	}
+
+	// Returns where the data of the index-th texture or palette can be found
+	static u16 FindSource(const Table& table, u32 index)
+	{
+		const TextureHash::Key& key = table.pending[index].key;
+
+		if (key.size == 0) return NONE;
+
+		if (const u16 slot = FindSlot(table, key); slot != NONE)
+			return slot;
+
+		for (u32 i = 0; i < index; i++)
+			if (table.pending[i].key == key) return SAME_FILE | i;
+
+		return NONE;
+	}
+
+	static u32 NumLookedUp(u32 num) { return num < MAX_PER_FILE ? num : MAX_PER_FILE; }
+
+	// Returns the VRAM offset of the source, registers the uploaded ones
+	u32 Resolve(const Table& table, u32 index, u32 uploadedOffset, const u32* offsetsInFile)
+	{
+		const Pending& pending = table.pending[index];
+
+		if (pending.source == NONE)
+		{
+			if (pending.key.size == 0) return uploadedOffset;
+
+			if (table.numSlots == table.capacity)
+				stats.numNotRegistered++;
+			else
+				table.slots[table.numSlots++] = {pending.key, uploadedOffset, 1};
+
+			return uploadedOffset;
+		}
+
+		stats.numShared++;
+
+		if (pending.source & SAME_FILE)
+			return offsetsInFile[pending.source & ~SAME_FILE];
+
+		table.slots[pending.source].numRefs++;
+		return table.slots[pending.source].vramOffset;
+	}
+
+	static void Forget(Table table)
+	{
+		u32 numKept = 0;
+
+		for (u32 i = 0; i < table.numSlots; i++)
+			if (table.slots[i].numRefs != 0) table.slots[numKept++] = table.slots[i];
+
+		table.numSlots = numKept;
+	}
+
+public:
+	Stats stats = {};
+
+	// Gives the textures and palettes that can share a slot a size of 0
+	void Prepare(BMD_File& file)
+	{
+		const Table textures = Textures();
+		const Table palettes = Palettes();
+
+		for (u32 i = 0; i < NumLookedUp(file.numTextures); i++)
+		{
+			BMD_File::Texture& texture = file.textures[i];
+
+			pendingTextures[i].key = TextureHash::TextureKey(texture.data, texture.size, texture.cmd2aPart1);
+
+			// a key with a size of 0 is neither shared nor registered
+			if (!TextureHash::IsShareable(texture.cmd2aPart1))
+				pendingTextures[i].key.size = 0;
+
+			pendingTextures[i].source = FindSource(textures, i);
+
+			if (pendingTextures[i].source != NONE) texture.size = 0;
+		}
+
+		for (u32 i = 0; i < NumLookedUp(file.numPalettes); i++)
+		{
+			BMD_File::Palette& palette = file.palettes[i];
+
+			pendingPalettes[i].key = TextureHash::PaletteKey(palette.data, palette.size);
+			pendingPalettes[i].source = FindSource(palettes, i);
+
+			if (pendingPalettes[i].source != NONE) palette.size = 0;
+		}
+	}
+
+	// Restores the sizes after the upload and points the shared ones to their slots
+	void Commit(BMD_File& file)
+	{
+		u32 offsets[MAX_PER_FILE];
+
+		for (u32 i = 0; i < NumLookedUp(file.numTextures); i++)
+		{
+			BMD_File::Texture& texture = file.textures[i];
+
+			offsets[i] = Resolve(Textures(), i, texture.cmd2aPart1 & Command2a::VRAM_OFFSET_DIV_8, offsets);
+
+			if (pendingTextures[i].source != NONE)
+			{
+				texture.size = pendingTextures[i].key.size;
+				texture.cmd2aPart1 = (texture.cmd2aPart1 & ~Command2a::VRAM_OFFSET_DIV_8) | offsets[i];
+				stats.textureBytesSaved += texture.size;
+			}
+		}
+
+		for (u32 i = 0; i < NumLookedUp(file.numPalettes); i++)
+		{
+			BMD_File::Palette& palette = file.palettes[i];
+
+			offsets[i] = Resolve(Palettes(), i, palette.vramOffset, offsets);
+
+			if (pendingPalettes[i].source != NONE)
+			{
+				palette.size = pendingPalettes[i].key.size;
+				palette.vramOffset = offsets[i];
+				stats.paletteBytesSaved += palette.size;
+			}
+		}
+	}
+
+	CommonModelData* LoadTexAndPal(BMD_File& file)
+	{
+		Prepare(file);
+		CommonModelData* res = file.AddToArrayAndLoadTexAndPal();
+		Commit(file);
+
+		return res;
+	}
+
+	// Counts the uses of every slot by the files in commonModelDataArr and forgets the unused ones
+	void Sync()
+	{
+		for (u32 i = 0; i < numTextureSlots; i++) textureSlots[i].numRefs = 0;
+		for (u32 i = 0; i < numPaletteSlots; i++) paletteSlots[i].numRefs = 0;
+
+		for (u32 i = 0; i < numCommonModelData; i++)
+		{
+			const BMD_File* file = commonModelDataArr[i].file;
+			if (!file) continue;
+
+			for (u32 j = 0; j < file->numTextures; j++)
+			{
+				const BMD_File::Texture& texture = file->textures[j];
+
+				for (u32 k = 0; k < numTextureSlots; k++)
+				{
+					Slot& slot = textureSlots[k];
+
+					if (slot.vramOffset == (texture.cmd2aPart1 & Command2a::VRAM_OFFSET_DIV_8) &&
+						slot.key.params == (texture.cmd2aPart1 & TextureHash::PARAMS_MASK) && slot.key.size == texture.size)
+					{
+						slot.numRefs++;
+					}
+				}
+			}
+
+			for (u32 j = 0; j < file->numPalettes; j++)
+			{
+				const BMD_File::Palette& palette = file->palettes[j];
+
+				for (u32 k = 0; k < numPaletteSlots; k++)
+					if (paletteSlots[k].vramOffset == palette.vramOffset && paletteSlots[k].key.size == palette.size)
+						paletteSlots[k].numRefs++;
+			}
+		}
+
+		Forget(Textures());
+		Forget(Palettes());
+	}
+
+	void Clear()
+	{
+		numTextureSlots = 0;
+		numPaletteSlots = 0;
+	}
+
+	[[nodiscard]] u32 NumTextureSlots() const { return numTextureSlots; }
+	[[nodiscard]] u32 NumPaletteSlots() const { return numPaletteSlots; }
+
+	void Dump(const ostream& os) const
+	{
+		os << "texture registry: " << numTextureSlots << " texture slots, " << numPaletteSlots << " palette slots, "
+		   << stats.numShared << " shared, " << stats.textureBytesSaved << " texture bytes and "
+		   << stats.paletteBytesSaved << " palette bytes saved\n";
+	}
+};
+
+inline constinit TextureRegistry TEXTURE_REGISTRY;
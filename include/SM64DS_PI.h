@@ -3,7 +3,9 @@
 #include "Math.h"
 #include "Formats.h"
 #include "SharedFilePtr.h"
+#include "FileSystem.h"
 #include "NDSCore.h"
+#include "Math/MathPipeline.h"
 #include "Model.h"
 #include "Collision.h"
 #include "PathPtr.h"
@@ -591,4 +593,7 @@ extern "C"
 inline void BREAK()
 {
 	asm("mov r11, r11");
-}
\ No newline at end of file
+}
+
+#include "Memory/FileCompaction.h" // needs SharedFilePtr, the formats and the models
+#include "Memory/FileCache.h"      // needs SharedFilePtr
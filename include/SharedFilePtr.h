@@ -45,6 +45,15 @@ struct SharedFilePtr
 	BTP_File& LoadBTP();
 	KCL_File& LoadKCL();
 
+	// The Load function that FILE_PREFETCHER uses for a file
+	enum class Kind : u8 { RAW, BMD, BCA, BTP, KCL };
+
+	// Queues the file to be loaded by FILE_PREFETCHER in a later frame, which then holds a reference
+	// until FILE_PREFETCHER.ReleaseAll() (see SharedFilePtr/Prefetcher.h)
+	void Prefetch(Kind kind = Kind::RAW);
+
+	[[nodiscard]] bool IsReady() const { return filePtr != nullptr; } // whether Load wouldn't read the card
+
 	[[gnu::always_inline]] BMD_File*  BMD () const { return reinterpret_cast<BMD_File*> (filePtr); }
 	[[gnu::always_inline]] BCA_File*  BCA () const { return reinterpret_cast<BCA_File*> (filePtr); }
 	[[gnu::always_inline]] BMA_File*  BMA () const { return reinterpret_cast<BMA_File*> (filePtr); }
@@ -107,3 +116,5 @@ extern SharedFilePtr DOOR_STAR_8_MODEL_PTR;
 extern SharedFilePtr DOOR_KEY_HOLE_MODEL_PTR;
 
 extern SharedFilePtr STAR_DOOR_MODEL_PTR;
+
+#include "SharedFilePtr/Prefetcher.h"
@@ -0,0 +1,226 @@
+#pragma once
+
+#include "PrefetchQueue.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+	INFORMATION
+	Runs the queue of FILE_PREFETCHER (PrefetchQueue) on the host (this isn't included by SM64DS_PI.h),
+	for finding out how much prefetching helps before trying it on hardware. The files are read from
+	a directory, e.g. the data directory of an extracted ROM, so the paths are the ones in FileList.h:
+
+		DirectoryFileSource source("extracted/data");
+		PrefetchBenchmark::Result withPrefetch = PrefetchBenchmark::Run(source, spawns, prefetched, settings);
+		PrefetchBenchmark::Result without      = PrefetchBenchmark::Run(source, spawns, {}, settings);
+
+	Card reads are modelled as a fixed cost per file plus a cost per byte, see CardTiming.
+	DirectoryFileSource::Read can sleep for that long, for testing code that runs in real time.
+*/
+
+struct CardTiming
+{
+	float msPerFile = 1.0f;     // command setup, FAT lookup and the first sector; rough, measure on hardware
+	float bytesPerMs = 4000.f;  // sustained reads through LoadFile
+
+	[[nodiscard]] float Cost(u32 size) const { return msPerFile + size / bytesPerMs; }
+};
+
+class DirectoryFileSource
+{
+	std::filesystem::path root;
+
+public:
+	CardTiming timing;
+	bool simulateLatency = false; // make Read sleep for the time the card would take
+
+	explicit DirectoryFileSource(std::filesystem::path root, CardTiming timing = {}):
+		root(std::move(root)),
+		timing(timing)
+	{}
+
+	// 0 if the file doesn't exist
+	[[nodiscard]] u32 Size(const std::string& path) const
+	{
+		std::error_code error;
+		const auto size = std::filesystem::file_size(root / path, error);
+
+		return error ? 0 : static_cast<u32>(size);
+	}
+
+	// Returns an empty vector if the file doesn't exist
+	[[nodiscard]] std::vector<u8> Read(const std::string& path) const
+	{
+		std::ifstream file(root / path, std::ios::binary);
+		if (!file) return {};
+
+		std::vector<u8> res{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+
+		if (simulateLatency)
+			std::this_thread::sleep_for(std::chrono::duration<float, std::milli>(timing.Cost(res.size())));
+
+		return res;
+	}
+};
+
+// Stands in for SharedFilePtr on the host: Load reads the file from a DirectoryFileSource the first
+// time it's referenced and adds the card time of the read to *loadMs
+class HostFile
+{
+	const DirectoryFileSource* source;
+	std::string path;
+	std::vector<u8> data;
+	float* loadMs;
+
+public:
+	enum class Kind : u8 { RAW, BMD, BCA, BTP, KCL }; // like SharedFilePtr::Kind
+
+	u8 numRefs = 0;
+	u32 numReads = 0;
+
+	HostFile(const DirectoryFileSource& source, std::string path, float& loadMs):
+		source(&source),
+		path(std::move(path)),
+		loadMs(&loadMs)
+	{}
+
+	// Loads the file if numRefs == 0, and increments it unless loading failed
+	char* Load()
+	{
+		if (numRefs == 0)
+		{
+			data = source->Read(path);
+			numReads++;
+			*loadMs += source->timing.Cost(data.size());
+
+			if (data.empty()) return nullptr;
+		}
+
+		numRefs++;
+		return reinterpret_cast<char*>(data.data());
+	}
+
+	char* LoadBMD() { return Load(); }
+	char* LoadBCA() { return Load(); }
+	char* LoadBTP() { return Load(); }
+	char* LoadKCL() { return Load(); }
+
+	void Release()
+	{
+		if (numRefs != 0 && --numRefs == 0)
+			data = {};
+	}
+
+	[[nodiscard]] bool IsReady() const { return !data.empty(); }
+	[[nodiscard]] const std::string& Path() const { return path; }
+};
+
+namespace PrefetchBenchmark
+{
+	struct Spawn
+	{
+		u32 frame; // relative to the end of the fade
+		std::string path;
+	};
+
+	struct Settings
+	{
+		u32 fadeFrames = 30;        // frames before the first spawn in which the prefetcher can run
+		u32 filesPerFrame = 1;      // the maxFiles of FilePrefetcher::Update
+		float frameBudgetMs = 4.f;  // time left in a gameplay frame before a load causes a visible stall
+	};
+
+	struct Result
+	{
+		float totalLoadMs = 0;    // in gameplay frames
+		float totalStallMs = 0;   // the part of totalLoadMs over the frame budget
+		float maxStallMs = 0;
+		u32 numStalledFrames = 0;
+		u32 numSpawnLoads = 0;    // spawns that had to read their file themselves
+		u32 numReads = 0;         // files read in total, a file is read again if it was unloaded meanwhile
+		PrefetchQueue<HostFile>::Stats prefetcher = {};
+		bool balanced = true;     // every reference was released at the end
+	};
+
+	// Runs the frames from the start of the fade to the last spawn with the queue of FILE_PREFETCHER.
+	// prefetched is queued when the fade starts. Every frame, Update(filesPerFrame) is called, then
+	// the spawns of that frame load their files (taking a reference until the end, like an actor that
+	// stays alive). Load times in fade frames are free. At the end, everything is released.
+	inline Result Run(const DirectoryFileSource& source, std::span<const Spawn> spawns,
+		std::span<const std::string> prefetched, const Settings& settings)
+	{
+		std::vector<Spawn> sorted(spawns.begin(), spawns.end());
+		std::stable_sort(sorted.begin(), sorted.end(), [](const Spawn& a, const Spawn& b) { return a.frame < b.frame; });
+
+		const u32 lastFrame = sorted.empty() ? 0 : settings.fadeFrames + sorted.back().frame;
+
+		Result res;
+		float loadMs = 0;
+
+		// one handle per path, like one SharedFilePtr per file
+		std::vector<std::unique_ptr<HostFile>> files;
+		auto find = [&](const std::string& path) -> HostFile&
+		{
+			for (const auto& file : files)
+				if (file->Path() == path) return *file;
+
+			return *files.emplace_back(std::make_unique<HostFile>(source, path, loadMs));
+		};
+
+		PrefetchQueue<HostFile> prefetcher;
+
+		for (const std::string& path : prefetched)
+			prefetcher.Prefetch(find(path));
+
+		std::vector<HostFile*> spawned;
+		std::size_t nextSpawn = 0;
+
+		for (u32 frame = 0; frame <= lastFrame; frame++)
+		{
+			loadMs = 0;
+			prefetcher.Update(settings.filesPerFrame);
+
+			for (; nextSpawn < sorted.size() && settings.fadeFrames + sorted[nextSpawn].frame == frame; nextSpawn++)
+			{
+				HostFile& file = find(sorted[nextSpawn].path);
+
+				if (!file.IsReady()) res.numSpawnLoads++;
+				if (file.Load()) spawned.push_back(&file);
+			}
+
+			if (frame < settings.fadeFrames) continue;
+
+			res.totalLoadMs += loadMs;
+
+			if (loadMs > settings.frameBudgetMs)
+			{
+				const float stall = loadMs - settings.frameBudgetMs;
+
+				res.totalStallMs += stall;
+				res.maxStallMs = std::max(res.maxStallMs, stall);
+				res.numStalledFrames++;
+			}
+		}
+
+		res.prefetcher = prefetcher.stats;
+		prefetcher.ReleaseAll();
+
+		for (HostFile* file : spawned)
+			file->Release();
+
+		for (const auto& file : files)
+		{
+			res.numReads += file->numReads;
+			res.balanced &= file->numRefs == 0;
+		}
+
+		return res;
+	}
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include "../Math/MathCommon.h"
+#include <span>
+#include <utility>
+
+/*
+	INFORMATION
+	The queue behind FILE_PREFETCHER (see Prefetcher.h). It's a template of the file handle, which is
+	SharedFilePtr in game, so that PrefetchModel.h can run the same queue on the host with files that
+	are read from a directory. File needs what the queue uses of SharedFilePtr: Kind, Load, LoadBMD,
+	LoadBCA, LoadBTP, LoadKCL, Release and IsReady.
+*/
+
+template<class File>
+class PrefetchQueue
+{
+public:
+	using Kind = typename File::Kind;
+
+	static constexpr u32 CAPACITY = 64;
+
+	struct Stats
+	{
+		u16 numLoaded;        // files loaded by the prefetcher
+		u16 numAlreadyLoaded; // files that were already loaded when they were queued
+		u16 numLoadedBySpawn; // files that were loaded by someone else before the prefetcher got to them
+		u16 numDropped;       // because the queue was full
+	};
+
+private:
+	struct Entry
+	{
+		File* file;
+		Kind kind;
+		bool loaded; // the prefetcher holds a reference
+	};
+
+	Entry entries[CAPACITY] = {};
+	u16 numEntries = 0;
+	u16 nextToLoad = 0; // entries before this one have been loaded
+
+	static void Load(File& file, Kind kind)
+	{
+		switch (kind)
+		{
+			case Kind::BMD: file.LoadBMD(); break;
+			case Kind::BCA: file.LoadBCA(); break;
+			case Kind::BTP: file.LoadBTP(); break;
+			case Kind::KCL: file.LoadKCL(); break;
+			default:        file.Load();    break;
+		}
+	}
+
+public:
+	Stats stats = {};
+
+	// Returns false if the queue is full. Files that are already queued are ignored,
+	// files that are already loaded are referenced right away.
+	bool Prefetch(File& file, Kind kind = Kind::RAW)
+	{
+		for (u32 i = 0; i < numEntries; i++)
+			if (entries[i].file == &file) return true;
+
+		if (numEntries == CAPACITY)
+		{
+			stats.numDropped++;
+			return false;
+		}
+
+		Entry& entry = entries[numEntries++];
+		entry = {&file, kind, false};
+
+		// a loaded file costs nothing to reference, so it's taken out of the queue right away
+		if (file.IsReady())
+		{
+			Load(file, kind);
+			entry.loaded = true;
+			stats.numAlreadyLoaded++;
+
+			std::swap(entry, entries[nextToLoad++]);
+		}
+
+		return true;
+	}
+
+	bool Prefetch(std::span<File* const> files, Kind kind = Kind::RAW)
+	{
+		for (File* file : files)
+			if (!Prefetch(*file, kind)) return false;
+
+		return true;
+	}
+
+	// Loads up to maxFiles queued files, returns the number of files that are still queued
+	u32 Update(u32 maxFiles = 1)
+	{
+		for (; maxFiles > 0 && nextToLoad < numEntries; nextToLoad++)
+		{
+			Entry& entry = entries[nextToLoad];
+
+			if (!entry.file->IsReady())
+			{
+				stats.numLoaded++;
+				maxFiles--;
+			}
+			else
+			{
+				// loaded meanwhile by a spawn, so loading it now only adds a reference
+				stats.numLoadedBySpawn++;
+			}
+
+			Load(*entry.file, entry.kind);
+			entry.loaded = entry.file->IsReady(); // no reference is taken if loading failed
+		}
+
+		return numEntries - nextToLoad;
+	}
+
+	[[nodiscard]] bool IsDone() const { return nextToLoad == numEntries; }
+	[[nodiscard]] u32 NumQueued() const { return numEntries - nextToLoad; }
+
+	// Drops the files that haven't been loaded yet
+	void CancelPending()
+	{
+		numEntries = nextToLoad;
+	}
+
+	// Releases the references of the prefetcher and empties the queue
+	void ReleaseAll()
+	{
+		for (u32 i = 0; i < numEntries; i++)
+			if (entries[i].loaded) entries[i].file->Release();
+
+		numEntries = 0;
+		nextToLoad = 0;
+	}
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "PrefetchQueue.h"
+
+/*
+	INFORMATION
+	SharedFilePtr::Load reads a file from the card the first time it's referenced, so spawning an actor
+	whose model isn't loaded yet stalls the frame. FILE_PREFETCHER loads queued files ahead of time, a
+	few per frame, so that the loads happen while nothing is on screen (e.g. during a fade) or are
+	spread over several frames instead of piling up in the frame of a spawn:
+
+		// e.g. in the level overlay, when the level starts fading in
+		static SharedFilePtr* const files[] = {&GOOMBA_MODEL_PTR, &GOOMBA_ANIM_PTR, ...};
+		FILE_PREFETCHER.Prefetch(files, SharedFilePtr::Kind::BMD);
+
+		// once per frame, e.g. in a hook of the scene's behavior
+		FILE_PREFETCHER.Update();
+
+		// when the level ends, or when every actor that uses the files has been spawned
+		FILE_PREFETCHER.ReleaseAll();
+
+	Each prefetched file is loaded with the Load function of its kind (LoadBMD, LoadBCA, ...), which
+	counts as one reference. So numRefs works as usual: actors that spawn later take their own
+	references with the same Load function, and the file stays loaded until they and the prefetcher
+	have released it. Since LoadBMD only sets up a BMD_File if it's the first reference, a model must
+	be prefetched as Kind::BMD and not as Kind::RAW.
+
+	PrefetchBenchmark (see PrefetchModel.h) runs the same queue on the host, on files read from an
+	extracted ROM, to find out how much it helps before trying it on hardware.
+*/
+
+using FilePrefetcher = PrefetchQueue<SharedFilePtr>;
+
+inline constinit FilePrefetcher FILE_PREFETCHER;
+
+inline void SharedFilePtr::Prefetch(Kind kind)
+{
+	FILE_PREFETCHER.Prefetch(*this, kind);
+}
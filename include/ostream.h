@@ -69,7 +69,7 @@ public:
 		return *this;
 	}
 
-	const ostream& operator<<(uint64_t val) const
+	const ostream& operator<<(unsigned long long val) const
 	{
 		set_buffer("0x%r1%%r0%");
 		flush(val);
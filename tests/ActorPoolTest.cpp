@@ -0,0 +1,207 @@
+#include "Memory/HeapModel.h"
+#include "Benchmark.h"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// PoolAllocated on a HeapModel standing in for the game heap: the block must stay where it is while
+// the pool is in use, only Release may give it back, and whatever the pool can't hold must go to
+// Base::operator new. The benchmark spawns and destroys a wave of actors on a heap that already has
+// holes, once from the pool and once from the heap.
+
+namespace ActorPoolTest
+{
+	alignas(16) u8 memory[0x20000];
+	HeapModel heap(sizeof(memory));
+}
+
+struct Heap;
+
+namespace Memory
+{
+	Heap* gameHeapPtr = nullptr;
+
+	void* Allocate(u32 size, s32 align, Heap*)
+	{
+		const u32 data = ActorPoolTest::heap.Allocate(size, align);
+		return data ? ActorPoolTest::memory + data : nullptr;
+	}
+
+	void Deallocate(void* ptr, Heap*)
+	{
+		if (ptr) ActorPoolTest::heap.Deallocate(static_cast<u8*>(ptr) - ActorPoolTest::memory);
+	}
+}
+
+extern "C" void CpuFill32(s32 val, void* dest, s32 numBytes)
+{
+	std::fill_n(static_cast<s32*>(dest), numBytes / 4, val);
+}
+
+#include "Actor/PoolAllocated.h"
+
+namespace ActorPoolTest
+{
+	// Stands in for ActorBase, whose operator new zeroes the memory
+	struct FakeActor
+	{
+		static inline u32 numHeapAllocations = 0;
+
+		u32 id;
+
+		virtual ~FakeActor() = default;
+
+		void* operator new(size_t count)
+		{
+			numHeapAllocations++;
+
+			void* ptr = Memory::Allocate(count, 4, Memory::gameHeapPtr);
+			if (ptr) std::memset(ptr, 0, count);
+
+			return ptr;
+		}
+
+		void operator delete(void* ptr) { Memory::Deallocate(ptr, Memory::gameHeapPtr); }
+	};
+
+	constexpr u32 CAPACITY = 16;
+
+	struct Fireball : PoolAllocated<FakeActor, Fireball, CAPACITY>
+	{
+		u32 timer;
+		u8 data[0x54];
+	};
+
+	struct BigFireball : Fireball
+	{
+		u8 more[0x20];
+	};
+
+	struct HeapFireball : FakeActor
+	{
+		u32 timer;
+		u8 data[0x54];
+	};
+
+	u32 numWrong = 0;
+
+	void Expect(bool ok, const char* what)
+	{
+		if (!ok)
+		{
+			std::printf("%s\n", what);
+			numWrong++;
+		}
+	}
+
+	void CheckPool()
+	{
+		auto& pool = Fireball::Pool();
+		const std::size_t numBlocks = heap.AllocatedBlocks().size();
+
+		Expect(!pool.Reserved(), "the pool starts without its block");
+
+		// the first spawn reserves the block
+		Fireball* first = new Fireball;
+		Expect(pool.Reserved() && pool.Owns(first) && pool.stats.numReserves == 1, "the first spawn reserves the block");
+		Expect(heap.AllocatedBlocks().size() == numBlocks + 1, "the block is one allocation on the heap");
+		delete first;
+
+		Expect(pool.Reserved(), "the block is kept when the last instance is destroyed");
+
+		std::vector<Fireball*> fireballs;
+		for (u32 i = 0; i < CAPACITY; i++)
+		{
+			fireballs.push_back(new Fireball);
+			fireballs.back()->timer = i + 1;
+		}
+
+		for (Fireball* fireball : fireballs)
+			Expect(pool.Owns(fireball), "every instance up to the capacity is in the pool");
+
+		const u32 numHeapAllocations = FakeActor::numHeapAllocations;
+		Fireball* extra = new Fireball;
+		Expect(!pool.Owns(extra) && FakeActor::numHeapAllocations == numHeapAllocations + 1, "a full pool falls back to Base::operator new");
+		Expect(pool.stats.numFallbacks == 1, "the fallback is counted");
+		delete extra;
+
+		Fireball* big = new BigFireball;
+		Expect(!pool.Owns(big) && pool.stats.numFallbacks == 2, "an instance bigger than a slot falls back");
+		delete big;
+
+		Expect(!pool.Release(), "the block isn't released while instances are in it");
+
+		for (Fireball* fireball : fireballs)
+			delete fireball;
+
+		Expect(pool.Reserved() && pool.stats.numInUse == 0 && pool.stats.maxInUse == CAPACITY, "the block stays after the wave");
+
+		Fireball* again = new Fireball;
+		Expect(pool.Owns(again) && pool.stats.numReserves == 1, "the next wave reuses the block");
+		Expect(again->timer == 0, "a reused slot is zeroed");
+		delete again;
+
+		Expect(pool.Release() && !pool.Reserved(), "an empty pool releases its block");
+		Expect(heap.AllocatedBlocks().size() == numBlocks, "the block is given back to the heap");
+		Expect(pool.Release(), "releasing twice is harmless");
+
+		Expect(pool.Reserve() && pool.Reserved() && pool.stats.numReserves == 2, "Reserve allocates the block for the next level");
+		Expect(pool.Release(), "and Release gives it back");
+	}
+
+	// Spawns and destroys waves of T on a heap that already has holes, returns nanoseconds per actor
+	template<class T>
+	double Waves()
+	{
+		constexpr u32 NUM_WAVES = 20000;
+		T* wave[CAPACITY];
+
+		return NanosPerCall(NUM_WAVES, [&](u32)
+		{
+			for (u32 i = 0; i < CAPACITY; i++)
+				DoNotOptimize(wave[i] = new T);
+
+			for (u32 i = 0; i < CAPACITY; i++)
+				delete wave[i];
+		}) / CAPACITY;
+	}
+
+	void Benchmark()
+	{
+		// other actors and their models, every other one destroyed since
+		std::vector<u32> others;
+		for (u32 i = 0; i < 256; i++)
+			others.push_back(heap.Allocate(0x20 + i % 7 * 0x30, 4));
+
+		for (u32 i = 0; i < others.size(); i += 2)
+			heap.Deallocate(others[i]);
+
+		const u32 numFreeBlocks = heap.FreeBlocks().size();
+
+		Fireball::Pool().Reserve();
+		const double pool = Waves<Fireball>();
+		const double heapOnly = Waves<HeapFireball>();
+		Fireball::Pool().Release();
+
+		std::printf("spawn + destroy with %u free blocks: pool %.1f ns, game heap %.1f ns per actor\n",
+			numFreeBlocks, pool, heapOnly);
+
+		Expect(Fireball::Pool().stats.numFallbacks == 2, "the waves fit into the pool");
+	}
+
+	u32 Run()
+	{
+		CheckPool();
+		Benchmark();
+
+		return numWrong;
+	}
+}
+
+int main()
+{
+	const u32 numWrong = ActorPoolTest::Run();
+	std::printf("ActorPool: %u checks failed\n", numWrong);
+
+	return numWrong == 0 ? 0 : 1;
+}
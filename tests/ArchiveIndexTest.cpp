@@ -0,0 +1,153 @@
+#include "FileSystem/ArchiveIndex.h"
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// ArchiveIndex on a synthetic FAT: random archive ranges, some of them empty and one larger than
+// ArchiveIndex::CAPACITY, with archives loaded and unloaded behind the index's back between rounds
+// of lookups, like the game does. Every lookup is checked against a search of the ranges, and the
+// FAT entry of a resident file against the one that was written for it.
+
+namespace ArchiveIndexTest
+{
+	// What the index reads from ArchiveInfo and Archive
+	struct SyntheticArchive
+	{
+		char* fat;
+	};
+
+	struct SyntheticInfo
+	{
+		char* archive = nullptr; // points to a SyntheticArchive while loaded
+		u16 firstFileID;
+		u16 firstNotFileID;
+	};
+
+	static constexpr u32 NUM_ARCHIVES = 13;
+
+	struct SyntheticFileSystem
+	{
+		SyntheticInfo infos[NUM_ARCHIVES] = {};
+		SyntheticArchive archives[NUM_ARCHIVES] = {};
+		std::vector<ArchiveIndex::FatEntry> fats[NUM_ARCHIVES];
+
+		// The FAT entry of every file encodes where it is, so that lookups can be checked
+		static ArchiveIndex::FatEntry MakeFatEntry(u32 slot, u32 fatIndex)
+		{
+			return {slot << 16 | fatIndex, ~(slot << 16 | fatIndex)};
+		}
+
+		explicit SyntheticFileSystem(std::mt19937& rng)
+		{
+			u32 fileID = 0x8000 + rng() % 0x100;
+			const u32 largeSlot = rng() % NUM_ARCHIVES;
+
+			for (u32 slot = 0; slot < NUM_ARCHIVES; slot++)
+			{
+				const u32 numFiles = slot == largeSlot ? ArchiveIndex::CAPACITY + 0x100 : rng() % 4 == 0 ? 0 : rng() % 0x100;
+
+				infos[slot].firstFileID = fileID;
+				infos[slot].firstNotFileID = fileID + numFiles;
+
+				for (u32 i = 0; i < numFiles; i++)
+					fats[slot].push_back(MakeFatEntry(slot, i));
+
+				archives[slot].fat = reinterpret_cast<char*>(fats[slot].data());
+				fileID += numFiles + (rng() % 2 == 0 ? rng() % 0x20 : 0); // gaps between some archives
+			}
+		}
+
+		void SetLoaded(u32 slot, bool loaded)
+		{
+			infos[slot].archive = loaded ? reinterpret_cast<char*>(&archives[slot]) : nullptr;
+		}
+
+		// The linear search that the index replaces
+		ArchiveIndex::Location Search(u32 fileID) const
+		{
+			for (u32 slot = 0; slot < NUM_ARCHIVES; slot++)
+			{
+				if (fileID >= infos[slot].firstFileID && fileID < infos[slot].firstNotFileID)
+				{
+					return {static_cast<u16>(slot), static_cast<u16>(fileID - infos[slot].firstFileID),
+						infos[slot].archive != nullptr};
+				}
+			}
+
+			return {ArchiveIndex::Location::NONE, 0, false};
+		}
+	};
+
+	inline u32 CheckLookups(ArchiveIndex& index, const SyntheticFileSystem& fs, std::mt19937& rng, u32 numLookups)
+	{
+		u32 numWrong = 0;
+
+		for (u32 n = 0; n < numLookups; n++)
+		{
+			// mostly IDs in or near the archives, sometimes any ID
+			const u32 fileID = rng() % 4 == 0 ? rng() % 0x10000 : 0x7f00 + rng() % 0x1400;
+
+			const ArchiveIndex::Location expected = fs.Search(fileID);
+			const ArchiveIndex::Location location = index.Resolve(fileID);
+
+			if (location.slot != expected.slot || location.IsResident() != expected.IsResident() ||
+				(expected.IsInArchive() && location.fatIndex != expected.fatIndex))
+			{
+				numWrong++;
+				continue;
+			}
+
+			const ArchiveIndex::FatEntry* entry = index.GetFatEntry(fileID);
+
+			if (expected.IsResident())
+			{
+				const ArchiveIndex::FatEntry wanted = SyntheticFileSystem::MakeFatEntry(expected.slot, expected.fatIndex);
+
+				if (!entry || entry->start != wanted.start || entry->end != wanted.end)
+					numWrong++;
+			}
+			else if (entry)
+				numWrong++;
+		}
+
+		return numWrong;
+	}
+
+	// Returns the number of wrong lookups
+	inline u32 Run(u32 numFileSystems, u32 seed = 0)
+	{
+		std::mt19937 rng(seed);
+		u32 numWrong = 0;
+
+		for (u32 n = 0; n < numFileSystems; n++)
+		{
+			SyntheticFileSystem fs(rng);
+
+			for (u32 slot = 0; slot < NUM_ARCHIVES; slot++)
+				fs.SetLoaded(slot, rng() % 2 == 0);
+
+			ArchiveIndex index;
+			index.Rebuild<SyntheticArchive>(fs.infos);
+			numWrong += CheckLookups(index, fs, rng, 500);
+
+			for (u32 round = 0; round < 8; round++)
+			{
+				const u32 slot = rng() % NUM_ARCHIVES;
+
+				fs.SetLoaded(slot, fs.infos[slot].archive == nullptr);
+
+				numWrong += CheckLookups(index, fs, rng, 200);
+			}
+		}
+
+		return numWrong;
+	}
+}
+
+int main()
+{
+	const u32 numWrong = ArchiveIndexTest::Run(200);
+	std::printf("ArchiveIndex: %u wrong lookups\n", numWrong);
+
+	return numWrong == 0 ? 0 : 1;
+}
@@ -0,0 +1,137 @@
+#include "FileSystem/ArchivePacker.h"
+#include <cstdio>
+#include <random>
+
+// Round trips of synthetic archives through ArchivePacker::Repack, with random first-use traces
+
+namespace ArchivePackerTest
+{
+	inline std::vector<u8> MakeArchive(std::mt19937& rng)
+	{
+		ArchivePacker::Unpacked archive;
+		const u32 numFiles = rng() % 64;
+
+		// an FNT with only the root directory, whose contents don't matter for the packer
+		archive.fnt = {'B', 'T', 'N', 'F', 0x10, 0, 0, 0, 4, 0, 0, 0, 0, 0, 1, 0};
+		archive.files.resize(numFiles);
+
+		for (u32 i = 0; i < numFiles; i++)
+		{
+			archive.files[i].resize(rng() % 4 == 0 ? 0 : rng() % 0x800);
+
+			for (u8& b : archive.files[i])
+				b = rng();
+
+			archive.layout.push_back(i);
+		}
+
+		std::shuffle(archive.layout.begin(), archive.layout.end(), rng);
+
+		return ArchivePacker::Pack(archive, archive.layout);
+	}
+
+	// Checks that every file of the repacked archive is the same as in the original, both through
+	// Unpack and through NARC_File. The number of seeks isn't checked: first-use order is a heuristic,
+	// and with random traces that go back to earlier files a lot it can be worse than the original.
+	inline bool RoundTrip(std::span<const u8> narc, std::span<const u16> trace, u32 firstFileID)
+	{
+		std::vector<u8> packed;
+		const ArchivePacker::Report report = ArchivePacker::Repack(narc, trace, firstFileID, packed);
+
+		ArchivePacker::Unpacked before, after;
+
+		if (!ArchivePacker::Unpack(narc, before) || !ArchivePacker::Unpack(packed, after))
+			return false;
+
+		if (before.files != after.files || before.fnt != after.fnt)
+			return false;
+
+		const NARC_File& file = *reinterpret_cast<const NARC_File*>(packed.data());
+
+		for (u32 i = 0; i < before.files.size(); i++)
+		{
+			u32 size;
+			const u8* data = file.GetFile(i, size);
+
+			if (!data || size != before.files[i].size() || !std::equal(data, data + size, before.files[i].begin()))
+				return false;
+		}
+
+		return report.after.numReads == report.before.numReads && report.after.bytesRead == report.before.bytesRead;
+	}
+
+	// Returns the number of malformed headers that Unpack accepted. The sizes of the FAT, the FNT and
+	// the GMIF are changed one at a time in a valid archive, to values whose offsets would wrap in u32
+	// or that are smaller than a section header.
+	inline u32 CheckMalformed()
+	{
+		std::mt19937 rng(1);
+		std::vector<u8> narc;
+
+		while (narc.size() < 0x40)
+			narc = MakeArchive(rng);
+
+		const auto sizeOffset = [&](u32 section)
+		{
+			if (section == 0) return 0x14u;
+
+			const u32 fntOffset = 0x10 + (narc[0x14] | narc[0x15] << 8 | narc[0x16] << 16 | narc[0x17] << 24);
+			if (section == 1) return fntOffset + 4;
+
+			return fntOffset + (narc[fntOffset + 4] | narc[fntOffset + 5] << 8 | narc[fntOffset + 6] << 16 | narc[fntOffset + 7] << 24) + 4;
+		};
+
+		u32 numAccepted = 0;
+
+		for (u32 section = 0; section < 3; section++)
+			for (u32 size : {0u, 4u, 7u, 0xfffffff0u, 0xfffffffcu, 0xffffffffu})
+			{
+				std::vector<u8> malformed = narc;
+				const u32 offset = sizeOffset(section);
+
+				for (u32 i = 0; i < 4; i++)
+					malformed[offset + i] = size >> 8 * i;
+
+				ArchivePacker::Unpacked archive;
+				numAccepted += ArchivePacker::Unpack(malformed, archive);
+			}
+
+		return numAccepted;
+	}
+
+	// Returns the number of archives that failed to round trip
+	inline u32 Run(u32 numArchives, u32 seed = 0)
+	{
+		std::mt19937 rng(seed);
+		u32 numFailed = 0;
+
+		for (u32 n = 0; n < numArchives; n++)
+		{
+			const std::vector<u8> narc = MakeArchive(rng);
+			const u32 numFiles = narc[0x18] | narc[0x19] << 8;
+			const u32 firstFileID = 0x100;
+
+			// a trace with repeats and IDs outside of the archive, like one of a whole level
+			std::vector<u16> trace(rng() % 128);
+
+			for (u16& fileID : trace)
+				fileID = firstFileID - 4 + rng() % (numFiles + 8);
+
+			if (!RoundTrip(narc, trace, firstFileID))
+				numFailed++;
+		}
+
+		return numFailed;
+	}
+}
+
+int main()
+{
+	const u32 numFailed = ArchivePackerTest::Run(200);
+	std::printf("ArchivePacker round trips: %u of 200 failed\n", numFailed);
+
+	const u32 numAccepted = ArchivePackerTest::CheckMalformed();
+	std::printf("ArchivePacker malformed headers: %u accepted\n", numAccepted);
+
+	return numFailed == 0 && numAccepted == 0 ? 0 : 1;
+}
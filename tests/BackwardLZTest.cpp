@@ -0,0 +1,329 @@
+#include "Formats/BackwardLZ.h"
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <span>
+#include <vector>
+
+// Round trips of BackwardLZ::Decompress, which OverlayLoader::Load runs in place on every compressed
+// overlay, through the encoder below: images that store a part before the compressed one, images whose
+// last bytes are referenced by the first back-references, and images that don't compress at all. The
+// decompression runs in a buffer of DecompressedSize bytes followed by guard bytes, like an overlay
+// in its area.
+
+namespace BackwardLZTest
+{
+	static constexpr u32 MIN_LENGTH = 3;
+	static constexpr u32 MAX_LENGTH = 0xf + MIN_LENGTH;
+	static constexpr u32 MIN_DISTANCE = 3;
+	static constexpr u32 MAX_DISTANCE = 0xfff + MIN_DISTANCE;
+
+	struct Compressed
+	{
+		std::vector<u8> image;   // empty if compressing doesn't make the image smaller
+		u32 numStored = 0;       // the bytes before the compressed part
+		bool referencesEnd = false; // a back-reference copies the last byte of the image
+	};
+
+	// Greedy with hash chains. The decompressor goes from the end towards the start, so the data is
+	// compressed reversed, as ordinary LZ with distances of at least 3. In place, the compressed part
+	// must never be overwritten before it's read, so it's cut where it gains the most over the output
+	// it decompresses to, and what's left at the start of the data is stored.
+	inline Compressed Compress(std::span<const u8> data)
+	{
+		static constexpr u32 HASH_BITS = 14;
+		static constexpr u32 NONE = ~0u;
+		static constexpr u32 MAX_CHAIN = 256;
+
+		const u32 size = data.size();
+		std::vector<u8> reversed(data.rbegin(), data.rend());
+
+		std::vector<u32> head(1 << HASH_BITS, NONE);
+		std::vector<u32> prev(size, NONE);
+
+		const auto hash = [&](u32 i)
+		{
+			const u32 key = reversed[i] << 16 | reversed[i + 1] << 8 | reversed[i + 2];
+			return (key * 0x9e3779b1) >> (32 - HASH_BITS);
+		};
+
+		const auto insert = [&](u32 i)
+		{
+			if (i + MIN_LENGTH > size) return;
+
+			const u32 h = hash(i);
+			prev[i] = head[h];
+			head[h] = i;
+		};
+
+		// the stream in the reversed order: flag bytes, literals and back-references high byte first
+		std::vector<u8> stream;
+		u32 flagIndex = 0;
+		u32 numTokensInGroup = 8;
+
+		// after the best token so far: the bytes decompressed and read, and whether a back-reference
+		// before it reaches the end of the image
+		u32 bestOut = 0, bestIn = 0;
+		s32 bestGain = 0;
+		bool referencesEnd = false, bestReferencesEnd = false;
+
+		for (u32 i = 0; i < size; )
+		{
+			if (numTokensInGroup == 8)
+			{
+				flagIndex = stream.size();
+				stream.push_back(0);
+				numTokensInGroup = 0;
+			}
+
+			u32 bestLength = 0, bestDistance = 0;
+
+			if (i + MIN_LENGTH <= size)
+			{
+				u32 chain = 0;
+
+				for (u32 j = head[hash(i)]; j != NONE && chain < MAX_CHAIN; j = prev[j], chain++)
+				{
+					const u32 distance = i - j;
+					if (distance > MAX_DISTANCE) break;
+					if (distance < MIN_DISTANCE) continue;
+
+					u32 length = 0;
+					while (length < MAX_LENGTH && i + length < size && reversed[j + length] == reversed[i + length])
+						length++;
+
+					if (length > bestLength)
+					{
+						bestLength = length;
+						bestDistance = distance;
+					}
+				}
+			}
+
+			u32 length = 1;
+
+			if (bestLength >= MIN_LENGTH)
+			{
+				const u32 token = (bestLength - MIN_LENGTH) << 12 | (bestDistance - MIN_DISTANCE);
+				stream[flagIndex] |= 0x80 >> numTokensInGroup;
+				stream.push_back(token >> 8);
+				stream.push_back(token & 0xff);
+
+				referencesEnd |= i == bestDistance;
+				length = bestLength;
+			}
+			else
+				stream.push_back(reversed[i]);
+
+			numTokensInGroup++;
+
+			for (u32 k = 0; k < length; k++)
+				insert(i + k);
+
+			i += length;
+
+			const s32 gain = static_cast<s32>(i) - static_cast<s32>(stream.size());
+
+			if (gain >= bestGain)
+			{
+				bestGain = gain;
+				bestOut = i;
+				bestIn = stream.size();
+				bestReferencesEnd = referencesEnd;
+			}
+		}
+
+		Compressed res;
+
+		// the stream is cut after the best token, the decompressor ignores the flags of the tokens after it
+		const u32 numStored = size - bestOut;
+		const u32 padding = (4 - (numStored + bestIn) % 4) % 4;
+		const u32 compressedSize = numStored + bestIn + padding + BackwardLZ::FOOTER_SIZE;
+
+		if (compressedSize >= size) return res;
+
+		res.numStored = numStored;
+		res.referencesEnd = bestReferencesEnd;
+		res.image.assign(data.begin(), data.begin() + numStored);
+		res.image.insert(res.image.end(), stream.rend() - bestIn, stream.rend());
+		res.image.insert(res.image.end(), padding, 0xff);
+
+		const u32 top = bestIn + padding + BackwardLZ::FOOTER_SIZE;
+		const u32 bufferTopAndBottom = top | (padding + BackwardLZ::FOOTER_SIZE) << 24;
+		const u32 sizeIncrease = size - compressedSize;
+
+		for (u32 word : {bufferTopAndBottom, sizeIncrease})
+			for (u32 shift = 0; shift < 32; shift += 8)
+				res.image.push_back(word >> shift);
+
+		return res;
+	}
+
+	u32 numWrong = 0;
+
+	void Expect(bool ok, const char* what)
+	{
+		if (!ok)
+		{
+			std::printf("%s\n", what);
+			numWrong++;
+		}
+	}
+
+	// Decompresses in place and checks the output and that nothing after the buffer was written
+	bool RoundTrip(std::span<const u8> data, const Compressed& compressed)
+	{
+		static constexpr u8 GUARD = 0xa5;
+		static constexpr u32 NUM_GUARDS = 0x20;
+
+		const u32 compressedSize = compressed.image.size();
+
+		if (BackwardLZ::DecompressedSize(compressed.image.data(), compressedSize) != data.size())
+			return false;
+
+		std::vector<u8> buffer(data.size() + NUM_GUARDS, GUARD);
+		std::copy(compressed.image.begin(), compressed.image.end(), buffer.begin());
+
+		if (!BackwardLZ::Decompress(buffer.data(), compressedSize))
+			return false;
+
+		return std::equal(data.begin(), data.end(), buffer.begin()) &&
+			std::all_of(buffer.begin() + data.size(), buffer.end(), [](u8 b) { return b == GUARD; });
+	}
+
+	// Code-like data: a small alphabet with repeated instruction patterns
+	std::vector<u8> MakeCode(std::mt19937& rng, u32 size)
+	{
+		std::vector<u8> res;
+
+		while (res.size() < size)
+		{
+			if (res.size() > 16 && rng() % 3 != 0)
+			{
+				const u32 distance = 4 + rng() % std::min<u32>(res.size() - 4, MAX_DISTANCE);
+				const u32 length = 4 * (1 + rng() % 6);
+
+				for (u32 i = 0; i < length; i++)
+					res.push_back(res[res.size() - distance]);
+			}
+			else
+				res.push_back("\x00\x10\xa0\xe1\xe5\x9f\x1e\xff"[rng() % 8]);
+		}
+
+		res.resize(size);
+		return res;
+	}
+
+	std::vector<u8> MakeNoise(std::mt19937& rng, u32 size)
+	{
+		std::vector<u8> res(size);
+		for (u8& b : res) b = rng();
+
+		return res;
+	}
+
+	void CheckStored()
+	{
+		// noise can't be compressed, so it's stored before the code that can
+		std::mt19937 rng(1);
+		std::vector<u8> data = MakeNoise(rng, 0x300);
+		const std::vector<u8> code = MakeCode(rng, 0x2000);
+		data.insert(data.end(), code.begin(), code.end());
+
+		const Compressed compressed = Compress(data);
+
+		Expect(!compressed.image.empty(), "code after noise compresses");
+		// literals in the free slots of a flag byte cost nothing, so a few bytes of noise may be compressed
+		Expect(compressed.numStored > 0x300 - 8 && compressed.numStored <= 0x300, "the noise is stored before the compressed part");
+		Expect(RoundTrip(data, compressed), "an image with stored bytes round trips");
+	}
+
+	void CheckEnd()
+	{
+		// the last 0x20 bytes repeat the 0x20 before them, so the first back-reference copies them
+		std::mt19937 rng(2);
+		std::vector<u8> data = MakeCode(rng, 0x1000);
+		const std::vector<u8> tail = MakeNoise(rng, 0x20);
+		data.insert(data.end(), tail.begin(), tail.end());
+		data.insert(data.end(), tail.begin(), tail.end());
+
+		const Compressed compressed = Compress(data);
+
+		Expect(compressed.referencesEnd, "a back-reference reaches the end of the image");
+		Expect(RoundTrip(data, compressed), "an image with back-references to its end round trips");
+
+		// all the same byte: every back-reference after the first 3 literals is a run
+		const std::vector<u8> zeros(0x800, 0);
+		const Compressed run = Compress(zeros);
+
+		Expect(run.referencesEnd && run.numStored == 0, "a run is compressed from the end to the start");
+		Expect(RoundTrip(zeros, run), "a run round trips");
+	}
+
+	void CheckInvalid()
+	{
+		std::mt19937 rng(3);
+		const std::vector<u8> noise = MakeNoise(rng, 0x400);
+
+		Expect(Compress(noise).image.empty(), "noise isn't compressed");
+
+		// a footer whose compressed part starts before the image
+		std::vector<u8> image = MakeCode(rng, 0x100);
+		const u32 top = 0x200;
+		const u8 footer[] = {top & 0xff, top >> 8, 0, 8, 0x10, 0, 0, 0};
+		image.insert(image.end(), std::begin(footer), std::end(footer));
+
+		const std::vector<u8> before = image;
+		Expect(!BackwardLZ::Decompress(image.data(), image.size()) && image == before, "an invalid footer is rejected without changes");
+		Expect(BackwardLZ::DecompressedSize(image.data(), 4) == 4, "an image too small for a footer keeps its size");
+	}
+
+	// Returns the number of images that failed to round trip
+	u32 Fuzz(u32 numImages)
+	{
+		std::mt19937 rng(4);
+		u32 numFailed = 0;
+		u32 numCompressed = 0;
+
+		for (u32 i = 0; i < numImages; i++)
+		{
+			std::vector<u8> data;
+
+			for (u32 part = 0, numParts = 1 + rng() % 4; part < numParts; part++)
+			{
+				const u32 size = rng() % 0x1800;
+				const std::vector<u8> bytes = rng() % 4 == 0 ? MakeNoise(rng, size) : MakeCode(rng, size);
+				data.insert(data.end(), bytes.begin(), bytes.end());
+			}
+
+			const Compressed compressed = Compress(data);
+			if (compressed.image.empty()) continue;
+
+			numCompressed++;
+			if (!RoundTrip(data, compressed)) numFailed++;
+		}
+
+		std::printf("%u of %u images compressed, %u failed to round trip\n", numCompressed, numImages, numFailed);
+
+		return numFailed;
+	}
+
+	u32 Run()
+	{
+		CheckStored();
+		CheckEnd();
+		CheckInvalid();
+
+		Expect(Fuzz(300) == 0, "every compressed image round trips");
+
+		return numWrong;
+	}
+}
+
+int main()
+{
+	const u32 numWrong = BackwardLZTest::Run();
+	std::printf("BackwardLZ: %u checks failed\n", numWrong);
+
+	return numWrong == 0 ? 0 : 1;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "Math/MathCommon.h"
+#include <chrono>
+
+// Timing helpers for the benchmarks in tests/. The numbers are for the host, so only compare
+// them relative to each other; the ARM9 has no cache for most of main RAM and no SIMD.
+
+// Keeps the compiler from optimizing away the computation of value
+template<class T>
+inline void DoNotOptimize(const T& value)
+{
+	asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Calls f(i) for i in [0, iterations) and returns the average time of a call in nanoseconds
+template<class F>
+double NanosPerCall(u32 iterations, F&& f)
+{
+	using Clock = std::chrono::steady_clock;
+
+	const auto start = Clock::now();
+
+	for (u32 i = 0; i < iterations; i++)
+		f(i);
+
+	const std::chrono::duration<double, std::nano> nanos = Clock::now() - start;
+	return iterations ? nanos.count() / iterations : 0;
+}
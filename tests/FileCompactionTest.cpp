@@ -0,0 +1,467 @@
+#include "Memory/HeapModel.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <sys/mman.h>
+#include <vector>
+
+// FileCompaction::Compact on a HeapModel standing in for the root heap, with a synthetic BMD_File
+// whose pointers have been initialized: once slid into a hole of its own, and once bounced through
+// the end of the heap into the hole directly before it, so that the new copy overlaps the old block.
+// Every pointer in the moved file must point into the new block at the same offset as before, except
+// the ones that pointed outside the file. The heap is mapped at 0x02000000 like the DS's main RAM,
+// since Material::textureID and paletteID only hold a pointer if it fits into 32 bits.
+
+namespace FileCompactionTest
+{
+	constexpr uintptr_t HEAP_ADDRESS = 0x02000000;
+	constexpr u32 HEAP_SIZE = 0x4000;
+
+	u8* memory = nullptr;
+	HeapModel model(HEAP_SIZE);
+}
+
+struct MemoryNode
+{
+	enum Flags : u16
+	{
+		NODE_ID = 0xff << 0,
+	};
+
+	u16 magic;
+	u16 flags;
+	u32 size;
+	u32 prev;
+	u32 next;
+};
+
+static_assert(sizeof(MemoryNode) == HeapModel::NODE_SIZE);
+
+struct ExpandingHeapAllocator
+{
+	u16 allocationMode = 0;
+	void* heapStart;
+	void* heapEnd;
+
+	u32 SetNodeID(u32 id)
+	{
+		const u32 prev = FileCompactionTest::model.nodeID;
+		FileCompactionTest::model.nodeID = id;
+		return prev;
+	}
+};
+
+// Like the game's, Allocate zeroes the block
+struct ExpandingHeap
+{
+	ExpandingHeapAllocator* allocator;
+
+	void* Allocate(u32 size, s32 align)
+	{
+		using namespace FileCompactionTest;
+
+		const u32 data = model.Allocate(size, align);
+		if (!data) return nullptr;
+
+		std::memset(memory + data, 0, size);
+
+		MemoryNode& node = reinterpret_cast<MemoryNode*>(memory + data)[-1];
+		node = {0x5544, model.nodeID, (size + 3) & ~3u, 0, 0};
+
+		return memory + data;
+	}
+
+	bool Deallocate(void* ptr)
+	{
+		return FileCompactionTest::model.Deallocate(static_cast<u8*>(ptr) - FileCompactionTest::memory);
+	}
+};
+
+struct SegregatedFitIndex
+{
+	static bool IsInstalledOn(ExpandingHeap&) { return false; }
+};
+
+namespace HeapTelemetry
+{
+	struct Usage
+	{
+		u32 largestFree;
+		u16 fragmentation;
+	};
+
+	Usage Measure(const ExpandingHeapAllocator&)
+	{
+		return {FileCompactionTest::model.MaxAllocatableSize(), 0};
+	}
+}
+
+void CpuCopy32(const void* src, void* dest, s32 numBytes)
+{
+	std::memmove(dest, src, numBytes);
+}
+
+struct SharedFilePtr
+{
+	u16 fileID;
+	u8 numRefs;
+	char* filePtr;
+};
+
+// The members FileCompaction patches, with the host's pointer size
+struct BMD_File
+{
+	struct Bone
+	{
+		char* name;
+		u8* materialIDList;
+		u8* diplayListIDList;
+	};
+
+	struct DisplayList
+	{
+		u32 numTransforms;
+		u32* transforms;
+		u32 dataSize;
+		u32* data;
+	};
+
+	struct DisplayListHeader
+	{
+		u32 numLists;
+		DisplayList* list;
+	};
+
+	struct Texture
+	{
+		char* name;
+		char* data;
+	};
+
+	struct Palette
+	{
+		char* name;
+		u16* data;
+	};
+
+	struct Material
+	{
+		char* name;
+		s32 textureID;
+		s32 paletteID;
+	};
+
+	struct Unknown
+	{
+		void* unk00;
+		void* unk04;
+		void* unk08;
+		void* unk0c;
+	};
+
+	u32 numBones;
+	Bone* bones;
+	u32 numDisplayLists;
+	DisplayListHeader* displayLists;
+	u32 numTextures;
+	Texture* textures;
+	u32 numPalettes;
+	Palette* palettes;
+	u32 numMaterials;
+	Material* materials;
+	void* transformMap;
+	u32 hasUnknown;
+	Unknown* unknown;
+};
+
+struct ModelComponents
+{
+	BMD_File* modelFile;
+};
+
+struct CommonModelData
+{
+	BMD_File* file;
+	ModelComponents* modelComponents;
+};
+
+u32 numCommonModelData = 0;
+CommonModelData commonModelDataArr[4];
+
+struct ostream
+{
+	const ostream& operator<<(const char* str) const { std::printf("%s", str); return *this; }
+	const ostream& operator<<(u32 val) const { std::printf("%u", val); return *this; }
+	const ostream& operator<<(s32 val) const { std::printf("%d", val); return *this; }
+	const ostream& operator<<(char c) const { std::printf("%c", c); return *this; }
+};
+
+#include "Memory/FileCompaction.h"
+
+namespace FileCompactionTest
+{
+	u32 numWrong = 0;
+
+	void Expect(bool ok, const char* what)
+	{
+		if (!ok)
+		{
+			std::printf("%s\n", what);
+			numWrong++;
+		}
+	}
+
+	// a texture that was cut off by ShrinkAllocation
+	char vramTexture[0x20];
+
+	// Lays out a BMD_File with initialized pointers in the block at start, returns its size
+	u32 BuildBMD(char* start)
+	{
+		u32 size = 0;
+
+		auto take = [&]<class T>(T*& ptr, u32 count)
+		{
+			size = (size + alignof(T) - 1) & ~(alignof(T) - 1);
+			ptr = reinterpret_cast<T*>(start + size);
+			size += sizeof(T) * count;
+		};
+
+		auto name = [&](char*& ptr, const char* str)
+		{
+			take(ptr, std::strlen(str) + 1);
+			std::strcpy(ptr, str);
+		};
+
+		BMD_File* bmd;
+		take(bmd, 1);
+
+		bmd->numBones = 2;
+		take(bmd->bones, 2);
+
+		for (u32 i = 0; i < 2; i++)
+		{
+			name(bmd->bones[i].name, i == 0 ? "root" : "head");
+			take(bmd->bones[i].materialIDList, 2);
+			take(bmd->bones[i].diplayListIDList, 2);
+		}
+
+		bmd->numDisplayLists = 2;
+		take(bmd->displayLists, 2);
+
+		for (u32 i = 0; i < 2; i++)
+		{
+			BMD_File::DisplayListHeader& header = bmd->displayLists[i];
+			header.numLists = 1 + i;
+			take(header.list, header.numLists);
+
+			for (u32 j = 0; j < header.numLists; j++)
+			{
+				header.list[j].numTransforms = 2;
+				take(header.list[j].transforms, 2);
+				header.list[j].dataSize = 0x10;
+				take(header.list[j].data, 4);
+			}
+		}
+
+		bmd->numTextures = 2;
+		take(bmd->textures, 2);
+		name(bmd->textures[0].name, "mario_body");
+		take(bmd->textures[0].data, 0x40);
+		name(bmd->textures[1].name, "mario_eyes");
+		bmd->textures[1].data = vramTexture;
+
+		bmd->numPalettes = 1;
+		take(bmd->palettes, 1);
+		name(bmd->palettes[0].name, "mario_body_pl");
+		take(bmd->palettes[0].data, 0x10);
+
+		bmd->numMaterials = 2;
+		take(bmd->materials, 2);
+		name(bmd->materials[0].name, "mat_body");
+		bmd->materials[0].textureID = static_cast<s32>(reinterpret_cast<uintptr_t>(&bmd->textures[0]));
+		bmd->materials[0].paletteID = static_cast<s32>(reinterpret_cast<uintptr_t>(&bmd->palettes[0]));
+		name(bmd->materials[1].name, "mat_eyes");
+		bmd->materials[1].textureID = 1;
+		bmd->materials[1].paletteID = -1;
+
+		u32* transformMap;
+		take(transformMap, 4);
+		bmd->transformMap = transformMap;
+
+		bmd->hasUnknown = 1;
+		take(bmd->unknown, 1);
+
+		u32* unknownData;
+		take(unknownData, 4);
+		bmd->unknown->unk00 = unknownData;
+		bmd->unknown->unk04 = unknownData + 1;
+		bmd->unknown->unk08 = unknownData + 2;
+		bmd->unknown->unk0c = unknownData + 3;
+
+		return (size + 3) & ~3u;
+	}
+
+	struct Pointer
+	{
+		bool inFile;
+		uintptr_t value; // the offset in the file if inFile, the address otherwise
+
+		bool operator==(const Pointer&) const = default;
+	};
+
+	// Every pointer in the BMD_File at start, found through its own tables
+	std::vector<Pointer> Pointers(const char* start, u32 size)
+	{
+		std::vector<Pointer> res;
+
+		auto add = [&](const void* ptr)
+		{
+			const uintptr_t address = reinterpret_cast<uintptr_t>(ptr);
+			const uintptr_t begin = reinterpret_cast<uintptr_t>(start);
+
+			if (address >= begin && address < begin + size)
+				res.push_back({true, address - begin});
+			else
+				res.push_back({false, address});
+		};
+
+		const BMD_File& bmd = *reinterpret_cast<const BMD_File*>(start);
+
+		for (const void* table : {(const void*)bmd.bones, (const void*)bmd.displayLists, (const void*)bmd.textures,
+			(const void*)bmd.palettes, (const void*)bmd.materials, (const void*)bmd.transformMap, (const void*)bmd.unknown})
+			add(table);
+
+		for (u32 i = 0; i < bmd.numBones; i++)
+		{
+			add(bmd.bones[i].name);
+			add(bmd.bones[i].materialIDList);
+			add(bmd.bones[i].diplayListIDList);
+		}
+
+		for (u32 i = 0; i < bmd.numDisplayLists; i++)
+		{
+			add(bmd.displayLists[i].list);
+
+			for (u32 j = 0; j < bmd.displayLists[i].numLists; j++)
+			{
+				add(bmd.displayLists[i].list[j].transforms);
+				add(bmd.displayLists[i].list[j].data);
+			}
+		}
+
+		for (u32 i = 0; i < bmd.numTextures; i++)
+		{
+			add(bmd.textures[i].name);
+			add(bmd.textures[i].data);
+		}
+
+		for (u32 i = 0; i < bmd.numPalettes; i++)
+		{
+			add(bmd.palettes[i].name);
+			add(bmd.palettes[i].data);
+		}
+
+		for (u32 i = 0; i < bmd.numMaterials; i++)
+		{
+			add(bmd.materials[i].name);
+
+			for (s32 id : {bmd.materials[i].textureID, bmd.materials[i].paletteID})
+			{
+				if (static_cast<u32>(id) >= HEAP_ADDRESS)
+					add(reinterpret_cast<const void*>(static_cast<uintptr_t>(static_cast<u32>(id))));
+				else
+					res.push_back({false, static_cast<u32>(id)});
+			}
+		}
+
+		add(bmd.unknown->unk00);
+		add(bmd.unknown->unk04);
+		add(bmd.unknown->unk08);
+		add(bmd.unknown->unk0c);
+
+		return res;
+	}
+
+	// holeSize is the data size of the block freed directly before the file
+	void CheckMove(u32 holeSize, bool overlapping, const char* what)
+	{
+		std::printf("%s\n", what);
+
+		model = HeapModel(HEAP_SIZE);
+		ExpandingHeapAllocator allocator = {0, memory, memory + HEAP_SIZE};
+		ExpandingHeap heap = {&allocator};
+
+		// the file is built in place and then loaded, to know its size
+		static char staging[0x800];
+		const u32 fileSize = BuildBMD(staging);
+
+		char* hole = static_cast<char*>(heap.Allocate(holeSize, 4));
+
+		model.nodeID = 5;
+		SharedFilePtr file = {0x0123, 1, static_cast<char*>(heap.Allocate(fileSize, 4))};
+		model.nodeID = 0;
+
+		heap.Allocate(0x10, 4); // keeps the file from growing into the end of the heap
+
+		const u32 builtSize = BuildBMD(file.filePtr);
+		const std::vector<Pointer> before = Pointers(file.filePtr, fileSize);
+		heap.Deallocate(hole);
+
+		ModelComponents components = {reinterpret_cast<BMD_File*>(file.filePtr)};
+		commonModelDataArr[0] = {reinterpret_cast<BMD_File*>(file.filePtr), &components};
+		numCommonModelData = 1;
+
+		FileCompaction compaction;
+		compaction.Register(file, FileCompaction::BMD);
+
+		Expect(builtSize == fileSize, "the file is laid out the same way in the heap");
+		Expect(compaction.Compact(heap) == 1, "the file is moved");
+		Expect(file.filePtr == hole, "the file is moved to the start of the hole");
+		Expect((file.filePtr + fileSize > hole + holeSize) == overlapping, "the old and the new block overlap as intended");
+
+		const std::vector<Pointer> after = Pointers(file.filePtr, fileSize);
+		Expect(after == before, "every pointer points to the same place in the new copy");
+		Expect(std::count(before.begin(), before.end(), Pointer{false, reinterpret_cast<uintptr_t>(vramTexture)}) == 1,
+			"the pointer out of the file is left alone");
+
+		Expect(commonModelDataArr[0].file == reinterpret_cast<BMD_File*>(file.filePtr), "commonModelDataArr points to the new copy");
+		Expect(components.modelFile == reinterpret_cast<BMD_File*>(file.filePtr), "the ModelComponents point to the new copy");
+
+		const auto blocks = model.AllocatedBlocks();
+		const auto moved = std::find_if(blocks.begin(), blocks.end(),
+			[&](const HeapModel::AllocatedBlock& b) { return memory + b.data == reinterpret_cast<u8*>(file.filePtr); });
+
+		Expect(moved != blocks.end() && moved->nodeID == 5, "the new block keeps the node ID");
+		Expect(blocks.size() == 2, "the old and the temporary block are freed");
+	}
+
+	u32 Run()
+	{
+		void* mapped = mmap(reinterpret_cast<void*>(HEAP_ADDRESS), HEAP_SIZE, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+
+		if (mapped != reinterpret_cast<void*>(HEAP_ADDRESS))
+		{
+			std::printf("can't map the heap at 0x%lx, skipping\n", static_cast<unsigned long>(HEAP_ADDRESS));
+			return ~0u;
+		}
+
+		memory = static_cast<u8*>(mapped);
+
+		CheckMove(0x800, false, "into a hole of its own:");
+		CheckMove(0x40, true, "through the end of the heap into the hole directly before it:");
+
+		munmap(mapped, HEAP_SIZE);
+		return numWrong;
+	}
+}
+
+int main()
+{
+	const u32 numWrong = FileCompactionTest::Run();
+	if (numWrong == ~0u) return 77;
+
+	std::printf("FileCompaction: %u checks failed\n", numWrong);
+
+	return numWrong == 0 ? 0 : 1;
+}
@@ -0,0 +1,84 @@
+#include "Math.h"
+#include <cstdio>
+#include <utility>
+
+// SharedFilePtr only needs the file formats declared, and Formats.h only compiles for the DS
+struct BCA_File;
+struct BMA_File;
+struct BTA_File;
+struct BTP_File;
+struct MESG_File;
+struct DYLB_File;
+
+#include "Lists/FileList.h"
+
+// 1000 lookups of names spread over FileList::FILES, each in a constant evaluation of its own like
+// the SharedFilePtr("...") and "..."_fileID of the game code. This TU is the compile-time benchmark
+// of the lookup: a table that's evaluated again per lookup shows up in the time and memory it takes
+// to compile (see -ftime-report). At run time, every lookup must have found its own entry.
+
+namespace FileListTest
+{
+	constexpr std::size_t NUM_FILES = std::size(FileList::FILES);
+	constexpr std::size_t NUM_LOOKUPS = 1000;
+
+	template<std::size_t I>
+	constexpr SharedFilePtr::IDs LOOKUP = SharedFilePtr::IDs::Get(FileList::FILES[I * NUM_FILES / NUM_LOOKUPS].name);
+
+	u32 numWrong = 0;
+
+	void Expect(bool ok, const char* what)
+	{
+		if (!ok)
+		{
+			std::printf("%s\n", what);
+			numWrong++;
+		}
+	}
+
+	template<std::size_t... I>
+	void CheckLookups(std::index_sequence<I...>)
+	{
+		const SharedFilePtr::IDs found[] = {LOOKUP<I>...};
+		u32 numFound = 0;
+
+		for (std::size_t i = 0; i < NUM_LOOKUPS; i++)
+		{
+			const SharedFilePtr::IDs& expected = FileList::FILES[i * NUM_FILES / NUM_LOOKUPS].ids;
+			numFound += found[i].fileID == expected.fileID && found[i].ov0ID == expected.ov0ID;
+		}
+
+		Expect(numFound == NUM_LOOKUPS, "every lookup finds its own entry");
+	}
+
+	void CheckNames()
+	{
+		// were out of order, so the binary search missed them
+		Expect("data/special_obj/SW_lift/SW_lift.bmd"_fileID == 0x0504, "SW_lift.bmd is found");
+		Expect("data/special_obj/SW_lift/SW_lift.kcl"_ov0ID == 0x06b4, "SW_lift.kcl is found");
+
+		constexpr SharedFilePtr::IDs first = SharedFilePtr::IDs::Get(FileList::FILES[0].name);
+		constexpr SharedFilePtr::IDs last = SharedFilePtr::IDs::Get(FileList::FILES[NUM_FILES - 1].name);
+
+		Expect(first.fileID == FileList::FILES[0].ids.fileID, "the first name is found");
+		Expect(last.fileID == FileList::FILES[NUM_FILES - 1].ids.fileID, "the last name is found");
+	}
+
+	u32 Run()
+	{
+		static_assert(NameLookup::FirstUnsorted(FileList::FILES) == nullptr, "FILES is sorted");
+
+		CheckLookups(std::make_index_sequence<NUM_LOOKUPS>());
+		CheckNames();
+
+		return numWrong;
+	}
+}
+
+int main()
+{
+	const u32 numWrong = FileListTest::Run();
+	std::printf("FileList: %u checks failed\n", numWrong);
+
+	return numWrong == 0 ? 0 : 1;
+}
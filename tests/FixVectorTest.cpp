@@ -0,0 +1,138 @@
+#include "Math.h"
+#include "Benchmark.h"
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+// Checks WithinDist, Dot and the conversions of BasicVector3 in every format against exact
+// arithmetic, and benchmarks the distance checks of Vector3Q8, BasicVector3<Fix12i> and Vector3Q20
+// against the ad-hoc way of shifting Fix12i positions down by 3 (like posAsr3) to get more range.
+// The formats only differ in their shift amounts, so their times should be the same.
+
+static_assert(sizeof(Vector3Q8) == sizeof(Vector3) && sizeof(Vector3Q20) == sizeof(Vector3));
+static_assert(std::is_trivially_copyable_v<Vector3Q8> && std::is_trivially_copyable_v<Vector3Q20>);
+
+static_assert(FixCast<Fix12i>(1._f8) == 1._f && FixCast<Fix8i>(1._f20) == 1._f8);
+static_assert(FixCast<Fix20i>(FixCast<Fix8i>(Fix20i(0x123456, as_raw))).val == 0x123000);
+static_assert(Vector3Q8(0x100000_f8, 0_f8, 0_f8).WithinDist(Vector3Q8(-0x100000_f8, 0_f8, 0_f8), 0x200000_f8));
+static_assert(!Vector3Q8(0x100000_f8, 0_f8, 0_f8).WithinDist(Vector3Q8(-0x100000_f8, 1_f8, 0_f8), 0x200000_f8));
+
+template<FixedPoint F>
+BasicVector3<F> RandomVector(std::mt19937& rng, u32 bits)
+{
+	const auto random = [&] { return F(static_cast<s32>(rng() >> (32 - bits)) - (1 << (bits - 1)), as_raw); };
+	return {random(), random(), random()};
+}
+
+template<FixedPoint F>
+u32 CheckFormat(std::mt19937& rng)
+{
+	u32 numWrong = 0;
+
+	for (u32 i = 0; i < 100000; i++)
+	{
+		// positions anywhere in the range, distances near the actual one so both answers come up
+		const BasicVector3<F> a = RandomVector<F>(rng, 31), b = RandomVector<F>(rng, rng() % 2 ? 31 : 20);
+
+		const long double dx = static_cast<long double>(a.x.val) - b.x.val;
+		const long double dy = static_cast<long double>(a.y.val) - b.y.val;
+		const long double dz = static_cast<long double>(a.z.val) - b.z.val;
+		const long double dist = std::sqrt(dx*dx + dy*dy + dz*dz);
+
+		const s32 d = static_cast<s32>(std::min<long double>(dist + static_cast<s32>(rng() % 5) - 2, 0x7fffffff));
+		const long double dd = static_cast<long double>(d) * d;
+
+		numWrong += a.WithinDist(b, F(d, as_raw)) != (dx*dx + dy*dy + dz*dz <= dd);
+		numWrong += a.HorzWithinDist(b, F(d, as_raw)) != (dx*dx + dz*dz <= dd);
+
+		// products small enough that the rounded sum fits
+		const BasicVector3<F> u = RandomVector<F>(rng, 24), v = RandomVector<F>(rng, F::fracBits + 4);
+		const s64 sum = s64(u.x.val) * v.x.val + s64(u.y.val) * v.y.val + s64(u.z.val) * v.z.val;
+		const s64 expected = static_cast<s64>(std::floor(static_cast<long double>(sum) / (1ll << F::fracBits) + 0.5L));
+
+		numWrong += u.Dot(v).val != expected;
+
+		// to a Vector3 relative to a nearby origin and back
+		const BasicVector3<F> near = a + RandomVector<F>(rng, 16 + F::fracBits - 12);
+		const Vector3 rel = near.RelativeTo(a);
+		const BasicVector3<F> back = a + BasicVector3<F>(rel);
+
+		numWrong += F::fracBits <= 12 && back != near;
+	}
+
+	return numWrong;
+}
+
+int main()
+{
+	std::mt19937 rng(0);
+
+	const u32 numWrong = CheckFormat<Fix8i>(rng) + CheckFormat<Fix12i>(rng) + CheckFormat<Fix20i>(rng);
+
+	std::printf("FixVector: %u checks failed\n", numWrong);
+
+	// how many of the positions are within a distance of an origin, with the same raw values in every format
+	constexpr u32 NUM_POSITIONS = 1024;
+
+	const auto benchmark = [&]<FixedPoint F>(const char* name, std::type_identity<F>)
+	{
+		rng.seed(1);
+		std::vector<BasicVector3<F>> positions(NUM_POSITIONS);
+
+		for (auto& pos : positions)
+			pos = RandomVector<F>(rng, 28);
+
+		const BasicVector3<F> origin = RandomVector<F>(rng, 24);
+		const F dist(static_cast<s32>(rng() >> 5), as_raw);
+
+		const double nanos = NanosPerCall(2000, [&](u32)
+		{
+			u32 numWithin = 0;
+
+			for (const auto& pos : positions)
+				numWithin += pos.WithinDist(origin, dist);
+
+			DoNotOptimize(numWithin);
+		});
+
+		std::printf("%-28s %.2f ns per WithinDist\n", name, nanos / NUM_POSITIONS);
+	};
+
+	benchmark("Vector3Q8", std::type_identity<Fix8i>());
+	benchmark("BasicVector3<Fix12i>", std::type_identity<Fix12i>());
+	benchmark("Vector3Q20", std::type_identity<Fix20i>());
+
+	// the workaround: Fix12i positions shifted down by 3, with a distance that's shifted as well
+	{
+		rng.seed(1);
+		std::vector<Vector3> positions(NUM_POSITIONS);
+
+		for (auto& pos : positions)
+			pos = static_cast<Vector3>(RandomVector<Fix12i>(rng, 28));
+
+		const Vector3 origin = static_cast<Vector3>(RandomVector<Fix12i>(rng, 28));
+		const s32 distAsr3 = static_cast<s32>(rng() >> 5) >> 3;
+
+		const double nanos = NanosPerCall(2000, [&](u32)
+		{
+			u32 numWithin = 0;
+
+			for (const Vector3& pos : positions)
+			{
+				const s32 dx = (pos.x.val >> 3) - (origin.x.val >> 3);
+				const s32 dy = (pos.y.val >> 3) - (origin.y.val >> 3);
+				const s32 dz = (pos.z.val >> 3) - (origin.z.val >> 3);
+
+				numWithin += s64(dx) * dx + s64(dy) * dy + s64(dz) * dz <= s64(distAsr3) * distAsr3;
+			}
+
+			DoNotOptimize(numWithin);
+		});
+
+		std::printf("%-28s %.2f ns per check\n", "Vector3 >> 3 (posAsr3)", nanos / NUM_POSITIONS);
+	}
+
+	return numWrong == 0 ? 0 : 1;
+}
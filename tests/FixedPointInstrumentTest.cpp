@@ -0,0 +1,252 @@
+#include "Math/FixedPoint.h"
+#include "Math/FixedPointReport.h"
+#include <cstdio>
+#include <cstring>
+
+// Checks what FIXED_POINT_INSTRUMENT counts for every instrumented operator, including the
+// products that only lose their precision when FIXED_POINT_ROUND_PRODUCTS_DOWN truncates them.
+// Then runs physics steps over a set of bodies, each part of the step under a tag of its own,
+// and prints the report of where they overflowed.
+// The test is built with FIXED_POINT_INSTRUMENT, and a second time with both macros.
+
+#ifndef FIXED_POINT_INSTRUMENT
+#error "FixedPointInstrumentTest needs FIXED_POINT_INSTRUMENT"
+#endif
+
+#ifdef FIXED_POINT_ROUND_PRODUCTS_DOWN
+constexpr bool roundDown = true;
+#else
+constexpr bool roundDown = false;
+#endif
+
+constexpr char TAG[] = "test";
+
+u32 numWrong = 0;
+
+template<class F>
+void Check(const char* name, u32 numOverflows, u32 numPrecisionLosses, F&& operation)
+{
+	FixInstrument::Reset();
+
+	{
+		FIX_INSTRUMENT_SCOPE(TAG);
+		operation();
+	}
+
+	const FixInstrument::Site& site = FixInstrument::sites[FixInstrument::FindOrAddSite(TAG)];
+
+	if (site.numOps == 0 || site.numOverflows != numOverflows || site.numPrecisionLosses != numPrecisionLosses)
+	{
+		std::printf("%s: %u ops, %u overflows (expected %u), %u precision losses (expected %u)\n", name,
+			site.numOps, site.numOverflows, numOverflows, site.numPrecisionLosses, numPrecisionLosses);
+
+		numWrong++;
+	}
+}
+
+// Keeps the operands from being known to the compiler
+template<class T>
+T Opaque(T x)
+{
+	asm volatile("" : "+r" (x.val));
+	return x;
+}
+
+s32 Opaque(s32 x)
+{
+	asm volatile("" : "+r" (x));
+	return x;
+}
+
+struct Body
+{
+	Fix12i px, py, pz;
+	Fix12i vx, vy, vz;
+};
+
+// Standing, walking, falling, launched by a cannon and thrown out of the level
+const Body BODIES[] =
+{
+	{0._f,     0._f, 0._f,      0._f,    0._f,   0._f},
+	{100._f,   0._f, -300._f,   12._f,   0._f,   -9._f},
+	{0._f,  5000._f, 0._f,      0._f,  -60._f,   0._f},
+	{0._f,     0._f, 0._f,    900._f,  400._f, 700._f},
+	{0._f,     0._f, 0._f,  60000._f,    0._f,   0._f},
+};
+
+constexpr char GRAVITY[] = "gravity";
+constexpr char DRAG[] = "drag";
+constexpr char BOOST[] = "boost";
+constexpr char INTEGRATE[] = "integrate";
+constexpr char SPEED_SQUARED[] = "speed squared";
+constexpr char SPEED_SQUARED_ASR3[] = "speed squared asr 3";
+
+// A step like the ones of the actors: the speed is compared to a limit squared, exactly and the
+// ad-hoc way of shifting the velocity down by 3 first
+bool Step(Body& b)
+{
+	{
+		FIX_INSTRUMENT_SCOPE(GRAVITY);
+		b.vy -= 2.5_f;
+	}
+	{
+		FIX_INSTRUMENT_SCOPE(DRAG);
+		b.vx = b.vx * 0.96_f;
+		b.vz = b.vz * 0.96_f;
+	}
+	{
+		FIX_INSTRUMENT_SCOPE(BOOST);
+		b.vx *= 2;
+	}
+	{
+		FIX_INSTRUMENT_SCOPE(INTEGRATE);
+		b.px += b.vx;
+		b.py += b.vy;
+		b.pz += b.vz;
+	}
+
+	bool fast, fastAsr3;
+	{
+		FIX_INSTRUMENT_SCOPE(SPEED_SQUARED);
+		fast = b.vx * b.vx + b.vy * b.vy + b.vz * b.vz > 100._f * 100._f;
+	}
+	{
+		FIX_INSTRUMENT_SCOPE(SPEED_SQUARED_ASR3);
+		const Fix12i x = b.vx >> 3, y = b.vy >> 3, z = b.vz >> 3;
+		fastAsr3 = x * x + y * y + z * z > 12.5_f * 12.5_f;
+	}
+
+	return fast || fastAsr3;
+}
+
+// Runs the steps and checks the report that was printed to a file
+void CheckReport()
+{
+	FixInstrument::Reset();
+
+	for (const Body& body : BODIES)
+	{
+		Body b = body;
+
+		for (u32 i = 0; i < 16; i++)
+			(void)Step(b);
+	}
+
+	FixInstrument::Report();
+
+	std::FILE* file = std::tmpfile();
+	if (!file)
+	{
+		numWrong++;
+		return;
+	}
+
+	FixInstrument::Report(file);
+	std::rewind(file);
+
+	char line[128];
+	u32 numRows = 0;
+	u32 prevOverflows = ~0u;
+	bool sorted = true, exactOverflowsMore = false;
+	u32 exactOverflows = 0;
+
+	const bool header = std::fgets(line, sizeof(line), file) && std::strncmp(line, "tag", 3) == 0;
+
+	while (std::fgets(line, sizeof(line), file))
+	{
+		// the tag is padded to 24 characters and may contain spaces
+		u32 numOps, numOverflows, numPrecisionLosses;
+		if (std::strlen(line) < 24 || std::sscanf(line + 24, "%u %u %u", &numOps, &numOverflows, &numPrecisionLosses) != 3)
+			break;
+
+		numRows++;
+		sorted &= numOverflows <= prevOverflows;
+		prevOverflows = numOverflows;
+
+		if (std::strncmp(line, SPEED_SQUARED_ASR3, sizeof(SPEED_SQUARED_ASR3) - 1) == 0)
+			exactOverflowsMore = exactOverflows > numOverflows && numPrecisionLosses > 0;
+		else if (std::strncmp(line, SPEED_SQUARED, sizeof(SPEED_SQUARED) - 1) == 0)
+			exactOverflows = numOverflows;
+	}
+
+	std::fclose(file);
+
+	const FixInstrument::Site* sites[FixInstrument::MAX_SITES];
+
+	if (!header || numRows != FixInstrument::SortSites(sites) || !sorted)
+	{
+		std::printf("the report isn't a sorted table of every tag\n");
+		numWrong++;
+	}
+
+	// the exact squares overflow first, so their row comes before the shifted ones
+	if (!exactOverflowsMore)
+	{
+		std::printf("the shifted speed overflows less than the exact one and loses precision\n");
+		numWrong++;
+	}
+
+	const FixInstrument::Site& boost = FixInstrument::sites[FixInstrument::FindOrAddSite(BOOST)];
+	if (boost.numOverflows == 0)
+	{
+		std::printf("a *= n of the thrown body overflows\n");
+		numWrong++;
+	}
+}
+
+int main()
+{
+	const Fix12i one = Opaque(Fix12i(1, as_raw));
+	const Fix12i half = Opaque(Fix12i(0x800, as_raw));
+
+	Check("a * b, tiny", 0, 1, [&] { (void)(one * one); });
+	Check("a * b, rounds up to 1", 0, roundDown, [&] { (void)(half * one); });
+	Check("a * b, overflow", 1, 0, [&] { (void)(Opaque(Fix12i::max) * Opaque(2._f)); });
+
+	Check("a + b", 1, 0, [&] { (void)(Opaque(Fix12i::max) + one); });
+	Check("a - b", 1, 0, [&] { (void)(Opaque(Fix12i::min) - one); });
+	Check("-a", 1, 0, [&] { (void)(-Opaque(Fix12i::min)); });
+	Check("-a, s16", 0, 0, [&] { (void)(-Opaque(Fix12s::min)); });
+
+	Check("a += b", 1, 0, [&] { Fix12s f = Opaque(Fix12s::max); f += Fix12s(1, as_raw); });
+	Check("a -= b", 1, 0, [&] { Fix12s f = Opaque(Fix12s::min); f -= Fix12s(1, as_raw); });
+	Check("a += n", 1, 0, [&] { Fix12i f = Opaque(Fix12i::max); f += 1; });
+	Check("a += b, fits", 0, 0, [&] { Fix12i f = Opaque(Fix12i(Fix12s::max)); f += Fix12s(1, as_raw); });
+
+	Check("a << i", 1, 0, [&] { (void)(Opaque(Fix12i(0x40000000, as_raw)) << Opaque(1)); });
+	Check("a <<= i", 1, 0, [&] { Fix12s f = Opaque(Fix12s(0x4000, as_raw)); f <<= Opaque(1); });
+	Check("a <<= i, fits", 0, 0, [&] { Fix12i f = Opaque(Fix12i(0x4000, as_raw)); f <<= Opaque(1); });
+
+	Check("a >> i", 0, 1, [&] { (void)(Opaque(Fix12i(3, as_raw)) >> Opaque(1)); });
+	Check("a >>= i", 0, 1, [&] { Fix12i f = Opaque(Fix12i(3, as_raw)); f >>= Opaque(1); });
+	Check("a >>= i, exact", 0, 0, [&] { Fix12i f = Opaque(Fix12i(4, as_raw)); f >>= Opaque(2); });
+
+	Check("n * a", 1, 0, [&] { (void)(Opaque(0x10000) * Opaque(Fix12i(0x10000, as_raw))); });
+	Check("a * n", 1, 0, [&] { (void)(Opaque(Fix12i(0x10000, as_raw)) * Opaque(0x10000)); });
+	Check("a * n, fits", 0, 0, [&] { (void)(Opaque(Fix12i(0x100, as_raw)) * Opaque(0x100)); });
+	Check("a *= n", 1, 0, [&] { Fix12s f = Opaque(Fix12s(0x4000, as_raw)); f *= Opaque(2); });
+	Check("a *= n, fits", 0, 0, [&] { Fix12i f = Opaque(Fix12i(0x4000, as_raw)); f *= Opaque(2); });
+
+	// shifts by 31 and more, which the operators themselves can't be given
+	Check("shift right by 31", 0, 0, [] { FixInstrument::RecordShiftRight(std::numeric_limits<s32>::min(), 31); });
+	Check("shift right by 31, loss", 0, 1, [] { FixInstrument::RecordShiftRight(std::numeric_limits<s32>::min() + 1, 31); });
+	Check("shift right by 32", 0, 1, [] { FixInstrument::RecordShiftRight(std::numeric_limits<s32>::min(), 32); });
+	Check("shift right by 40", 0, 0, [] { FixInstrument::RecordShiftRight(0, 40); });
+	Check("shift left by 40", 1, 0, [] { FixInstrument::RecordShiftLeft(1, 40); });
+	Check("shift left by 40, zero", 0, 0, [] { FixInstrument::RecordShiftLeft(0, 40); });
+
+	// constant evaluation is never counted
+	FixInstrument::Reset();
+	{
+		FIX_INSTRUMENT_SCOPE(TAG);
+		constexpr Fix12i folded = (Fix12i(1, as_raw) * Fix12i(1, as_raw)) >> 1;
+		(void)folded;
+	}
+	numWrong += FixInstrument::sites[FixInstrument::FindOrAddSite(TAG)].numOps != 0;
+
+	CheckReport();
+
+	std::printf("FixedPointInstrument%s: %u checks failed\n", roundDown ? " (products rounded down)" : "", numWrong);
+
+	return numWrong == 0 ? 0 : 1;
+}
@@ -0,0 +1,121 @@
+#include "Math/FixedPoint.h"
+#include "Benchmark.h"
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// Checks that Fix multiplication without the ARM asm is bit-exact with the movs/adc sequence,
+// emulated below, and benchmarks it against truncation. The test is built a second time with
+// FIXED_POINT_ROUND_PRODUCTS_DOWN, where operator* must truncate instead.
+
+// movs rs, lo, lsr #q puts the last bit shifted out into the carry, adc rs, rs, hi, lsl #(32 - q) adds it
+template<s32 q>
+constexpr s32 EmulateAsm(s32 a, s32 b)
+{
+	const u64 product = static_cast<s64>(a) * b;
+	const u32 lo = static_cast<u32>(product);
+	const u32 hi = static_cast<u32>(product >> 32);
+
+	return static_cast<s32>((lo >> q) + (hi << (32 - q)) + (lo >> (q - 1) & 1));
+}
+
+template<s32 q>
+constexpr s32 Truncate(s32 a, s32 b)
+{
+	return static_cast<s32>(static_cast<s64>(a) * b >> q);
+}
+
+template<s32 q>
+constexpr s32 Expected(s32 a, s32 b)
+{
+#ifdef FIXED_POINT_ROUND_PRODUCTS_DOWN
+	return Truncate<q>(a, b);
+#else
+	return EmulateAsm<q>(a, b);
+#endif
+}
+
+template<class F, class G = F>
+constexpr bool Matches(s32 a, s32 b)
+{
+	const s32 product = (F(a, as_raw) * G(b, as_raw)).val;
+
+	return product == Expected<F::fracBits>(a, b);
+}
+
+// operator* is constexpr, and constant evaluation takes the same path
+static_assert(Matches<Fix12i>(0x1800, 0x1800));
+static_assert(Matches<Fix12i>(1, 0x800));
+static_assert(Matches<Fix12i>(-1, 0x800));
+static_assert(Matches<Fix12i>(-0x7fffffff, 0x7fffffff));
+static_assert(Matches<Fix20i>(0x123456, -0x654321));
+
+// Every pair of Fix12s, which covers every low word of a product that fits in 32 bits
+u32 CheckAllFix12s()
+{
+	u32 numWrong = 0;
+
+	for (s32 a = -0x8000; a < 0x8000; a++)
+		for (s32 b = -0x8000; b < 0x8000; b++)
+			numWrong += !Matches<Fix12s>(a, b);
+
+	return numWrong;
+}
+
+// Operands of every magnitude, so that the products cover the high word and the sign
+s32 RandomOperand(std::mt19937& rng)
+{
+	const u32 bits = 1 + rng() % 32;
+	const s32 res = static_cast<s32>(rng() >> (32 - bits));
+
+	return rng() % 2 ? -res : res;
+}
+
+template<template<FixUR> class CRTP>
+u32 CheckRandom(u32 numPairs, std::mt19937& rng)
+{
+	u32 numWrong = 0;
+
+	for (u32 i = 0; i < numPairs; i++)
+	{
+		const s32 a = RandomOperand(rng);
+		const s32 b = RandomOperand(rng);
+
+		numWrong += !Matches<CRTP<s32>>(a, b) + !Matches<CRTP<s32>, CRTP<s16>>(a, static_cast<s16>(b));
+	}
+
+	return numWrong;
+}
+
+int main()
+{
+	std::mt19937 rng(0);
+
+	u32 numWrong = CheckAllFix12s();
+	numWrong += CheckRandom<Fix12>(10'000'000, rng);
+	numWrong += CheckRandom<Fix8>(2'000'000, rng);
+	numWrong += CheckRandom<Fix20>(2'000'000, rng);
+
+	std::printf("Fix multiplication: %u wrong products\n", numWrong);
+
+	std::vector<Fix12i> a(0x1000), b(0x1000);
+
+	for (u32 i = 0; i < a.size(); i++)
+	{
+		a[i] = Fix12i(RandomOperand(rng) >> 8, as_raw);
+		b[i] = Fix12i(RandomOperand(rng) >> 8, as_raw);
+	}
+
+	const u32 mask = a.size() - 1;
+	Fix12i sum = 0._f;
+
+	const double operatorNanos = NanosPerCall(50'000'000, [&](u32 i) { sum += a[i & mask] * b[i & mask]; });
+	DoNotOptimize(sum);
+
+	const double truncateNanos = NanosPerCall(50'000'000, [&](u32 i) { sum.val += Truncate<12>(a[i & mask].val, b[i & mask].val); });
+	DoNotOptimize(sum);
+
+	std::printf("operator*: %.2f ns, truncating: %.2f ns\n", operatorNanos, truncateNanos);
+
+	return numWrong == 0 ? 0 : 1;
+}
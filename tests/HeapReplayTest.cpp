@@ -0,0 +1,163 @@
+#include "Memory/HeapModel.h"
+#include <cstdio>
+#include <vector>
+
+// HeapModel against hand-checked layouts (merging, backwards allocation, best fit, compaction), and HeapReplay
+// run more than once with the same object: every run must report only its own failures and
+// statistics, so that a tool can replay a trace against several heap sizes in a loop.
+
+namespace HeapReplayTest
+{
+	u32 numWrong = 0;
+
+	void Expect(bool ok, const char* what)
+	{
+		if (!ok)
+		{
+			std::printf("%s\n", what);
+			numWrong++;
+		}
+	}
+
+	void CheckModel()
+	{
+		HeapModel heap(0x1000);
+
+		const u32 a = heap.Allocate(0x100, 4);
+		const u32 b = heap.Allocate(0x100, 4);
+		const u32 c = heap.Allocate(0x100, -4);
+
+		Expect(a == HeapModel::NODE_SIZE && b == a + 0x100 + HeapModel::NODE_SIZE, "forwards allocations are placed one after another");
+		Expect(c == 0x1000 - 0x100, "a backwards allocation is placed at the end");
+		Expect(heap.MemoryLeft() == 0x1000 - 3 * 0x110 - HeapModel::NODE_SIZE, "every block takes a node");
+
+		heap.Deallocate(a);
+		heap.Deallocate(b);
+		Expect(heap.FreeBlocks().size() == 1 && heap.FreeBlocks()[0].end == c - HeapModel::NODE_SIZE, "freed neighbours are merged");
+
+		heap.Deallocate(c);
+		Expect(heap.FreeBlocks().size() == 1 && heap.MaxAllocatableSize() == 0x1000 - HeapModel::NODE_SIZE, "everything is merged again");
+		Expect(heap.Fragmentation() == 0.f, "one free block isn't fragmented");
+
+		// holes of 0x40 and 0x80 bytes, best fit takes the smaller one for 0x30 bytes
+		HeapModel best(0x1000, HeapModel::BEST_FIT);
+		const u32 big = best.Allocate(0x80, 4);
+		best.Allocate(0x10, 4);
+		const u32 small = best.Allocate(0x40, 4);
+		best.Allocate(0x10, 4);
+		best.Deallocate(big);
+		best.Deallocate(small);
+
+		Expect(best.Allocate(0x30, 4) == small, "best fit takes the smallest hole");
+		Expect(best.Fragmentation() > 0.f, "holes are fragmentation");
+	}
+
+	// A file with a small hole before it and two holes above it that fit it, but are smaller than the
+	// hole the file leaves when it's freed together with the one before it (one of them for the
+	// temporary block of the bounce)
+	void CheckCompact(HeapModel::AllocationMode mode, bool movesDown)
+	{
+		HeapModel heap(0x1000, mode);
+		const u32 before = heap.Allocate(0x40, 4);
+		const u32 file = heap.Allocate(0x100, 4);
+		heap.Allocate(0x10, 4);
+		const u32 above = heap.Allocate(0x110, 4);
+		heap.Allocate(0x10, 4);
+		const u32 above2 = heap.Allocate(0x120, 4);
+		heap.Allocate(0x10, 4);
+		heap.Deallocate(before);
+		heap.Deallocate(above);
+		heap.Deallocate(above2);
+
+		u32 moved = file;
+		const u32 movable[] = {file};
+		heap.Compact(movable, [&](u32, u32 newData) { moved = newData; });
+
+		Expect(moved <= file, "compaction never moves a block up");
+		Expect((moved == before) == movesDown, movesDown ? "first fit slides the block into the hole before it" :
+			"the block stays where it is if the heap might not take the hole before it");
+	}
+
+	std::vector<HeapTraceEvent> Trace(u32 bigSize)
+	{
+		// two allocations, one of them too big for the heap, then their deallocations
+		return
+		{
+			{HeapTraceEvent::ALLOCATE,   0, 1, 4, 0x200, 0},
+			{HeapTraceEvent::ALLOCATE,   0, 1, 4, bigSize, 0},
+			{HeapTraceEvent::REALLOCATE, 0, 1, 4, 0x100, 0},
+			{HeapTraceEvent::DEALLOCATE, 0, 1, 4, 0, 1},
+			{HeapTraceEvent::DEALLOCATE, 0, 1, 4, 0, 0},
+		};
+	}
+
+	void CheckReplay()
+	{
+		std::vector<HeapModel> heaps = {HeapModel(0x1000)};
+		HeapReplay replay(heaps);
+
+		const std::vector<HeapTraceEvent> failing = Trace(0x2000);
+		const std::vector<HeapTraceEvent> fitting = Trace(0x400);
+
+		Expect(!replay.Run(failing), "the big allocation fails");
+		Expect(replay.Failures().size() == 1 && replay.Failures()[0].event == 1, "the failure is reported");
+
+		const HeapReplay::HeapStats first = replay.Stats(0);
+		Expect(first.maxUsed == 0x210 + HeapModel::NODE_SIZE, "only the small block was used"); // and the free block's node
+
+		// the same trace on a fresh heap gives the same results instead of adding to them
+		heaps[0] = HeapModel(0x1000);
+		Expect(!replay.Run(failing), "the big allocation fails again");
+		Expect(replay.Failures().size() == 1, "only this run's failures are reported");
+		Expect(replay.Stats(0).maxUsed == first.maxUsed && replay.Stats(0).minMaxAllocatableSize == first.minMaxAllocatableSize,
+			"only this run's statistics are reported");
+
+		heaps[0] = HeapModel(0x1000);
+		Expect(replay.Run(fitting), "a trace that fits succeeds after one that didn't");
+		Expect(replay.Failures().empty(), "no failures are left over");
+		Expect(replay.Stats(0).maxUsed == 0x210 + 0x410 + HeapModel::NODE_SIZE, "the statistics are of this trace");
+	}
+
+	void CheckRejects()
+	{
+		std::vector<HeapModel> heaps = {HeapModel(0x1000)};
+		HeapReplay replay(heaps);
+
+		// the events of a truncated or foreign trace are skipped, the others still replay
+		std::vector<HeapTraceEvent> trace = Trace(0x400);
+		trace.push_back({HeapTraceEvent::ALLOCATE, 1, 1, 4, 0x10, 0});     // a heap that wasn't passed
+		trace.push_back({HeapTraceEvent::DEALLOCATE, 0, 1, 4, 0, 100});    // past the end of the trace
+		trace.push_back({HeapTraceEvent::DEALLOCATE, 0, 1, 4, 0, 2});      // not an ALLOCATE
+		trace.push_back({HeapTraceEvent::ALLOCATE, 0, 1, 4, 0x10, 0});
+		trace.push_back({HeapTraceEvent::DEALLOCATE, 0, 1, 4, 0, 9});      // not an earlier event
+
+		u32 numEvents = 0;
+		Expect(!replay.Run(trace, [&](std::size_t, std::span<HeapModel>) { numEvents++; }), "a trace with rejected events doesn't succeed");
+		Expect(replay.NumRejected() == 4, "the rejected events are counted");
+		Expect(numEvents == trace.size() - 4, "onEvent isn't called for rejected events");
+		Expect(replay.Failures().empty() && replay.Address(8) != 0, "the valid events are replayed");
+
+		heaps[0] = HeapModel(0x1000);
+		Expect(replay.Run(Trace(0x400)) && replay.NumRejected() == 0, "the rejects of a run aren't left over");
+	}
+
+	u32 Run()
+	{
+		CheckModel();
+		CheckCompact(HeapModel::FIRST_FIT, true);
+		CheckCompact(HeapModel::BEST_FIT, false);
+		CheckCompact(HeapModel::SEGREGATED_FIT, false);
+		CheckReplay();
+		CheckRejects();
+
+		return numWrong;
+	}
+}
+
+int main()
+{
+	const u32 numWrong = HeapReplayTest::Run();
+	std::printf("HeapReplay: %u checks failed\n", numWrong);
+
+	return numWrong == 0 ? 0 : 1;
+}
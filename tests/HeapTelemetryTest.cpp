@@ -0,0 +1,214 @@
+#include "Math/MathCommon.h"
+#include <cstdio>
+
+// HeapTelemetry on synthetic heaps: the game's heap structures are declared here with the members
+// HeapTelemetry reads, and free lists are laid out by hand, so that the fragmentation and usage can
+// be checked against values worked out on paper (including heaps bigger than 4 MB, where
+// largestFree * 1000 doesn't fit into 32 bits).
+
+struct MemoryNode
+{
+	enum Flags : u16
+	{
+		NODE_ID = 0xff << 0,
+	};
+
+	char magic[2];
+	u16 flags;
+	u32 size;
+	MemoryNode* prev;
+	MemoryNode* next;
+};
+
+struct ExpandingHeapAllocator
+{
+	void* heapStart;
+	void* heapEnd;
+	MemoryNode* firstFreeBlock;
+	MemoryNode* firstAllocatedBlock;
+};
+
+struct SolidHeapAllocator
+{
+	void* heapStart;
+	void* heapEnd;
+	void* freeBlockBegin;
+	void* freeBlockEnd;
+};
+
+struct ExpandingHeap
+{
+	ExpandingHeapAllocator* allocator;
+};
+
+namespace Memory
+{
+	ExpandingHeap* rootHeapPtr = nullptr;
+	ExpandingHeap* gameHeapPtr = nullptr;
+	SolidHeapAllocator** soundHeapAllocatorPtrPtr = nullptr;
+}
+
+struct ostream
+{
+	const ostream& operator<<(const char* str) const { std::printf("%s", str); return *this; }
+	const ostream& operator<<(u32 val) const { std::printf("%u", val); return *this; }
+};
+
+#include "Memory/HeapTelemetry.h"
+
+namespace HeapTelemetryTest
+{
+	using namespace HeapTelemetry;
+
+	u32 numWrong = 0;
+
+	void Expect(bool ok, const char* what)
+	{
+		if (!ok)
+		{
+			std::printf("%s\n", what);
+			numWrong++;
+		}
+	}
+
+	// A heap of the given size (only its bounds are used) whose free list has blocks of the given sizes
+	struct SyntheticHeap
+	{
+		static constexpr u32 MAX_NODES = 8;
+
+		MemoryNode nodes[MAX_NODES] = {};
+		ExpandingHeapAllocator allocator = {};
+
+		SyntheticHeap(u32 size, std::initializer_list<u32> freeSizes)
+		{
+			allocator.heapStart = nullptr;
+			allocator.heapEnd = static_cast<u8*>(nullptr) + size;
+
+			u32 i = 0;
+			for (const u32 freeSize : freeSizes)
+			{
+				nodes[i].size = freeSize;
+				nodes[i].next = i + 1 < freeSizes.size() ? &nodes[i + 1] : nullptr;
+				i++;
+			}
+
+			allocator.firstFreeBlock = freeSizes.size() ? nodes : nullptr;
+		}
+	};
+
+	void CheckFragmentation()
+	{
+		Expect(Usage::Fragmentation(0, 0) == 0, "a full heap isn't fragmented");
+		Expect(Usage::Fragmentation(0x20, 0x20) == 0, "a single small free block isn't fragmented");
+		Expect(Usage::Fragmentation(0x2000, 0x2000) == 0, "a single free block isn't fragmented");
+		Expect(Usage::Fragmentation(0x2000, 0x1000) == 500, "two equal blocks are half fragmented");
+		Expect(Usage::Fragmentation(0x30, 0x10) == 667, "three small equal blocks");
+		Expect(Usage::Fragmentation(0x800000, 0x800000) == 0, "a single free block of 8 MB isn't fragmented");
+		Expect(Usage::Fragmentation(0x800000, 0x200000) == 750, "a quarter of 8 MB in the largest block");
+	}
+
+	void CheckMeasure()
+	{
+		const SyntheticHeap one(0x3b000, {0x20000});
+		const Usage oneUsage = Measure(one.allocator);
+
+		Expect(oneUsage.size == 0x3b000 && oneUsage.numFreeBlocks == 1 && oneUsage.largestFree == 0x20000, "one free block is measured");
+		Expect(oneUsage.used == 0x3b000 - 0x20000 - sizeof(MemoryNode), "the free block's node is used memory");
+		Expect(oneUsage.fragmentation == 0, "one free block has no fragmentation");
+
+		const SyntheticHeap holes(0x3b000, {0x100, 0x400, 0x300, 0x200});
+		const Usage holesUsage = Measure(holes.allocator);
+
+		Expect(holesUsage.numFreeBlocks == 4 && holesUsage.largestFree == 0x400, "every free block is counted");
+		Expect(holesUsage.used == 0x3b000 - 0xa00 - 4 * sizeof(MemoryNode), "the used memory includes the free nodes");
+		Expect(holesUsage.fragmentation == 600, "0x400 of 0xa00 free bytes are in the largest block");
+
+		const SyntheticHeap big(0x1000000, {0x600000, 0x200000});
+		Expect(Measure(big.allocator).fragmentation == 250, "heaps bigger than 4 MB don't overflow");
+
+		u8 sound[0x100];
+		const SolidHeapAllocator solid = {sound, sound + 0x100, sound + 0x40, sound + 0xc0};
+		const Usage solidUsage = Measure(solid);
+
+		Expect(solidUsage.largestFree == 0x80 && solidUsage.used == 0x80 && solidUsage.fragmentation == 0, "a solid heap has one free block");
+	}
+
+	void CheckNodeIDs()
+	{
+		// allocated blocks of the node IDs 1, 2, 1, 3
+		MemoryNode nodes[4] = {};
+		const u16 ids[] = {1, 2, 1, 3};
+
+		for (u32 i = 0; i < 4; i++)
+		{
+			nodes[i].flags = ids[i];
+			nodes[i].size = 0x100 * (i + 1);
+			nodes[i].next = i + 1 < 4 ? &nodes[i + 1] : nullptr;
+		}
+
+		ExpandingHeapAllocator allocator = {};
+		allocator.firstAllocatedBlock = nodes;
+
+		NodeIDUsage res[2] = {};
+		NodeIDUsage others = {0xff, 7, 7};
+
+		Expect(MeasureByNodeID(allocator, res, &others) == 2, "two IDs fit");
+		Expect(res[0].nodeID == 1 && res[0].numBlocks == 2 && res[0].bytes == 0x400 + 2 * sizeof(MemoryNode), "the blocks of an ID are summed");
+		Expect(res[1].nodeID == 2 && res[1].numBlocks == 1, "IDs are in the order they're encountered");
+		Expect(others.numBlocks == 1 && others.bytes == 0x400 + sizeof(MemoryNode) && others.nodeID == 0xff, "the ID that doesn't fit is counted separately");
+
+		Expect(MeasureByNodeID(allocator, {}, &others) == 0 && others.numBlocks == 4, "without entries, every block is another");
+		Expect(MeasureByNodeID(allocator, {}) == 0, "without entries and others, nothing is written");
+	}
+
+	void CheckRecorder()
+	{
+		SyntheticHeap game(0x3b000, {0x10000});
+		ExpandingHeap gameHeap = {&game.allocator};
+		Memory::gameHeapPtr = &gameHeap;
+
+		Recorder<4> recorder;
+		Expect(Measure(ROOT).size == 0 && Measure(SOUND).size == 0, "missing heaps are measured as empty");
+
+		recorder.Sample(1);
+
+		game.nodes[0].size = 0x8000;
+		game.nodes[0].next = &game.nodes[1];
+		game.nodes[1].size = 0x8000;
+		recorder.Sample(2);
+
+		game.nodes[0].next = nullptr;
+		game.nodes[0].size = 0x20000;
+		recorder.Sample(3);
+
+		const Recorder<4>::HighWaterMarks& marks = recorder.Marks();
+		Expect(marks.maxUsed[GAME] == 0x3b000 - 0x10000 - sizeof(MemoryNode), "the highest usage is kept");
+		Expect(marks.minLargestFree[GAME] == 0x8000, "the smallest largest block is kept");
+		Expect(marks.maxFragmentation[GAME] == 500, "the worst fragmentation is kept");
+		Expect(recorder.NumRecords() == 3 && recorder.GetRecord(0).frame == 3 && recorder.GetRecord(0).largestFree[GAME] == 0x20000,
+			"the most recent record comes first");
+
+		recorder.OnLevelChange();
+		Expect(recorder.Marks().maxFragmentation[GAME] == 0, "a new level starts with new marks");
+
+		Memory::gameHeapPtr = nullptr;
+	}
+
+	u32 Run()
+	{
+		CheckFragmentation();
+		CheckMeasure();
+		CheckNodeIDs();
+		CheckRecorder();
+
+		return numWrong;
+	}
+}
+
+int main()
+{
+	const u32 numWrong = HeapTelemetryTest::Run();
+	std::printf("HeapTelemetry: %u checks failed\n", numWrong);
+
+	return numWrong == 0 ? 0 : 1;
+}
@@ -0,0 +1,173 @@
+#include "Formats/LZ16Compressor.h"
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+// Round trips of LZ16::Compress through both decompressors, and a benchmark of LZ16::Decompress
+// against the byte-at-a-time reference. The benchmark runs on the host, so it only compares the
+// two decompressors relative to each other; the ARM9 has different costs for unaligned and byte
+// accesses.
+
+namespace LZ16Test
+{
+	// Data that compresses in different ways: noise, runs, short repeated patterns, a small alphabet
+	inline std::vector<u8> MakeInput(std::mt19937& rng)
+	{
+		const u32 size = std::uniform_int_distribution<u32>(0, 0x3000)(rng);
+		const u32 kind = rng() % 4;
+
+		std::vector<u8> res;
+		res.reserve(size);
+
+		while (res.size() < size)
+		{
+			switch (kind)
+			{
+				case 0:
+					res.push_back(rng());
+					break;
+
+				case 1:
+					res.insert(res.end(), 1 + rng() % 40, static_cast<u8>(rng()));
+					break;
+
+				case 2:
+					if (res.size() > 8 && rng() % 2 == 0)
+					{
+						const u32 distance = 1 + rng() % std::min<u32>(res.size(), LZ16::MAX_DISTANCE + 8);
+						const u32 length = 1 + rng() % 24;
+
+						for (u32 i = 0; i < length; i++)
+							res.push_back(res[res.size() - distance]);
+					}
+					else
+						res.push_back(rng());
+					break;
+
+				default:
+					res.push_back("\0\0\x10\x10\xff"[rng() % 5]);
+					break;
+			}
+		}
+
+		res.resize(size);
+		return res;
+	}
+
+	// Decompresses with both decompressors at every alignment of the source and the destination,
+	// and checks the output and that nothing after it was written
+	inline bool RoundTrip(std::span<const u8> data, const LZ16::CompressOptions& options)
+	{
+		static constexpr u8 GUARD = 0xa5;
+
+		const std::vector<u8> compressed = LZ16::Compress(data, options);
+
+		for (u32 srcOffset = 0; srcOffset < 4; srcOffset++)
+		{
+			std::vector<u8> source(compressed.size() + 8);
+			std::copy(compressed.begin(), compressed.end(), source.begin() + srcOffset);
+
+			for (u32 dstOffset = 0; dstOffset < 4; dstOffset++)
+			{
+				for (auto decompress : {&LZ16::Decompress, &LZ16::DecompressReference})
+				{
+					std::vector<u8> dest(data.size() + 8, GUARD);
+					const u32 size = decompress(source.data() + srcOffset, dest.data() + dstOffset);
+
+					if (size != data.size() || !std::equal(data.begin(), data.end(), dest.begin() + dstOffset))
+						return false;
+
+					if (std::any_of(dest.begin() + dstOffset + size, dest.end(), [](u8 b) { return b != GUARD; }))
+						return false;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	// Returns the number of inputs that failed to round trip
+	inline u32 Fuzz(u32 numInputs, u32 seed = 0)
+	{
+		std::mt19937 rng(seed);
+		u32 numFailed = 0;
+
+		for (u32 i = 0; i < numInputs; i++)
+		{
+			const std::vector<u8> input = MakeInput(rng);
+
+			const LZ16::CompressOptions options
+			{
+				.optimal = i % 2 == 0,
+				.magic = i % 3 != 0,
+				.vramSafe = i % 5 == 0,
+			};
+
+			if (!RoundTrip(input, options))
+				numFailed++;
+		}
+
+		return numFailed;
+	}
+
+	struct BenchmarkResult
+	{
+		u32 size = 0;
+		u32 greedySize = 0;      // compressed, with the magic and the padding
+		u32 optimalSize = 0;
+		double referenceMBps = 0; // DecompressReference
+		double fastMBps = 0;      // LZ16::Decompress
+	};
+
+	inline BenchmarkResult Benchmark(std::span<const u8> data, u32 iterations)
+	{
+		using Clock = std::chrono::steady_clock;
+
+		BenchmarkResult res;
+		res.size = data.size();
+		res.greedySize = LZ16::Compress(data, {.optimal = false}).size();
+
+		const std::vector<u8> compressed = LZ16::Compress(data);
+		res.optimalSize = compressed.size();
+
+		std::vector<u8> dest(data.size());
+
+		const auto measure = [&](auto decompress)
+		{
+			const auto start = Clock::now();
+
+			for (u32 i = 0; i < iterations; i++)
+				decompress(compressed.data(), dest.data());
+
+			const std::chrono::duration<double> seconds = Clock::now() - start;
+			return seconds.count() > 0 ? data.size() * static_cast<double>(iterations) / seconds.count() / 1e6 : 0;
+		};
+
+		res.referenceMBps = measure(&LZ16::DecompressReference);
+		res.fastMBps = measure(&LZ16::Decompress);
+
+		return res;
+	}
+}
+
+int main()
+{
+	const u32 numFailed = LZ16Test::Fuzz(300);
+	std::printf("LZ16 round trips: %u of 300 failed\n", numFailed);
+
+	std::mt19937 rng(1);
+	std::vector<u8> file;
+
+	while (file.size() < 0x40000)
+	{
+		const std::vector<u8> part = LZ16Test::MakeInput(rng);
+		file.insert(file.end(), part.begin(), part.end());
+	}
+
+	const LZ16Test::BenchmarkResult res = LZ16Test::Benchmark(file, 20);
+
+	std::printf("%u bytes: greedy %u, optimal %u, reference %.1f MB/s, fast %.1f MB/s\n",
+		res.size, res.greedySize, res.optimalSize, res.referenceMBps, res.fastMBps);
+
+	return numFailed == 0 && res.optimalSize <= res.greedySize ? 0 : 1;
+}
@@ -0,0 +1,116 @@
+#include "Math/MathPipeline.h"
+#include "MathUnitModel.h"
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// Checks that MathPipeline gives the same results as the synchronous functions and keeps an
+// operation that was started before it, and counts the cycles both take on MathUnitModel with
+// different amounts of CPU work per job.
+
+struct Job
+{
+	Fix12i numerator;
+	Fix12i denominator;
+	Fix12i radicand;
+	bool inverse;
+};
+
+struct Results
+{
+	std::vector<Fix12i> quotients;
+	std::vector<Fix12i> roots;
+	u64 cycles;
+	u64 stalledCycles;
+};
+
+Results RunSync(const std::vector<Job>& jobs, u32 workCycles)
+{
+	Results res = {std::vector<Fix12i>(jobs.size()), std::vector<Fix12i>(jobs.size())};
+	MathUnitModel::Reset();
+
+	for (std::size_t i = 0; i < jobs.size(); i++)
+	{
+		res.quotients[i] = jobs[i].inverse ? jobs[i].denominator.Inverse() : HardwareDivQ12(jobs[i].numerator, jobs[i].denominator);
+		res.roots[i] = Sqrt(jobs[i].radicand);
+		MathUnitModel::Spend(workCycles);
+	}
+
+	res.cycles = MathUnitModel::clock;
+	res.stalledCycles = MathUnitModel::stalledCycles;
+	return res;
+}
+
+template<u32 capacity>
+Results RunPipelined(const std::vector<Job>& jobs, u32 workCycles)
+{
+	Results res = {std::vector<Fix12i>(jobs.size()), std::vector<Fix12i>(jobs.size())};
+	MathUnitModel::Reset();
+
+	MathPipeline<capacity> pipeline;
+
+	for (std::size_t i = 0; i < jobs.size(); i++)
+	{
+		if (jobs[i].inverse)
+			pipeline.Inverse(jobs[i].denominator, res.quotients[i]);
+		else
+			pipeline.Div(jobs[i].numerator, jobs[i].denominator, res.quotients[i]);
+
+		pipeline.Sqrt(jobs[i].radicand, res.roots[i]);
+
+		if (pipeline.Full())
+			pipeline.Run([&](u32) { MathUnitModel::Spend(workCycles); });
+	}
+
+	pipeline.Run([&](u32) { MathUnitModel::Spend(workCycles); });
+
+	res.cycles = MathUnitModel::clock;
+	res.stalledCycles = MathUnitModel::stalledCycles;
+	return res;
+}
+
+int main()
+{
+	std::mt19937 rng(0);
+	std::vector<Job> jobs(256);
+
+	for (Job& job : jobs)
+	{
+		job.numerator = Fix12i(static_cast<s32>(rng() >> 8) - (1 << 23), as_raw);
+		job.denominator = Fix12i(static_cast<s32>(rng() >> 12 | 1) * (rng() & 1 ? 1 : -1), as_raw);
+		job.radicand = Fix12i(static_cast<s32>(rng() >> 1), as_raw);
+		job.inverse = rng() & 1;
+	}
+
+	u32 numWrong = 0;
+
+	std::printf("%zu jobs, cycles of the bus clock (stalled):\n", jobs.size());
+
+	for (const u32 workCycles : {0u, 8u, 16u, 32u, 64u})
+	{
+		const Results sync = RunSync(jobs, workCycles);
+		const Results pipelined = RunPipelined<32>(jobs, workCycles);
+
+		numWrong += sync.quotients != pipelined.quotients || sync.roots != pipelined.roots;
+		numWrong += pipelined.cycles > sync.cycles;
+
+		std::printf("work %2u: sync %6llu (%6llu), pipelined %6llu (%6llu)\n", workCycles,
+			static_cast<unsigned long long>(sync.cycles), static_cast<unsigned long long>(sync.stalledCycles),
+			static_cast<unsigned long long>(pipelined.cycles), static_cast<unsigned long long>(pipelined.stalledCycles));
+	}
+
+	// a division started before the pipeline still has its result afterwards
+	MathUnitModel::Reset();
+	HardwareDivAsync(3._f, 2._f);
+
+	Fix12i res;
+	MathPipeline<4> pipeline;
+	pipeline.Div(1._f, 3._f, res);
+	pipeline.Run();
+
+	numWrong += HardwareDivResultQ12() != 1.5_f;
+
+	std::printf("MathPipeline: %u checks failed\n", numWrong);
+
+	return numWrong == 0 ? 0 : 1;
+}
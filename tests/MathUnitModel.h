@@ -0,0 +1,151 @@
+#pragma once
+
+#include "Math.h"
+#include "NDSCore.h"
+
+// Host emulation of the hardware divider and square root unit, with the functions of the game
+// that use them. Every operation finishes a fixed number of cycles after it's started, and
+// reading a result before that stalls the clock until it's ready, so that a benchmark can count
+// how many cycles the CPU waits for the units. The CPU work in between is added with Spend.
+//
+// The latencies are those of GBATEK for the modes the game uses (64/32 division, 64 bit square
+// root), in cycles of the 33 MHz bus clock; accessing the registers is counted as 1 cycle each.
+// Include this header in one translation unit per test.
+
+namespace MathUnitModel
+{
+	constexpr u64 DIV_LATENCY  = 34;
+	constexpr u64 SQRT_LATENCY = 13;
+	constexpr u64 REGISTER_ACCESS = 1;
+
+	struct Unit
+	{
+		u64 param0;
+		u64 param1;
+		u64 readyAt;
+	};
+
+	inline u64 clock = 0;
+	inline u64 stalledCycles = 0;
+	inline Unit divider = {};
+	inline Unit sqrtUnit = {};
+
+	inline void Spend(u64 cycles) { clock += cycles; }
+
+	inline void Reset()
+	{
+		clock = 0;
+		stalledCycles = 0;
+		divider = {};
+		sqrtUnit = {};
+	}
+
+	// Writing the parameters restarts the operation
+	inline void Start(Unit& unit, u64 param0, u64 param1, u64 latency)
+	{
+		Spend(REGISTER_ACCESS * 2);
+		unit = {param0, param1, clock + latency};
+	}
+
+	inline void Wait(const Unit& unit)
+	{
+		if (clock < unit.readyAt)
+		{
+			stalledCycles += unit.readyAt - clock;
+			clock = unit.readyAt;
+		}
+
+		Spend(REGISTER_ACCESS);
+	}
+
+	// DIV_RESULT in 64/32 mode, with the result of a division by 0 that GBATEK describes
+	inline s64 DivResult()
+	{
+		Wait(divider);
+
+		const s64 numerator = static_cast<s64>(divider.param0);
+		const s32 denominator = static_cast<s32>(divider.param1);
+
+		if (denominator == 0) return numerator < 0 ? 1 : -1;
+
+		return numerator / denominator;
+	}
+
+	inline u32 SqrtResult()
+	{
+		Wait(sqrtUnit);
+
+		u64 res = 0;
+
+		for (u64 bit = u64(1) << 31; bit != 0; bit >>= 1)
+			if ((res | bit) * (res | bit) <= sqrtUnit.param0) res |= bit;
+
+		return static_cast<u32>(res);
+	}
+}
+
+// The functions of the game, as in the NitroSDK (FX_DivAsync, FX_GetDivResult, FX_SqrtAsync, ...)
+void HardwareDivAsync(s32 numerator, s32 denominator)
+{
+	MathUnitModel::Start(MathUnitModel::divider, static_cast<u64>(s64(numerator) << 32), static_cast<u32>(denominator), MathUnitModel::DIV_LATENCY);
+}
+
+s64 HardwareDivResultQ32() { return MathUnitModel::DivResult(); }
+
+Fix12i HardwareDivResultQ12()
+{
+	return Fix12i(static_cast<s32>((MathUnitModel::DivResult() + (1 << 19)) >> 20), as_raw);
+}
+
+Fix12i HardwareDivQ12(Fix12i numerator, Fix12i denominator)
+{
+	HardwareDivAsync(numerator, denominator);
+	return HardwareDivResultQ12();
+}
+
+// Defined for the template, since Math.h uses them before this header could specialize them
+template<FixUR T>
+void Fix12<T>::InverseAsync(this Fix12i x)
+{
+	HardwareDivAsync(1._f, x);
+}
+
+template<FixUR T>
+Fix12i Fix12<T>::Inverse(this Fix12i x)
+{
+	x.InverseAsync();
+	return HardwareDivResultQ12();
+}
+
+void SqrtAsync(Fix12i x)
+{
+	MathUnitModel::Start(MathUnitModel::sqrtUnit, static_cast<u64>(x.val) << 32, 0, MathUnitModel::SQRT_LATENCY);
+}
+
+Fix12i SqrtResultFix12i()
+{
+	return Fix12i(static_cast<s32>((MathUnitModel::SqrtResult() + (1 << 9)) >> 10), as_raw);
+}
+
+Fix12i Sqrt(Fix12i x)
+{
+	SqrtAsync(x);
+	return SqrtResultFix12i();
+}
+
+// Writing the saved parameters back restarts both operations
+extern "C" void ARMMathSaveState(ARMMathState* location)
+{
+	MathUnitModel::Spend(MathUnitModel::REGISTER_ACCESS * 3);
+	location->divNumerator = MathUnitModel::divider.param0;
+	location->divDenominator = MathUnitModel::divider.param1;
+	location->sqrtParam = MathUnitModel::sqrtUnit.param0;
+	location->divMode = 1;
+	location->sqrtMode = 1;
+}
+
+extern "C" void ARMMathLoadState(ARMMathState* location)
+{
+	MathUnitModel::Start(MathUnitModel::divider, location->divNumerator, location->divDenominator, MathUnitModel::DIV_LATENCY);
+	MathUnitModel::Start(MathUnitModel::sqrtUnit, location->sqrtParam, 0, MathUnitModel::SQRT_LATENCY);
+}
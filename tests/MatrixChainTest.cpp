@@ -0,0 +1,108 @@
+#include "Math.h"
+#include "RomModels.h"
+#include "Benchmark.h"
+#include <cstdio>
+#include <random>
+
+// Checks that the in-place steps of Matrix4x3::Proxy give the same matrix as multiplying the
+// materialized rotation, translation and scale matrices, also when the result aliases the
+// arguments, and compares the game function calls and time of both for common chains. The time
+// is that of the host models, so only the difference in game calls and temporaries carries over.
+
+s16 RandomAngle(std::mt19937& rng) { return static_cast<s16>(rng()); }
+
+Vector3 RandomVector(std::mt19937& rng, u32 bits, s32 offset)
+{
+	const auto random = [&] { return Fix12i(static_cast<s32>(rng() >> (32 - bits)) + offset, as_raw); };
+	return {random(), random(), random()};
+}
+
+u32 CheckChains(std::mt19937& rng)
+{
+	const s16 angY = RandomAngle(rng);
+	const Vector3_16 ang = {RandomAngle(rng), RandomAngle(rng), RandomAngle(rng)};
+	const Vector3 pos = RandomVector(rng, 24, -(1 << 23));
+	const Vector3 scale = RandomVector(rng, 14, 0x800);
+
+	u32 numWrong = 0;
+
+	// an actor's model matrix
+	const Matrix4x3 fused = Matrix4x3::RotationY(angY).Translate(pos).ApplyScale(scale);
+	const Matrix4x3 product = Matrix4x3::RotationY(angY) * Matrix4x3::Translation(pos) * Matrix4x3::Scale(scale);
+
+	Matrix4x3 steps = Matrix4x3::RotationY(angY);
+	steps.Translate(pos);
+	steps.ApplyScale(scale);
+
+	numWrong += fused != product || fused != steps;
+
+	// the combined rotations, started from a translation
+	const Matrix4x3 fusedZXY = Matrix4x3::Translation(pos).RotateZXY(ang).ApplyScale(scale.x, scale.y, scale.z);
+	const Matrix4x3 productZXY = Matrix4x3::Translation(pos) * Matrix4x3::RotationZXY(ang) * Matrix4x3::Scale(scale);
+	numWrong += fusedZXY != productZXY;
+
+	const Matrix4x3 fusedXYZ = Matrix4x3::Translation(pos).RotateXYZ(ang.x, ang.y, ang.z);
+	const Matrix4x3 productXYZ = Matrix4x3::Translation(pos) * Matrix4x3::RotationXYZ(ang);
+	numWrong += fusedXYZ != productXYZ;
+
+	// the translation and scale are read from the matrix that is assigned to
+	Matrix4x3 aliased = product;
+	const Vector3 oldC3 = aliased.c3, oldC0 = aliased.c0;
+
+	aliased = Matrix4x3::RotationZXY(ang).Translate(aliased.c3).ApplyScale(aliased.c0);
+	numWrong += aliased != Matrix4x3(Matrix4x3::RotationZXY(ang).Translate(oldC3).ApplyScale(oldC0));
+
+	return numWrong;
+}
+
+template<class F>
+void Benchmark(const char* name, F&& build)
+{
+	Matrix4x3 res;
+
+	RomModels::numCalls = 0;
+	build(res);
+	const u32 numCalls = RomModels::numCalls;
+
+	const double nanos = NanosPerCall(1000000, [&](u32) { build(res); DoNotOptimize(res); });
+
+	std::printf("%-48s %2u game calls, %5.1f ns\n", name, numCalls, nanos);
+}
+
+int main()
+{
+	std::mt19937 rng(0);
+	u32 numWrong = 0;
+
+	for (u32 i = 0; i < 10000; i++)
+		numWrong += CheckChains(rng);
+
+	std::printf("MatrixChain: %u chains differ from the products\n", numWrong);
+
+	const s16 angY = RandomAngle(rng);
+	const Vector3_16 ang = {RandomAngle(rng), RandomAngle(rng), RandomAngle(rng)};
+	const Vector3 pos = RandomVector(rng, 24, -(1 << 23));
+	const Vector3 scale = RandomVector(rng, 14, 0x800);
+
+	Benchmark("RotationY * Translation * Scale", [&](Matrix4x3& res)
+	{
+		res = Matrix4x3::RotationY(angY) * Matrix4x3::Translation(pos) * Matrix4x3::Scale(scale);
+	});
+
+	Benchmark("RotationY.Translate.ApplyScale", [&](Matrix4x3& res)
+	{
+		res = Matrix4x3::RotationY(angY).Translate(pos).ApplyScale(scale);
+	});
+
+	Benchmark("Translation * RotationZXY * Scale", [&](Matrix4x3& res)
+	{
+		res = Matrix4x3::Translation(pos) * Matrix4x3::RotationZXY(ang) * Matrix4x3::Scale(scale);
+	});
+
+	Benchmark("Translation.RotateZXY.ApplyScale", [&](Matrix4x3& res)
+	{
+		res = Matrix4x3::Translation(pos).RotateZXY(ang).ApplyScale(scale);
+	});
+
+	return numWrong == 0 ? 0 : 1;
+}
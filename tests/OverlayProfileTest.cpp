@@ -0,0 +1,88 @@
+#include "FileSystem/OverlayProfileReport.h"
+#include <cstdio>
+#include <random>
+#include <sstream>
+
+namespace OverlayProfileTest
+{
+	inline OverlayProfileFormat::Record MakeRecord(std::mt19937& rng, u32 frame)
+	{
+		OverlayProfileFormat::Record res = {};
+		res.ovID = rng() % 0x100;
+		res.flags = rng() % 0x10;
+		res.levelID = rng() % 4 == 0 ? OverlayProfileFormat::NO_LEVEL : rng() % 52;
+		res.frame = frame;
+		res.imageSize = rng() % 0x40000;
+		res.loadSize = res.imageSize + rng() % 0x1000;
+		res.bssSize = rng() % 0x10000;
+		res.numStaticInitializers = rng() % 0x100;
+
+		for (u32& ticks : res.ticks)
+			ticks = rng() % 0x100000;
+
+		return res;
+	}
+
+	inline bool Equal(const OverlayProfileFormat::Record& a, const OverlayProfileFormat::Record& b)
+	{
+		u32 fieldsA[OverlayProfileFormat::NUM_FIELDS], fieldsB[OverlayProfileFormat::NUM_FIELDS];
+		OverlayProfileFormat::Fields(a, fieldsA);
+		OverlayProfileFormat::Fields(b, fieldsB);
+
+		return std::equal(fieldsA, fieldsA + OverlayProfileFormat::NUM_FIELDS, fieldsB);
+	}
+
+	// Formats random records between other lines of a log, parses them back and checks that the
+	// report accounts for every load. Returns the number of dumps that failed.
+	inline u32 Run(u32 numDumps, u32 seed = 0)
+	{
+		std::mt19937 rng(seed);
+		u32 numFailed = 0;
+
+		for (u32 n = 0; n < numDumps; n++)
+		{
+			std::vector<OverlayProfileFormat::Record> records(rng() % 64);
+			std::string log = "file cache: 0x3 hits\n";
+			u32 frame = rng();
+
+			for (OverlayProfileFormat::Record& record : records)
+			{
+				frame += rng() % 4 == 0 ? rng() % 1000 : rng() % 2;
+				record = MakeRecord(rng, frame);
+
+				char line[OverlayProfileFormat::LINE_SIZE + 1];
+				OverlayProfileFormat::FormatLine(record, line);
+
+				log += rng() % 2 == 0 ? "[ARM9] " : "";
+				log += line;
+			}
+
+			log += "OVLP end, 0x3 loads, 0x0 dropped\n";
+
+			std::istringstream is(log);
+			const std::vector<OverlayProfileFormat::Record> parsed = ParseOverlayProfileDump(is);
+
+			bool ok = parsed.size() == records.size() && std::equal(parsed.begin(), parsed.end(), records.begin(), Equal);
+
+			const OverlayProfileReport report(parsed);
+			u32 inTransitions = 0, inOverlays = 0;
+
+			for (const OverlayProfileReport::Transition& transition : report.transitions) inTransitions += transition.numLoads;
+			for (const OverlayProfileReport::Overlay& overlay : report.overlays) inOverlays += overlay.numLoads;
+
+			ok &= inTransitions == records.size() && inOverlays == records.size();
+
+			if (!ok) numFailed++;
+		}
+
+		return numFailed;
+	}
+}
+
+int main()
+{
+	const u32 numFailed = OverlayProfileTest::Run(200);
+	std::printf("OverlayProfileReport: %u of 200 dumps failed\n", numFailed);
+
+	return numFailed == 0 ? 0 : 1;
+}
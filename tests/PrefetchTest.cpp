@@ -0,0 +1,99 @@
+#include "SharedFilePtr/PrefetchModel.h"
+#include <cstdio>
+
+// FILE_PREFETCHER's queue run by PrefetchBenchmark on files written to a temporary directory: files
+// prefetched during the fade must not be read again by the spawns, a file that a spawn loads before
+// the prefetcher gets to it must only be referenced, and every reference must be released at the end.
+
+namespace PrefetchTest
+{
+	u32 numWrong = 0;
+
+	void Expect(bool ok, const char* what)
+	{
+		if (!ok)
+		{
+			std::printf("%s\n", what);
+			numWrong++;
+		}
+	}
+
+	void Write(const std::filesystem::path& path, u32 size)
+	{
+		std::filesystem::create_directories(path.parent_path());
+		std::ofstream(path, std::ios::binary) << std::string(size, 'x');
+	}
+
+	void CheckPrefetch(const std::filesystem::path& dir)
+	{
+		Write(dir / "enemy/kuribo/kuribo_model.bmd", 0x6000);
+		Write(dir / "enemy/kuribo/kuribo_walk.bca", 0x1000);
+		Write(dir / "enemy/bombhei/bombhei.bmd", 0x8000);
+		Write(dir / "normal_obj/coin/coin_poly32.bmd", 0x2000);
+
+		const DirectoryFileSource source(dir);
+
+		const PrefetchBenchmark::Spawn spawns[] =
+		{
+			{0,  "enemy/kuribo/kuribo_model.bmd"},
+			{0,  "enemy/kuribo/kuribo_walk.bca"},
+			{0,  "enemy/kuribo/kuribo_model.bmd"}, // a second goomba
+			{5,  "enemy/bombhei/bombhei.bmd"},
+			{20, "normal_obj/coin/coin_poly32.bmd"},
+		};
+
+		const std::string prefetched[] =
+		{
+			"enemy/kuribo/kuribo_model.bmd",
+			"enemy/kuribo/kuribo_walk.bca",
+			"enemy/bombhei/bombhei.bmd",
+			"normal_obj/coin/coin_poly32.bmd",
+			"enemy/missing.bmd",
+		};
+
+		PrefetchBenchmark::Settings settings;
+		settings.fadeFrames = 30;
+
+		const PrefetchBenchmark::Result without = PrefetchBenchmark::Run(source, spawns, {}, settings);
+		const PrefetchBenchmark::Result with = PrefetchBenchmark::Run(source, spawns, prefetched, settings);
+
+		std::printf("without prefetching: %.1f ms of loads, %u stalled frames (max %.1f ms), %u spawn loads\n",
+			without.totalLoadMs, without.numStalledFrames, without.maxStallMs, without.numSpawnLoads);
+		std::printf("with prefetching:    %.1f ms of loads, %u stalled frames (max %.1f ms), %u spawn loads\n",
+			with.totalLoadMs, with.numStalledFrames, with.maxStallMs, with.numSpawnLoads);
+
+		Expect(without.numSpawnLoads == 4 && without.numReads == 4, "without prefetching, every file is read by its first spawn");
+		Expect(without.numStalledFrames > 0, "the spawn loads stall");
+
+		Expect(with.numSpawnLoads == 0 && with.totalLoadMs == 0, "the fade is long enough for everything");
+		Expect(with.prefetcher.numLoaded == 5 && with.numReads == 5, "the prefetcher reads every file once, and tries the missing one");
+		Expect(with.balanced && without.balanced, "every reference is released");
+
+		// one file per frame and no fade: the goomba in frame 0 loads its animation before the prefetcher gets to it
+		settings.fadeFrames = 0;
+		const PrefetchBenchmark::Result late = PrefetchBenchmark::Run(source, spawns, prefetched, settings);
+
+		Expect(late.prefetcher.numLoadedBySpawn == 1, "a file loaded by a spawn is only referenced by the prefetcher");
+		Expect(late.numReads == 5, "no file is read twice");
+		Expect(late.numSpawnLoads == 1 && late.balanced, "the spawn loads only what the prefetcher hasn't yet");
+	}
+
+	u32 Run()
+	{
+		const std::filesystem::path dir = std::filesystem::temp_directory_path() / "sm64ds_pi_prefetch_test";
+		std::filesystem::remove_all(dir);
+
+		CheckPrefetch(dir);
+
+		std::filesystem::remove_all(dir);
+		return numWrong;
+	}
+}
+
+int main()
+{
+	const u32 numWrong = PrefetchTest::Run();
+	std::printf("Prefetch: %u checks failed\n", numWrong);
+
+	return numWrong == 0 ? 0 : 1;
+}
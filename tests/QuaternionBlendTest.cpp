@@ -0,0 +1,195 @@
+#include "Math.h"
+#include "RomModels.h"
+#include "MathUnitModel.h"
+#include "Benchmark.h"
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// Checks that BlendPoses blends every bone like Nlerp and only the bones both spans have, and
+// compares the accuracy and speed of blending quaternions (Nlerp, Slerp) with blending the Euler
+// angles of BCA_File per bone, against a slerp in double precision. The times are those of the
+// host models of the game functions, so they only hint at the difference on the DS.
+
+struct DoubleQuat { double w, x, y, z; };
+
+constexpr double PI = 3.14159265358979323846;
+
+DoubleQuat operator*(const DoubleQuat& a, const DoubleQuat& b)
+{
+	return
+	{
+		a.w*b.w - a.x*b.x - a.y*b.y - a.z*b.z,
+		a.w*b.x + a.x*b.w + a.y*b.z - a.z*b.y,
+		a.w*b.y - a.x*b.z + a.y*b.w + a.z*b.x,
+		a.w*b.z + a.x*b.y - a.y*b.x + a.z*b.w,
+	};
+}
+
+double Dot(const DoubleQuat& a, const DoubleQuat& b) { return a.w*b.w + a.x*b.x + a.y*b.y + a.z*b.z; }
+
+double Radians(s16 angle) { return angle * PI / 0x8000; }
+
+// The rotation of Matrix4x3::RotationZXY: y, then x, then z intrinsic
+DoubleQuat FromEuler(const Vector3_16& ang)
+{
+	const double x = Radians(ang.x) / 2, y = Radians(ang.y) / 2, z = Radians(ang.z) / 2;
+
+	return DoubleQuat{std::cos(y), 0, std::sin(y), 0}
+	     * DoubleQuat{std::cos(x), std::sin(x), 0, 0}
+	     * DoubleQuat{std::cos(z), 0, 0, std::sin(z)};
+}
+
+DoubleQuat Slerp(const DoubleQuat& a, DoubleQuat b, double t)
+{
+	double cosTheta = Dot(a, b);
+
+	if (cosTheta < 0)
+	{
+		b = {-b.w, -b.x, -b.y, -b.z};
+		cosTheta = -cosTheta;
+	}
+
+	const double theta = std::acos(std::min(cosTheta, 1.0));
+
+	if (theta < 1e-9) return a;
+
+	const double w0 = std::sin((1 - t) * theta) / std::sin(theta);
+	const double w1 = std::sin(t * theta) / std::sin(theta);
+
+	return {a.w*w0 + b.w*w1, a.x*w0 + b.x*w1, a.y*w0 + b.y*w1, a.z*w0 + b.z*w1};
+}
+
+Quaternion ToFix(const DoubleQuat& q)
+{
+	const auto fix = [](double x) { return Fix12i(static_cast<s32>(std::lround(x * 0x1000)), as_raw); };
+
+	Quaternion res;
+	res.w = fix(q.w);
+	res.x = fix(q.x);
+	res.y = fix(q.y);
+	res.z = fix(q.z);
+	return res;
+}
+
+// The angle between the rotations, in degrees
+double AngleBetween(const Quaternion& q, const DoubleQuat& ref)
+{
+	const DoubleQuat d = {q.w.val / 4096., q.x.val / 4096., q.y.val / 4096., q.z.val / 4096.};
+	const double len = std::sqrt(Dot(d, d));
+
+	return 2 * std::acos(std::min(std::abs(Dot(d, ref)) / len, 1.0)) * 180 / PI;
+}
+
+// The blend of BCA_File's angles: each one takes the shorter way around
+Vector3_16 BlendEuler(const Vector3_16& a, const Vector3_16& b, Fix12i t)
+{
+	const auto blend = [t](s16 a, s16 b) { return static_cast<s16>(a + (static_cast<s16>(b - a) * t.val >> 12)); };
+	return {blend(a.x, b.x), blend(a.y, b.y), blend(a.z, b.z)};
+}
+
+struct Error
+{
+	double max = 0;
+	double sum = 0;
+	u32 num = 0;
+
+	void Add(double error) { max = std::max(max, error); sum += error; num++; }
+};
+
+int main()
+{
+	std::mt19937 rng(0);
+	u32 numWrong = 0;
+
+	// BlendPoses blends each bone like Nlerp, and only as many as both spans have
+	constexpr u32 NUM_BONES = 32;
+	std::vector<Vector3_16> eulerPoses(NUM_BONES), eulerTargets(NUM_BONES);
+	std::vector<Quaternion> poses(NUM_BONES), targets(NUM_BONES);
+
+	const auto randomPoses = [&](s32 maxDifference)
+	{
+		for (u32 i = 0; i < NUM_BONES; i++)
+		{
+			const auto near = [&](s16 a) { return static_cast<s16>(a + static_cast<s32>(rng() % (2 * maxDifference + 1)) - maxDifference); };
+
+			eulerPoses[i] = {static_cast<s16>(rng()), static_cast<s16>(rng()), static_cast<s16>(rng())};
+			eulerTargets[i] = {near(eulerPoses[i].x), near(eulerPoses[i].y), near(eulerPoses[i].z)};
+			poses[i] = ToFix(FromEuler(eulerPoses[i]));
+			targets[i] = ToFix(FromEuler(eulerTargets[i]));
+		}
+	};
+
+	for (u32 i = 0; i < 1000; i++)
+	{
+		randomPoses(0x4000);
+		const Fix12i t = Fix12i(rng() & 0xfff, as_raw);
+		const std::size_t numTargets = rng() % (NUM_BONES + 1);
+
+		std::vector<Quaternion> blended = poses;
+		BlendPoses(blended, std::span(targets).first(numTargets), t);
+
+		for (std::size_t j = 0; j < NUM_BONES; j++)
+			numWrong += blended[j] != (j < numTargets ? Quaternion(Nlerp(poses[j], targets[j], t)) : poses[j]);
+	}
+
+	// accuracy against a slerp of the exact rotations, for small and large differences
+	for (const s32 maxDifference : {0x800, 0x2000, 0x4000})
+	{
+		Error nlerpError, slerpError, eulerError;
+
+		for (u32 i = 0; i < 200; i++)
+		{
+			randomPoses(maxDifference);
+			const Fix12i t = Fix12i(rng() & 0xfff, as_raw);
+
+			for (u32 j = 0; j < NUM_BONES; j++)
+			{
+				const DoubleQuat ref = Slerp(FromEuler(eulerPoses[j]), FromEuler(eulerTargets[j]), t.val / 4096.);
+
+				nlerpError.Add(AngleBetween(Nlerp(poses[j], targets[j], t), ref));
+				slerpError.Add(AngleBetween(Slerp(poses[j], targets[j], t), ref));
+				eulerError.Add(AngleBetween(ToFix(FromEuler(BlendEuler(eulerPoses[j], eulerTargets[j], t))), ref));
+			}
+		}
+
+		std::printf("differences up to %5.1f deg per axis, error in deg (mean / max): Nlerp %.3f / %.3f, Slerp %.3f / %.3f, Euler %.3f / %.3f\n",
+			maxDifference * 180. / 0x8000, nlerpError.sum / nlerpError.num, nlerpError.max,
+			slerpError.sum / slerpError.num, slerpError.max, eulerError.sum / eulerError.num, eulerError.max);
+
+		numWrong += slerpError.max > 1;
+	}
+
+	// a skeleton's worth of bone matrices per frame
+	randomPoses(0x2000);
+	std::vector<Matrix4x3> matrices(NUM_BONES);
+	std::vector<Quaternion> blended(NUM_BONES);
+	const Fix12i t = 0.25_f;
+
+	const double quaternionNanos = NanosPerCall(20000, [&](u32)
+	{
+		blended = poses;
+		BlendPoses(blended, targets, t);
+
+		for (u32 j = 0; j < NUM_BONES; j++)
+			matrices[j] = Matrix4x3::FromQuaternion(blended[j]);
+
+		DoNotOptimize(matrices);
+	});
+
+	const double eulerNanos = NanosPerCall(20000, [&](u32)
+	{
+		for (u32 j = 0; j < NUM_BONES; j++)
+			matrices[j] = Matrix4x3::RotationZXY(BlendEuler(eulerPoses[j], eulerTargets[j], t));
+
+		DoNotOptimize(matrices);
+	});
+
+	std::printf("%u bones: BlendPoses + FromQuaternion %.0f ns, Euler blend + RotationZXY %.0f ns\n",
+		NUM_BONES, quaternionNanos, eulerNanos);
+
+	std::printf("QuaternionBlend: %u checks failed\n", numWrong);
+
+	return numWrong == 0 ? 0 : 1;
+}
@@ -0,0 +1,328 @@
+#pragma once
+
+#include "Math.h"
+#include <array>
+
+// Host models of the game functions that the tested headers call, so that the tests link and the
+// benchmarks can compare against the scalar path. They follow the NitroSDK functions the game
+// was built with; include this header in one translation unit per test.
+
+namespace RomModels
+{
+	inline u32 numCalls = 0; // of the game functions below, for the benchmarks
+	inline u32 callDepth = 0;
+
+	// Counts a call, unless it's made by another model
+	struct Call
+	{
+		Call() { numCalls += callDepth++ == 0; }
+		~Call() { callDepth--; }
+	};
+
+	// The sums of products of the NitroSDK are taken in 64 bits and shifted down without rounding
+	inline Fix12i Dot(const Vector3& row, Fix12i x, Fix12i y, Fix12i z)
+	{
+		return Fix12i(static_cast<s32>((s64(row.x.val) * x.val + s64(row.y.val) * y.val + s64(row.z.val) * z.val) >> 12), as_raw);
+	}
+
+	inline Vector3 Row(const Matrix3x3& m, u32 i)
+	{
+		return i == 0 ? Vector3{m.c0.x, m.c1.x, m.c2.x}
+		     : i == 1 ? Vector3{m.c0.y, m.c1.y, m.c2.y}
+		     :          Vector3{m.c0.z, m.c1.z, m.c2.z};
+	}
+
+	inline Vector3 Mul(const Matrix3x3& m, const Vector3& v)
+	{
+		return {Dot(Row(m, 0), v.x, v.y, v.z), Dot(Row(m, 1), v.x, v.y, v.z), Dot(Row(m, 2), v.x, v.y, v.z)};
+	}
+
+	// The tables are generated by TrigTables, which tests/TrigTablesTest.cpp compares with the game's
+	template<class T, std::size_t size, class F>
+	consteval std::array<T, size> Generate(F entry)
+	{
+		std::array<T, size> res {};
+
+		for (u32 i = 0; i < size; i++)
+			res[i] = entry(i);
+
+		return res;
+	}
+}
+
+extern const std::array<Fix12s, 0x2000> GENERATED_SINE_TABLE asm("SINE_TABLE");
+extern const std::array<Fix12s, 0x400>  GENERATED_ATAN_TABLE asm("ATAN_TABLE");
+
+constinit const std::array<Fix12s, 0x2000> GENERATED_SINE_TABLE =
+	RomModels::Generate<Fix12s, 0x2000>([](u32 i) consteval { return TrigTables::SineEntry(i); });
+
+constinit const std::array<Fix12s, 0x400> GENERATED_ATAN_TABLE =
+	RomModels::Generate<Fix12s, 0x400>([](u32 i) consteval { return TrigTables::AtanEntry(i); });
+
+extern "C" bool Vec3_Equal(const Vector3& v0, const Vector3& v1)
+{
+	return v0.x == v1.x && v0.y == v1.y && v0.z == v1.z;
+}
+
+extern "C" void AddVec3(const Vector3& v0, const Vector3& v1, Vector3& res)
+{
+	res = {v0.x + v1.x, v0.y + v1.y, v0.z + v1.z};
+}
+
+extern "C" void SubVec3(const Vector3& v0, const Vector3& v1, Vector3& res)
+{
+	res = {v0.x - v1.x, v0.y - v1.y, v0.z - v1.z};
+}
+
+// VEC_DotProduct rounds the 64 bit sum
+extern "C" Fix12i DotVec3(const Vector3& v0, const Vector3& v1)
+{
+	const s64 sum = s64(v0.x.val) * v1.x.val + s64(v0.y.val) * v1.y.val + s64(v0.z.val) * v1.z.val;
+	return Fix12i(static_cast<s32>((sum + 0x800) >> 12), as_raw);
+}
+
+extern "C" void Vec3_MulScalar(Vector3& res, const Vector3& v, Fix12i scalar)
+{
+	res = {v.x * scalar, v.y * scalar, v.z * scalar};
+}
+
+extern "C" void Vec3_MulScalarInPlace(Vector3& v, Fix12i scalar)
+{
+	Vec3_MulScalar(v, v, scalar);
+}
+
+// MTX_MultVec43
+extern "C" void MulVec3Mat4x3(const Vector3& v, const Matrix4x3& m, Vector3& res)
+{
+	const RomModels::Call call;
+	res = RomModels::Mul(m.Linear(), v) + m.c3;
+}
+
+// MTX_MultVec33
+extern "C" void MulVec3Mat3x3(const Vector3& v, const Matrix3x3& m, Vector3& res)
+{
+	const RomModels::Call call;
+	res = RomModels::Mul(m, v);
+}
+
+// MTX_Concat43, the results may alias the arguments
+extern "C" void MulMat4x3Mat4x3(const Matrix4x3& m1, const Matrix4x3& m0, Matrix4x3& mF)
+{
+	const RomModels::Call call;
+
+	const Matrix4x3 temp =
+	{
+		RomModels::Mul(m0.Linear(), m1.c0),
+		RomModels::Mul(m0.Linear(), m1.c1),
+		RomModels::Mul(m0.Linear(), m1.c2),
+		RomModels::Mul(m0.Linear(), m1.c3) + m0.c3,
+	};
+
+	mF = temp;
+}
+
+extern "C" void Matrix3x3_LoadIdentity(Matrix3x3& mF)
+{
+	const RomModels::Call call;
+	mF = {{1._f, 0._f, 0._f}, {0._f, 1._f, 0._f}, {0._f, 0._f, 1._f}};
+}
+
+extern "C" void Matrix4x3_LoadIdentity(Matrix4x3& mF)
+{
+	const RomModels::Call call;
+	mF = {{1._f, 0._f, 0._f}, {0._f, 1._f, 0._f}, {0._f, 0._f, 1._f}, {0._f, 0._f, 0._f}};
+}
+
+extern "C" void Matrix4x3_FromTranslation(Matrix4x3& mF, Fix12i x, Fix12i y, Fix12i z)
+{
+	const RomModels::Call call;
+	Matrix4x3_LoadIdentity(mF);
+	mF.c3 = {x, y, z};
+}
+
+extern "C" void Matrix4x3_FromScale(Matrix4x3& mF, Fix12i x, Fix12i y, Fix12i z)
+{
+	const RomModels::Call call;
+	Matrix4x3_LoadIdentity(mF);
+	mF.c0.x = x;
+	mF.c1.y = y;
+	mF.c2.z = z;
+}
+
+extern "C" void Matrix4x3_FromRotationX(Matrix4x3& mF, s16 angX)
+{
+	const RomModels::Call call;
+	const Fix12i s = Sin(angX), c = Cos(angX);
+
+	Matrix4x3_LoadIdentity(mF);
+	mF.c1 = {0._f, c,  s};
+	mF.c2 = {0._f, -s, c};
+}
+
+extern "C" void Matrix4x3_FromRotationY(Matrix4x3& mF, s16 angY)
+{
+	const RomModels::Call call;
+	const Fix12i s = Sin(angY), c = Cos(angY);
+
+	Matrix4x3_LoadIdentity(mF);
+	mF.c0 = {c, 0._f, -s};
+	mF.c2 = {s, 0._f,  c};
+}
+
+extern "C" void Matrix4x3_FromRotationZ(Matrix4x3& mF, s16 angZ)
+{
+	const RomModels::Call call;
+	const Fix12i s = Sin(angZ), c = Cos(angZ);
+
+	Matrix4x3_LoadIdentity(mF);
+	mF.c0 = {c,  s, 0._f};
+	mF.c1 = {-s, c, 0._f};
+}
+
+extern "C" void Matrix4x3_ApplyInPlaceToRotationX(Matrix4x3& mF, s16 angX)
+{
+	const RomModels::Call call;
+	Matrix4x3 rotation;
+	Matrix4x3_FromRotationX(rotation, angX);
+	MulMat4x3Mat4x3(rotation, mF, mF);
+}
+
+extern "C" void Matrix4x3_ApplyInPlaceToRotationY(Matrix4x3& mF, s16 angY)
+{
+	const RomModels::Call call;
+	Matrix4x3 rotation;
+	Matrix4x3_FromRotationY(rotation, angY);
+	MulMat4x3Mat4x3(rotation, mF, mF);
+}
+
+extern "C" void Matrix4x3_ApplyInPlaceToRotationZ(Matrix4x3& mF, s16 angZ)
+{
+	const RomModels::Call call;
+	Matrix4x3 rotation;
+	Matrix4x3_FromRotationZ(rotation, angZ);
+	MulMat4x3Mat4x3(rotation, mF, mF);
+}
+
+// yxz intrinsic
+extern "C" void Matrix4x3_FromRotationZXYExt(Matrix4x3& mF, s16 angX, s16 angY, s16 angZ)
+{
+	const RomModels::Call call;
+	Matrix4x3_FromRotationY(mF, angY);
+	Matrix4x3_ApplyInPlaceToRotationX(mF, angX);
+	Matrix4x3_ApplyInPlaceToRotationZ(mF, angZ);
+}
+
+// zyx intrinsic
+extern "C" void Matrix4x3_FromRotationXYZExt(Matrix4x3& mF, s16 angX, s16 angY, s16 angZ)
+{
+	const RomModels::Call call;
+	Matrix4x3_FromRotationZ(mF, angZ);
+	Matrix4x3_ApplyInPlaceToRotationY(mF, angY);
+	Matrix4x3_ApplyInPlaceToRotationX(mF, angX);
+}
+
+extern "C" void Matrix4x3_ApplyInPlaceToRotationZXYExt(Matrix4x3& mF, s16 angX, s16 angY, s16 angZ)
+{
+	const RomModels::Call call;
+	Matrix4x3 rotation;
+	Matrix4x3_FromRotationZXYExt(rotation, angX, angY, angZ);
+	MulMat4x3Mat4x3(rotation, mF, mF);
+}
+
+extern "C" void Matrix4x3_ApplyInPlaceToRotationXYZExt(Matrix4x3& mF, s16 angX, s16 angY, s16 angZ)
+{
+	const RomModels::Call call;
+	Matrix4x3 rotation;
+	Matrix4x3_FromRotationXYZExt(rotation, angX, angY, angZ);
+	MulMat4x3Mat4x3(rotation, mF, mF);
+}
+
+// MTX_TransApply43 without a separate source: the translation is transformed by the linear part
+extern "C" void Matrix4x3_ApplyInPlaceToTranslation(Matrix4x3& mF, Fix12i x, Fix12i y, Fix12i z)
+{
+	const RomModels::Call call;
+	mF.c3 += RomModels::Mul(mF.Linear(), {x, y, z});
+}
+
+// MTX_ScaleApply43: every column is scaled by its factor, truncated like the sums of products
+extern "C" void Matrix4x3_ApplyInPlaceToScale(Matrix4x3& mF, Fix12i x, Fix12i y, Fix12i z)
+{
+	const RomModels::Call call;
+
+	const auto scale = [](Vector3& c, Fix12i s)
+	{
+		c.x = Fix12i(static_cast<s32>(s64(c.x.val) * s.val >> 12), as_raw);
+		c.y = Fix12i(static_cast<s32>(s64(c.y.val) * s.val >> 12), as_raw);
+		c.z = Fix12i(static_cast<s32>(s64(c.z.val) * s.val >> 12), as_raw);
+	};
+
+	scale(mF.c0, x);
+	scale(mF.c1, y);
+	scale(mF.c2, z);
+}
+
+// The octant reduction of Atan2Const with the table of the game, not a recording of the game's Atan2
+s16 Atan2(s32 y, s32 x)
+{
+	const s64 ax = x >= 0 ? x : -static_cast<s64>(x);
+	const s64 ay = y >= 0 ? y : -static_cast<s64>(y);
+
+	if (ax == 0 && ay == 0) return 0;
+
+	s32 angle = ay <= ax
+		? (ay == ax ? 0x2000 : ATAN_TABLE[(ay << 10) / ax].val)
+		: 0x4000 - ATAN_TABLE[(ax << 10) / ay].val;
+
+	if (x < 0) angle = 0x8000 - angle;
+	if (y < 0) angle = -angle;
+
+	return static_cast<s16>(angle);
+}
+
+extern "C" void Quaternion_Lerp(const Quaternion& q0, const Quaternion& q1, Fix12i t, Quaternion& qF)
+{
+	const RomModels::Call call;
+	const auto lerp = [t](Fix12i a, Fix12i b) { return Fix12i(a.val + static_cast<s32>(s64(b.val - a.val) * t.val >> 12), as_raw); };
+
+	Quaternion res;
+	res.w = lerp(q0.w, q1.w);
+	res.x = lerp(q0.x, q1.x);
+	res.y = lerp(q0.y, q1.y);
+	res.z = lerp(q0.z, q1.z);
+	qF = res;
+}
+
+extern "C" void Quaternion_Normalize(Quaternion& q)
+{
+	const RomModels::Call call;
+	const u64 lenSq = u64(s64(q.w.val) * q.w.val) + u64(s64(q.x.val) * q.x.val) + u64(s64(q.y.val) * q.y.val) + u64(s64(q.z.val) * q.z.val);
+
+	u64 len = 0;
+
+	for (u64 bit = u64(1) << 31; bit != 0; bit >>= 1)
+		if ((len | bit) * (len | bit) <= lenSq) len |= bit;
+
+	if (len == 0) return;
+
+	const auto normalize = [len](Fix12i& c) { c = Fix12i(static_cast<s32>((s64(c.val) << 12) / s64(len)), as_raw); };
+
+	normalize(q.w);
+	normalize(q.x);
+	normalize(q.y);
+	normalize(q.z);
+}
+
+extern "C" void Matrix4x3_FromQuaternion(const Quaternion& q, Matrix4x3& mF)
+{
+	const RomModels::Call call;
+	const auto mul = [](Fix12i a, Fix12i b) { return Fix12i(static_cast<s32>(s64(a.val) * b.val >> 12), as_raw); };
+
+	const Fix12i xx = mul(q.x, q.x), yy = mul(q.y, q.y), zz = mul(q.z, q.z);
+	const Fix12i xy = mul(q.x, q.y), xz = mul(q.x, q.z), yz = mul(q.y, q.z);
+	const Fix12i wx = mul(q.w, q.x), wy = mul(q.w, q.y), wz = mul(q.w, q.z);
+
+	mF.c0 = {1._f - ((yy + zz) << 1), (xy + wz) << 1, (xz - wy) << 1};
+	mF.c1 = {(xy - wz) << 1, 1._f - ((xx + zz) << 1), (yz + wx) << 1};
+	mF.c2 = {(xz + wy) << 1, (yz - wx) << 1, 1._f - ((xx + yy) << 1)};
+	mF.c3 = {0._f, 0._f, 0._f};
+}
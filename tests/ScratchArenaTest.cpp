@@ -0,0 +1,207 @@
+#include "Math/MathCommon.h"
+#include <cstdio>
+
+// ScratchArena on a model of SolidHeapAllocator, whose SaveState allocates the state from the heap
+// itself and fails when it's full, like the game's. A scope whose state couldn't be saved must be
+// counted and must not load a state when it ends, and what it allocated is freed by the enclosing
+// scope instead.
+
+struct AllocationState
+{
+	u32 id;
+	void* blockBegin;
+	void* blockEnd;
+	AllocationState* nextState;
+};
+
+struct SolidHeapAllocator
+{
+	void* heapStart;
+	void* heapEnd;
+	void* freeBlockBegin;
+	void* freeBlockEnd;
+	AllocationState* state;
+
+	u32 numLoads = 0;
+	u32 numMissingStates = 0; // LoadState with an ID that wasn't saved
+
+	void* Allocate(u32 size, s32 align)
+	{
+		u8* const begin = static_cast<u8*>(freeBlockBegin);
+		u8* const data = begin + (-reinterpret_cast<uintptr_t>(begin) & (align - 1));
+
+		if (data + size > static_cast<u8*>(freeBlockEnd)) return nullptr;
+
+		freeBlockBegin = data + size;
+		return data;
+	}
+
+	u32 MemoryLeft(s32) { return static_cast<u8*>(freeBlockEnd) - static_cast<u8*>(freeBlockBegin); }
+
+	bool SaveState(u32 id)
+	{
+		AllocationState* saved = static_cast<AllocationState*>(Allocate(sizeof(AllocationState), 4));
+		if (!saved) return false;
+
+		*saved = {id, freeBlockBegin, freeBlockEnd, state};
+		state = saved;
+
+		return true;
+	}
+
+	bool LoadState(u32 id)
+	{
+		numLoads++;
+
+		for (AllocationState* s = state; s; s = s->nextState)
+		{
+			if (s->id != id) continue;
+
+			// the state itself was allocated right before blockBegin
+			freeBlockBegin = s;
+			freeBlockEnd = s->blockEnd;
+			state = s->nextState;
+
+			return true;
+		}
+
+		numMissingStates++;
+		return false;
+	}
+
+	void Reset(u32)
+	{
+		freeBlockBegin = heapStart;
+		freeBlockEnd = heapEnd;
+		state = nullptr;
+	}
+};
+
+struct SolidHeap;
+
+struct Heap
+{
+	static SolidHeap* CreateSolidHeap(u32 size, Heap* parent, s32 align);
+	void Destroy() {}
+};
+
+struct SolidHeap : Heap
+{
+	SolidHeapAllocator* allocator;
+};
+
+struct ExpandingHeap : Heap {};
+
+namespace Memory
+{
+	ExpandingHeap* rootHeapPtr = nullptr;
+}
+
+namespace ScratchArenaTest
+{
+	alignas(16) u8 memory[0x200];
+	SolidHeapAllocator allocator;
+	SolidHeap heap;
+}
+
+SolidHeap* Heap::CreateSolidHeap(u32 size, Heap*, s32)
+{
+	using namespace ScratchArenaTest;
+
+	allocator = {memory, memory + size, memory, memory + size, nullptr};
+	heap.allocator = &allocator;
+
+	return &heap;
+}
+
+struct ostream
+{
+	const ostream& operator<<(const char* str) const { std::printf("%s", str); return *this; }
+	const ostream& operator<<(u32 val) const { std::printf("%u", val); return *this; }
+	const ostream& operator<<(char c) const { std::printf("%c", c); return *this; }
+};
+
+#include "Memory/ScratchArena.h"
+
+namespace ScratchArenaTest
+{
+	u32 numWrong = 0;
+
+	void Expect(bool ok, const char* what)
+	{
+		if (!ok)
+		{
+			std::printf("%s\n", what);
+			numWrong++;
+		}
+	}
+
+	void CheckScopes()
+	{
+		ScratchArena scratch;
+		Expect(scratch.Create(sizeof(memory)), "the arena is created");
+		scratch.BeginFrame();
+
+		{
+			ScratchArena::Scope outer(scratch);
+			Expect(outer.Saved(), "a scope with room for its state saves it");
+
+			const u32 leftInOuter = scratch.MemoryLeft();
+
+			{
+				ScratchArena::Scope inner(scratch);
+				Expect(inner.Saved() && scratch.Allocate<u32>(4).size() == 4, "a nested scope saves and allocates");
+			}
+
+			Expect(scratch.MemoryLeft() == leftInOuter, "the nested scope freed what it allocated");
+
+			// fill the arena up to the last few bytes, so that the next state doesn't fit
+			const u32 fill = scratch.MemoryLeft() - sizeof(AllocationState) / 2;
+			Expect(scratch.AllocateBytes(fill) != nullptr, "the arena is filled");
+
+			const u32 numLoads = allocator.numLoads;
+
+			{
+				ScratchArena::Scope full(scratch);
+				Expect(!full.Saved(), "a scope in a full arena can't save its state");
+				Expect(scratch.stats.numFailedScopes == 1, "the failed scope is counted");
+			}
+
+			Expect(allocator.numLoads == numLoads, "a scope without a state doesn't load one");
+			Expect(allocator.numMissingStates == 0, "no state is looked up that wasn't saved");
+
+			{
+				ScratchArena::Scope afterFull(scratch);
+				Expect(!afterFull.Saved() && scratch.stats.numFailedScopes == 2, "every failed scope is counted");
+			}
+		}
+
+		Expect(scratch.MemoryLeft() == sizeof(memory), "the outer scope frees what the failed scopes left");
+		Expect(allocator.state == nullptr, "all states are loaded");
+
+		// the next frame starts empty with the statistics kept
+		scratch.BeginFrame();
+		{
+			ScratchArena::Scope scope(scratch);
+			Expect(scope.Saved() && scratch.stats.numFailedScopes == 2, "the next frame has room again");
+		}
+
+		scratch.Dump(ostream());
+		scratch.Destroy();
+	}
+
+	u32 Run()
+	{
+		CheckScopes();
+
+		return numWrong;
+	}
+}
+
+int main()
+{
+	const u32 numWrong = ScratchArenaTest::Run();
+	std::printf("ScratchArena: %u checks failed\n", numWrong);
+
+	return numWrong == 0 ? 0 : 1;
+}
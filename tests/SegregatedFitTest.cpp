@@ -0,0 +1,149 @@
+#include "Memory/HeapModel.h"
+#include <cstdio>
+#include <vector>
+
+// The block choice of SegregatedFitIndex (HeapModel::SEGREGATED_FIT) against hand-checked layouts,
+// then a synthetic trace of level loads replayed with the game's first fit, best fit and the index:
+// how many free blocks each looks at per allocation, how much memory it needs and how fragmented the
+// heap gets. Only the block choice is modeled, so the host time of the replay says nothing about the
+// index, the number of visited blocks does.
+
+namespace SegregatedFitTest
+{
+	u32 numWrong = 0;
+
+	void Expect(bool ok, const char* what)
+	{
+		if (!ok)
+		{
+			std::printf("%s\n", what);
+			numWrong++;
+		}
+	}
+
+	void CheckChoice()
+	{
+		// a hole of 0x100 bytes of data before one of 0x40, with a used block after each
+		auto holes = [](HeapModel::AllocationMode mode, u32& big, u32& small)
+		{
+			HeapModel heap(0x1000, mode);
+			big = heap.Allocate(0x100, 4);
+			heap.Allocate(0x10, 4);
+			small = heap.Allocate(0x40, 4);
+			heap.Allocate(0x10, 4);
+			heap.Deallocate(big);
+			heap.Deallocate(small);
+
+			return heap;
+		};
+
+		u32 big, small;
+
+		HeapModel firstFit = holes(HeapModel::FIRST_FIT, big, small);
+		Expect(firstFit.Allocate(0x30, 4) == big, "first fit takes the first hole");
+
+		HeapModel segregated = holes(HeapModel::SEGREGATED_FIT, big, small);
+		Expect(segregated.Allocate(0x30, 4) == small, "the index takes the smallest size class that fits");
+		Expect(segregated.Allocate(0x100, 4) == big, "an exact size class is searched");
+		Expect(segregated.Allocate(0x800, -4) == 0x1000 - 0x800, "backwards allocations are placed at the end");
+
+		HeapModel full(0x100, HeapModel::SEGREGATED_FIT);
+		Expect(full.Allocate(0x100, 4) == 0, "an allocation that doesn't fit fails");
+
+		// a hole with exactly 0x100 bytes of data at 0x200: the size class for 0x100 bytes at any
+		// alignment of 0x100 is above the hole's, but the game's allocator behind the index finds it
+		HeapModel aligned(0x320, HeapModel::SEGREGATED_FIT);
+		aligned.Allocate(0x1e0, 4);
+		const u32 hole = aligned.Allocate(0x100, 4);
+		aligned.Allocate(0x10, 4);
+		aligned.Deallocate(hole);
+		Expect(hole == 0x200 && aligned.Allocate(0x100, 0x100) == 0x200, "what the index can't place goes to the game's allocator");
+	}
+
+	// Something like a level load and a few minutes of play: long-lived files and models, and actors
+	// that are spawned and destroyed all the time
+	std::vector<HeapTraceEvent> LevelTrace(u32 seed)
+	{
+		std::vector<HeapTraceEvent> trace;
+		std::vector<u32> live;
+
+		auto random = [&seed](u32 n)
+		{
+			seed = seed * 1664525 + 1013904223;
+			return (seed >> 8) % n;
+		};
+
+		for (u32 i = 0; i < 150; i++)
+			trace.push_back({HeapTraceEvent::ALLOCATE, 0, 3, random(4) == 0 ? -4 : 4, 0x100 + random(0x600), 0});
+
+		// the files that were only needed while loading
+		for (u32 i = 0; i < 150; i += 3)
+			trace.push_back({HeapTraceEvent::DEALLOCATE, 0, 3, 4, 0, i});
+
+		for (u32 i = 0; i < 6000; i++)
+		{
+			if (live.size() > 40 && random(2) == 0)
+			{
+				const u32 j = random(live.size());
+				trace.push_back({HeapTraceEvent::DEALLOCATE, 0, 3, 4, 0, live[j]});
+				live[j] = live.back();
+				live.pop_back();
+			}
+			else
+			{
+				live.push_back(trace.size());
+				trace.push_back({HeapTraceEvent::ALLOCATE, 0, 3, -4, 0x40 + random(8) * 0x40 + random(0x40), 0});
+			}
+		}
+
+		return trace;
+	}
+
+	void Replay()
+	{
+		constexpr HeapModel::AllocationMode MODES[] = {HeapModel::FIRST_FIT, HeapModel::BEST_FIT, HeapModel::SEGREGATED_FIT};
+		constexpr const char* NAMES[] = {"first fit", "best fit", "segregated fit"};
+
+		const std::vector<HeapTraceEvent> trace = LevelTrace(1);
+		u32 numAllocations = 0;
+
+		for (const HeapTraceEvent& e : trace)
+			numAllocations += e.type == HeapTraceEvent::ALLOCATE;
+
+		double visited[3];
+
+		for (u32 m = 0; m < 3; m++)
+		{
+			std::vector<HeapModel> heaps = {HeapModel(0x3b000, MODES[m])};
+			HeapReplay replay(heaps);
+
+			const bool ok = replay.Run(trace);
+
+			const HeapReplay::HeapStats& stats = replay.Stats(0);
+			visited[m] = static_cast<double>(heaps[0].numBlocksVisited) / numAllocations;
+
+			std::printf("%-14s: %.1f free blocks visited per allocation, max used 0x%x, max fragmentation %.3f, "
+				"%zu failures\n", NAMES[m], visited[m], stats.maxUsed, stats.maxFragmentation, replay.Failures().size());
+
+			Expect(ok, "the trace fits into the game heap");
+		}
+
+		Expect(visited[2] < visited[0] && visited[2] < visited[1], "the index looks at fewer blocks than the game");
+	}
+
+	u32 Run()
+	{
+		CheckChoice();
+		Replay();
+
+		return numWrong;
+	}
+}
+
+int main()
+{
+	const u32 numWrong = SegregatedFitTest::Run();
+	std::printf("SegregatedFit: %u checks failed\n", numWrong);
+
+	return numWrong == 0 ? 0 : 1;
+}
@@ -0,0 +1,87 @@
+#include "Lists/SoundList.h"
+#include <cstdio>
+#include <cstring>
+#include <utility>
+
+// 1000 lookups of names spread over SoundList::SOUNDS, each in a constant evaluation of its own like
+// the "..."_sfx of the game code. This TU is the compile-time benchmark of the lookup: a table that's
+// evaluated again per lookup shows up in the time and memory it takes to compile (see -ftime-report).
+// At run time, every lookup must have found its own entry and GetSoundName must give a name back.
+
+namespace SoundListTest
+{
+	constexpr std::size_t NUM_SOUNDS = std::size(SoundList::SOUNDS);
+	constexpr std::size_t NUM_LOOKUPS = 1000;
+
+	template<std::size_t I>
+	constexpr SoundIDs LOOKUP = GetSoundInfo(SoundList::SOUNDS[I * NUM_SOUNDS / NUM_LOOKUPS].name);
+
+	u32 numWrong = 0;
+
+	void Expect(bool ok, const char* what)
+	{
+		if (!ok)
+		{
+			std::printf("%s\n", what);
+			numWrong++;
+		}
+	}
+
+	bool SameIDs(SoundIDs a, SoundIDs b)
+	{
+		return a.seqArcID == b.seqArcID && a.seqID == b.seqID;
+	}
+
+	// The IDs of name, looked up at run time
+	SoundIDs IDsOf(const char* name)
+	{
+		for (const SoundList::SoundInfo& sound : SoundList::SOUNDS)
+			if (std::strcmp(sound.name, name) == 0) return sound.ids;
+
+		return {0xffff, 0xffff};
+	}
+
+	template<std::size_t... I>
+	void CheckLookups(std::index_sequence<I...>)
+	{
+		const SoundIDs found[] = {LOOKUP<I>...};
+		u32 numFound = 0;
+		u32 numNamed = 0;
+
+		for (std::size_t i = 0; i < NUM_LOOKUPS; i++)
+		{
+			numFound += SameIDs(found[i], SoundList::SOUNDS[i * NUM_SOUNDS / NUM_LOOKUPS].ids);
+
+			// several names can have the same IDs, so any of them will do
+			const char* name = GetSoundName(found[i]);
+			numNamed += name && SameIDs(IDsOf(name), found[i]);
+		}
+
+		Expect(numFound == NUM_LOOKUPS, "every lookup finds its own entry");
+		Expect(numNamed == NUM_LOOKUPS, "GetSoundName gives a name with the same IDs");
+	}
+
+	void CheckNames()
+	{
+		Expect(SameIDs("NCS_SE_BTL_BTN"_sfx, {0x0002, 0x0118}), "a literal is found");
+		Expect(GetSoundName({0xffff, 0xffff}) == nullptr, "GetSoundName of IDs that aren't in the table is nullptr");
+	}
+
+	u32 Run()
+	{
+		static_assert(NameLookup::FirstUnsorted(SoundList::SOUNDS) == nullptr, "SOUNDS is sorted");
+
+		CheckLookups(std::make_index_sequence<NUM_LOOKUPS>());
+		CheckNames();
+
+		return numWrong;
+	}
+}
+
+int main()
+{
+	const u32 numWrong = SoundListTest::Run();
+	std::printf("SoundList: %u checks failed\n", numWrong);
+
+	return numWrong == 0 ? 0 : 1;
+}
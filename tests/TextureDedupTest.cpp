@@ -0,0 +1,172 @@
+#include "Model/TextureDedupReport.h"
+#include <cstdio>
+#include <random>
+
+namespace TextureDedupTest
+{
+	// A BMD with only the texture and palette sections, which is all the report reads
+	inline std::vector<u8> MakeBMD(std::span<const std::vector<u8>> textures, std::span<const std::vector<u8>> palettes, u32 cmd2aPart1)
+	{
+		std::vector<u8> res(0x3c, 0);
+
+		const auto write = [&](u32 offset, u32 value)
+		{
+			for (u32 i = 0; i < 4; i++)
+				res[offset + i] = value >> 8 * i;
+		};
+
+		const auto append = [&](const std::vector<u8>& data)
+		{
+			const u32 offset = res.size();
+
+			for (u8 b : data)
+				res.push_back(b);
+
+			while (res.size() % 4 != 0)
+				res.push_back(0);
+
+			return offset;
+		};
+
+		const u32 textureTable = res.size();
+		res.resize(res.size() + 0x14 * textures.size() + 0x10 * palettes.size());
+		const u32 paletteTable = textureTable + 0x14 * textures.size();
+
+		write(0x14, textures.size());
+		write(0x18, textureTable);
+		write(0x1c, palettes.size());
+		write(0x20, paletteTable);
+
+		for (u32 i = 0; i < textures.size(); i++)
+		{
+			const u32 entry = textureTable + 0x14 * i;
+			write(entry + 0x4, append(textures[i]));
+			write(entry + 0x8, textures[i].size());
+			write(entry + 0x10, cmd2aPart1);
+			write(entry, append({'t', static_cast<u8>('0' + i % 10), 0}));
+		}
+
+		for (u32 i = 0; i < palettes.size(); i++)
+		{
+			const u32 entry = paletteTable + 0x10 * i;
+			write(entry + 0x4, append(palettes[i]));
+			write(entry + 0x8, palettes[i].size());
+			write(entry, append({'p', static_cast<u8>('0' + i % 10), 0}));
+		}
+
+		return res;
+	}
+
+	// Builds sets of files whose textures come from small pools and compares the savings with the
+	// ones counted from the pool indices. Returns the number of sets that differ.
+	inline u32 Run(u32 numSets, u32 seed = 0)
+	{
+		std::mt19937 rng(seed);
+		u32 numFailed = 0;
+
+		for (u32 n = 0; n < numSets; n++)
+		{
+			std::vector<std::vector<u8>> texturePool(1 + rng() % 8), palettePool(1 + rng() % 4);
+
+			for (std::vector<u8>& texture : texturePool)
+			{
+				texture.resize(8 * (1 + rng() % 64));
+				for (u8& b : texture) b = rng();
+			}
+
+			for (std::vector<u8>& palette : palettePool)
+			{
+				palette.resize(8 * (1 + rng() % 4));
+				for (u8& b : palette) b = rng();
+			}
+
+			std::vector<std::vector<u8>> bmds;
+			std::vector<bool> textureUsed(texturePool.size()), paletteUsed(palettePool.size());
+			std::vector<bool> otherFormatUsed(texturePool.size());
+			u64 expectedTextureSaved = 0, expectedPaletteSaved = 0;
+
+			for (u32 f = 1 + rng() % 6; f != 0; f--)
+			{
+				std::vector<std::vector<u8>> textures(rng() % 6), palettes(rng() % 4);
+				u32 firstTexture = 0;
+
+				for (u32 j = 0; j < textures.size(); j++)
+				{
+					const u32 i = rng() % texturePool.size();
+					textures[j] = texturePool[i];
+
+					if (textureUsed[i]) expectedTextureSaved += textures[j].size();
+					textureUsed[i] = true;
+
+					if (j == 0) firstTexture = i;
+				}
+
+				for (std::vector<u8>& palette : palettes)
+				{
+					const u32 i = rng() % palettePool.size();
+					palette = palettePool[i];
+
+					if (paletteUsed[i]) expectedPaletteSaved += palette.size();
+					paletteUsed[i] = true;
+				}
+
+				bmds.push_back(MakeBMD(textures, palettes, 0x3 << 26 | 0x3 << 20 | 0x3 << 23));
+
+				// the same data with another format is another texture
+				if (rng() % 4 == 0 && !textures.empty())
+				{
+					bmds.push_back(MakeBMD(std::span(textures).first(1), {}, 0x4 << 26 | 0x3 << 20 | 0x3 << 23));
+
+					if (otherFormatUsed[firstTexture]) expectedTextureSaved += textures[0].size();
+					otherFormatUsed[firstTexture] = true;
+				}
+
+				// Tex4x4 textures are never shared, not even within a file
+				if (rng() % 4 == 0 && !textures.empty())
+				{
+					const std::vector<std::vector<u8>> twice = {textures[0], textures[0]};
+					bmds.push_back(MakeBMD(twice, {}, 0x5 << 26 | 0x3 << 20 | 0x3 << 23));
+				}
+			}
+
+			std::vector<TextureDedupReport::Input> inputs;
+
+			for (u32 i = 0; i < bmds.size(); i++)
+				inputs.push_back({"file" + std::to_string(i), bmds[i]});
+
+			// the first file compressed, as a stream of literals
+			const u32 size = bmds[0].size();
+			std::vector<u8> compressed = {'L', 'Z', '7', '7', LZ16::TYPE, static_cast<u8>(size), static_cast<u8>(size >> 8), static_cast<u8>(size >> 16)};
+
+			for (u32 i = 0; i < size; i++)
+			{
+				if (i % 8 == 0) compressed.push_back(0);
+				compressed.push_back(bmds[0][i]);
+			}
+
+			inputs[0].data = compressed;
+
+			const TextureDedupReport report(inputs);
+			u32 numValid = 0;
+
+			for (const TextureDedupReport::File& file : report.files)
+				numValid += file.valid;
+
+			if (numValid != bmds.size() || report.TextureBytesSaved() != expectedTextureSaved ||
+				report.PaletteBytesSaved() != expectedPaletteSaved)
+			{
+				numFailed++;
+			}
+		}
+
+		return numFailed;
+	}
+}
+
+int main()
+{
+	const u32 numFailed = TextureDedupTest::Run(300);
+	std::printf("TextureDedupReport: %u of 300 sets failed\n", numFailed);
+
+	return numFailed == 0 ? 0 : 1;
+}
@@ -0,0 +1,117 @@
+#include "Math/FixedPoint.h"
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+// Compares Sin and Cos at all 0x10000 angles and all of ATAN_TABLE, as generated by TrigTables
+// at compile time, against the tables of the game. Until this passes against the game's tables,
+// the generated values only fold constants, the runtime lookups keep reading the ROM tables.
+//
+// The tables are read from a dump of the ARM9 memory starting at 0x02000000, e.g. a main RAM dump
+// from an emulator or the decompressed arm9.bin, given as the first argument (or by setting
+// SM64DS_PI_ARM9_DUMP when configuring the tests). Without one, the test is skipped.
+
+constexpr u32 ARM9_START = 0x02000000;
+constexpr u32 SINE_TABLE_ADDR = 0x02082214; // see symbols9.x
+constexpr u32 ATAN_TABLE_ADDR = 0x020994e0;
+
+constexpr u32 NUM_ANGLES = 0x10000;
+
+// Every angle goes through Sin and Cos themselves, so their index computation is tested as well
+constexpr auto GENERATED_SINES = []() consteval
+{
+	std::array<s16, NUM_ANGLES * 2> res {};
+
+	for (u32 i = 0; i < NUM_ANGLES; i++)
+	{
+		res[i * 2]     = Sin(static_cast<s16>(i)).val;
+		res[i * 2 + 1] = Cos(static_cast<s16>(i)).val;
+	}
+
+	return res;
+}();
+
+constexpr auto GENERATED_ATANS = []() consteval
+{
+	std::array<s16, 0x400> res {};
+
+	for (u32 i = 0; i < res.size(); i++)
+		res[i] = TrigTables::AtanEntry(i).val;
+
+	return res;
+}();
+
+static_assert(GENERATED_SINES[0] == 0 && GENERATED_SINES[1] == 0x1000);
+static_assert(GENERATED_SINES[0x4000 * 2] == 0x1000 && GENERATED_SINES[0x8000 * 2 + 1] == -0x1000);
+static_assert(GENERATED_ATANS[0] == 0);
+
+bool ReadTable(const std::vector<u8>& dump, u32 addr, s16* table, u32 numEntries)
+{
+	const u32 offset = addr - ARM9_START;
+
+	if (offset + numEntries * 2 > dump.size()) return false;
+
+	for (u32 i = 0; i < numEntries; i++)
+		table[i] = static_cast<s16>(dump[offset + i * 2] | dump[offset + i * 2 + 1] << 8);
+
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	const char* path = argc > 1 && *argv[1] ? argv[1] : nullptr;
+
+	if (!path)
+	{
+		std::printf("TrigTables: no ARM9 dump given, skipped\n");
+		return 77;
+	}
+
+	std::FILE* file = std::fopen(path, "rb");
+
+	if (!file)
+	{
+		std::printf("TrigTables: can't open %s\n", path);
+		return 1;
+	}
+
+	std::vector<u8> dump;
+
+	for (int c; (c = std::fgetc(file)) != EOF;)
+		dump.push_back(static_cast<u8>(c));
+
+	std::fclose(file);
+
+	s16 sineTable[0x2000], atanTable[0x400];
+
+	if (!ReadTable(dump, SINE_TABLE_ADDR, sineTable, 0x2000) || !ReadTable(dump, ATAN_TABLE_ADDR, atanTable, 0x400))
+	{
+		std::printf("TrigTables: %s is too small to hold the tables\n", path);
+		return 1;
+	}
+
+	u32 numWrong = 0;
+
+	for (u32 i = 0; i < NUM_ANGLES; i++)
+	{
+		const u32 index = static_cast<u16>(i + 8) >> 4 << 1;
+
+		for (u32 cos = 0; cos < 2; cos++)
+		{
+			const s16 generated = GENERATED_SINES[i * 2 + cos];
+			const s16 rom = sineTable[index + cos];
+
+			if (generated != rom && numWrong++ < 16)
+				std::printf("%s(0x%04x): generated 0x%04x, ROM 0x%04x\n", cos ? "Cos" : "Sin", i, generated & 0xffff, rom & 0xffff);
+		}
+	}
+
+	for (u32 i = 0; i < 0x400; i++)
+		if (GENERATED_ATANS[i] != atanTable[i] && numWrong++ < 16)
+			std::printf("ATAN_TABLE[0x%03x]: generated 0x%04x, ROM 0x%04x\n", i, GENERATED_ATANS[i], atanTable[i]);
+
+	std::printf("TrigTables: %u of %u values differ from the ROM\n", numWrong, NUM_ANGLES * 2 + 0x400);
+
+	return numWrong == 0 ? 0 : 1;
+}
@@ -0,0 +1,135 @@
+#include "Math.h"
+#include "RomModels.h"
+#include "Benchmark.h"
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// Checks that the batched transforms give the same results as MulVec3Mat4x3 / MulVec3Mat3x3 for
+// both layouts, in place and with spans of different sizes, and benchmarks them against the
+// Matrix4x3 proxy path that transforms one vector per call.
+
+Fix12i RandomFix(std::mt19937& rng, u32 bits)
+{
+	return Fix12i(static_cast<s32>(rng() >> (32 - bits)) - (1 << (bits - 1)), as_raw);
+}
+
+Vector3 RandomVector(std::mt19937& rng, u32 bits)
+{
+	return {RandomFix(rng, bits), RandomFix(rng, bits), RandomFix(rng, bits)};
+}
+
+Matrix4x3 RandomMatrix(std::mt19937& rng)
+{
+	Matrix4x3 m;
+	m.c0 = RandomVector(rng, 15); // rotation and scale
+	m.c1 = RandomVector(rng, 15);
+	m.c2 = RandomVector(rng, 15);
+	m.c3 = RandomVector(rng, 24); // translation
+
+	return m;
+}
+
+struct SoA
+{
+	std::vector<Fix12i> x, y, z;
+
+	explicit SoA(std::span<const Vector3> vs) : x(vs.size()), y(vs.size()), z(vs.size())
+	{
+		Batch().Gather(vs);
+	}
+
+	Vector3Batch Batch() { return {x, y, z}; }
+};
+
+u32 CheckTransforms(std::mt19937& rng)
+{
+	const Matrix4x3 m = RandomMatrix(rng);
+	std::vector<Vector3> points(rng() % 100);
+
+	for (Vector3& v : points)
+		v = RandomVector(rng, 24);
+
+	std::vector<Vector3> expectedPoints(points.size()), expectedNormals(points.size());
+
+	for (std::size_t i = 0; i < points.size(); i++)
+	{
+		MulVec3Mat4x3(points[i], m, expectedPoints[i]);
+		MulVec3Mat3x3(points[i], m.Linear(), expectedNormals[i]);
+	}
+
+	u32 numWrong = 0;
+	const auto check = [&](std::span<const Vector3> res, std::span<const Vector3> expected, std::size_t count)
+	{
+		for (std::size_t i = 0; i < count; i++)
+			numWrong += res[i] != expected[i];
+	};
+
+	// array of structures, also in place
+	std::vector<Vector3> aos(points.size());
+	TransformPoints(m, points, aos);
+	check(aos, expectedPoints, points.size());
+
+	aos = points;
+	TransformNormals(m, aos, aos);
+	check(aos, expectedNormals, points.size());
+
+	// structure of arrays, also in place
+	SoA src(points), dst(points);
+	TransformPoints(m, src.Batch(), dst.Batch());
+	dst.Batch().Scatter(aos);
+	check(aos, expectedPoints, points.size());
+
+	TransformNormals(m, src.Batch(), src.Batch());
+	src.Batch().Scatter(aos);
+	check(aos, expectedNormals, points.size());
+
+	// a shorter destination only gets as many vectors as it has, and nothing after them is written
+	const std::size_t shorter = points.size() / 2;
+	std::vector<Vector3> guarded(points.size(), Vector3{1, 2, 3});
+
+	TransformPoints(m, points, std::span(guarded).first(shorter));
+	check(guarded, expectedPoints, shorter);
+
+	for (std::size_t i = shorter; i < guarded.size(); i++)
+		numWrong += guarded[i] != Vector3{1, 2, 3};
+
+	return numWrong;
+}
+
+int main()
+{
+	std::mt19937 rng(0);
+	u32 numWrong = 0;
+
+	for (u32 i = 0; i < 2000; i++)
+		numWrong += CheckTransforms(rng);
+
+	std::printf("VectorBatch: %u vectors differ from the scalar path\n", numWrong);
+
+	// a particle emitter's worth of points, transformed many times
+	std::vector<Vector3> points(256), res(points.size());
+
+	for (Vector3& v : points)
+		v = RandomVector(rng, 24);
+
+	SoA src(points), dst(points);
+	const Matrix4x3 m = RandomMatrix(rng);
+	constexpr u32 numRounds = 20000;
+
+	const double scalarNanos = NanosPerCall(numRounds, [&](u32)
+	{
+		for (std::size_t i = 0; i < points.size(); i++)
+			res[i] = m(points[i]);
+
+		DoNotOptimize(res);
+	});
+
+	const double aosNanos = NanosPerCall(numRounds, [&](u32) { TransformPoints(m, points, res); DoNotOptimize(res); });
+	const double soaNanos = NanosPerCall(numRounds, [&](u32) { TransformPoints(m, src.Batch(), dst.Batch()); DoNotOptimize(dst); });
+
+	std::printf("%zu points: proxy %.0f ns, batch AoS %.0f ns, batch SoA %.0f ns\n",
+		points.size(), scalarNanos, aosNanos, soaNanos);
+
+	return numWrong == 0 ? 0 : 1;
+}